@@ -0,0 +1,209 @@
+/**
+ * Saccubus
+ * Copyright (C) 2012 psi
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COMPAT_SACCUBUS_SACCUBUS_ADAPTER_H
+#define COMPAT_SACCUBUS_SACCUBUS_ADAPTER_H
+
+#if ((defined(WIN32) || defined(WIN64) || defined(__WIN32__) || defined(__WIN64__)))
+
+#if defined(SACC_DLL_EXPORT)
+#define DYNAPI __declspec(dllexport)
+#else
+#define DYNAPI __declspec(dllimport)
+#endif
+
+#else
+#define DYNAPI
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ツールボックスのバージョン
+ * DLLの中で確認しといた方がいい。
+ */
+#define TOOLBOX_VERSION 4
+
+/*
+ * 合成先サーフェスの形式(v3〜)
+ * SaccMeasureの中か、loadVideoを呼ぶ前にSaccToolBox.surfaceFormatに設定する。設定しなければRGB32。
+ * フィルタ(vf_saccubus)として使う時は、SaccConfigureの中で設定すること。
+ */
+enum SaccSurfaceFormat {
+	/* 32bitのRGB(ffmpegのRGB32)。v2までと同じ。 */
+	SACC_SURFACE_RGB32 = 0,
+	/* 動画と同じYUV420P。planes[0..2]にY,U,Vが入る。 */
+	SACC_SURFACE_YUV420P = 1,
+	/* 動画と同じNV12。planes[0]にY、planes[1]にUVが入る。 */
+	SACC_SURFACE_NV12 = 2,
+	/*
+	 * targetはプリマルチプライドRGBA(RGB32と同じ並び)の重ね合わせ層。
+	 * 動画はデバイスがYUV420Pのまま中央に配置して、その上にこの層を合成する。
+	 * 層の内容は呼び出しをまたいで保持されるので、消すのもプラグインの仕事。
+	 */
+	SACC_SURFACE_RGBA_OVERLAY = 3,
+};
+
+/*
+ * SaccToolBox.flagsに立てるフラグ(v3〜)
+ */
+/*
+ * vposの違うSaccProcessを、別々のスレッドから同時に呼んでも大丈夫。
+ * デバイスのprocess_threadsオプションと一緒に使うと並列に合成する。
+ * この場合、重ね合わせ層はフレーム毎に別々のものが渡されるので、
+ * 前回の内容が残っていることは期待できない。
+ */
+#define SACC_FLAG_REENTRANT (1 << 0)
+/*
+ * RGB32/YUVモードで、前回の合成結果の上に変わったところだけ描ける(v4〜)。
+ * 同じ動画フレームが続く時、targetに前回の結果を入れた上で呼ぶ(SACC_FRAME_PREVIOUS)。
+ */
+#define SACC_FLAG_INCREMENTAL (1 << 1)
+
+/*
+ * SaccFrame.flags(v4〜)
+ */
+/* video: 前回の呼び出しと同じ動画フレーム(minfpsで水増しした分) */
+#define SACC_FRAME_SAME_VIDEO (1 << 0)
+/* target: 前回の合成結果が既に入っている */
+#define SACC_FRAME_PREVIOUS (1 << 1)
+/* target: 必ず全部描くこと。戻り値のUNCHANGED/DIRTYは無視される(並列実行時) */
+#define SACC_FRAME_FULL_REDRAW (1 << 2)
+
+/*
+ * SaccProcessの戻り値(v4〜)。0なら全部描いたものとして扱う。
+ * フィルタ(vf_saccubus)として使う時、負の値はエラーとして処理を止める。
+ */
+/*
+ * targetは前回から何も変わっていないので、何も描いていない。
+ * RGB32/YUVモードではvideoにSACC_FRAME_SAME_VIDEOが立っている時だけ使える。
+ * デバイスは前回の出力をそのまま使う。
+ */
+#define SACC_PROCESS_UNCHANGED 1
+/*
+ * target.dirtyに入れた矩形だけ変わった。それ以外は前回のまま触っていない。
+ * 重ね合わせモードでは、デバイスはその部分だけ動画を置き直して合成する。
+ * RGB32/YUVモードではSACC_FRAME_PREVIOUSが立っている時だけ使える。
+ */
+#define SACC_PROCESS_DIRTY 2
+
+/* dirtyに入れられる矩形の最大数 */
+#define SACC_MAX_DIRTY_RECTS 16
+
+/*
+ * 呼ばれるときに一緒についてくるtoolbox.
+ * ここから部分的にffmpegを操作することが可能
+ */
+
+typedef struct SaccToolBox SaccToolBox;
+typedef struct SaccFrame SaccFrame;
+typedef struct SaccRect SaccRect;
+
+struct SaccToolBox {
+	/* 管理用 */
+	void* ptr;
+	/* バージョン */
+	int version;
+	int (*loadVideo)(SaccToolBox* box, const char* filename);
+	/*
+	 * ptsの位置(秒)を表示しているフレームに飛ぶ。SaccConfigureか、
+	 * デバイスのスレッドで呼ばれたSaccProcessの中から呼ぶこと。
+	 * process_threadsでワーカーから呼ばれたSaccProcessの中ではAVERROR(EBUSY)が返って何もしない。
+	 * フィルタ(vf_saccubus)ではNULL。
+	 */
+	int (*seek)(SaccToolBox* box, double pts);
+	/* 現在の動画情報 */
+	struct {
+		int width;
+		int height;
+		double length;
+	} currentVideo;
+	/* v3: targetの形式(enum SaccSurfaceFormat) */
+	int surfaceFormat;
+	/* v3: プラグインの性質(SACC_FLAG_*)。SaccConfigureかSaccMeasureで設定する */
+	int flags;
+};
+
+struct SaccRect {
+	int x;
+	int y;
+	int w;
+	int h;
+};
+
+struct SaccFrame{
+	/* 画像データ */
+	double vpos;
+	void *data;
+	int linesize;
+	int w;
+	int h;
+	/* v3: 形式(enum SaccSurfaceFormat)と各プレーン。data/linesizeはplanes[0]と同じ。 */
+	int format;
+	void *planes[4];
+	int linesizes[4];
+	/* v4: SACC_FRAME_* */
+	int flags;
+	/* v4: targetのみ。変わった矩形をプラグインが入れる(最大maxDirty個) */
+	SaccRect *dirty;
+	int nbDirty;
+	int maxDirty;
+};
+
+/*
+ * 拡張vhookライブラリ用関数群定義
+ */
+
+// configure用
+typedef int (SaccConfigureFn)(void **sacc, SaccToolBox *box, int argc, char *argv[]);
+typedef SaccConfigureFn *SaccConfigureFnPtr;
+#ifdef SACC_DLL_EXPORT
+extern SaccConfigureFn DYNAPI SaccConfigure;
+#endif
+
+// 与えられた動画サイズから、出力サイズを決定する。一度だけ、呼ばれる。
+typedef int (SaccMeasureFn)(void *sacc, SaccToolBox *box, int srcWidth, int srcHeight, int* dstWidth, int* dstHeight);
+typedef SaccMeasureFn *SaccMeasureFnPtr;
+#ifdef SACC_DLL_EXPORT
+extern SaccMeasureFn DYNAPI SaccMeasure;
+#endif
+
+// フレームに画像を焼きこむ
+// targetに前回呼び出し時の内容が残っているかどうかは、次の通り。
+// ・surfaceFormatもflagsも設定しないプラグイン(v2まで)には、常に前回の合成結果が入ったまま渡す。
+// ・RGB32/YUVモードでsurfaceFormatかflagsを設定した場合(v3〜)、targetはプールから取り出したバッファなので、
+//   target.flagsにSACC_FRAME_PREVIOUSが立っている時以外は前回の内容は残っていない。
+// ・重ね合わせモードの層は、SACC_FLAG_REENTRANTで並列に呼ばれる時以外は呼び出しをまたいで保持される。
+typedef int (SaccProcessFn)(void *sacc, SaccToolBox *box, SaccFrame *target, SaccFrame* video);
+typedef SaccProcessFn *SaccProcessFnPtr;
+#ifdef SACC_DLL_EXPORT
+extern SaccProcessFn DYNAPI SaccProcess;
+#endif
+
+// 終了時に呼ぶ
+typedef int (SaccReleaseFn)(void *sacc, SaccToolBox *box);
+typedef SaccReleaseFn *SaccReleaseFnPtr;
+#ifdef SACC_DLL_EXPORT
+extern SaccReleaseFn DYNAPI SaccRelease;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* COMPAT_SACCUBUS_SACCUBUS_ADAPTER_H */
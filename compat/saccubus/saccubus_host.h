@@ -0,0 +1,104 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Helpers shared by the hosts of saccubus adapter plugins, the saccubus
+ * input device and the saccubus filter.
+ */
+
+#ifndef COMPAT_SACCUBUS_SACCUBUS_HOST_H
+#define COMPAT_SACCUBUS_SACCUBUS_HOST_H
+
+#include <stdint.h>
+
+#include "libavutil/common.h"
+#include "compat/w32dlfcn.h"
+#include "compat/saccubus/saccubus_adapter.h"
+
+#ifdef _WIN32
+#define sacc_dlerror() "LoadLibrary failed"
+#else
+#define sacc_dlerror() dlerror()
+#endif
+
+/**
+ * Plugins that set neither a surface format nor flags were written against
+ * toolbox v2: they may rely on the target keeping its previous contents and
+ * their SaccProcess return value has no meaning.
+ */
+static inline int sacc_is_legacy(const SaccToolBox *box)
+{
+    return box->surfaceFormat == SACC_SURFACE_RGB32 && !box->flags;
+}
+
+/**
+ * Blend the premultiplied RGBA overlay layer into the YUV420P picture dst
+ * over the rectangle (x0,y0)-(x1,y1), converting only the pixels with
+ * non-zero alpha (BT.601, limited range). The rectangle must be aligned
+ * to 2x2 blocks.
+ */
+static inline void sacc_blend_overlay(uint8_t *const dst[4], const int dst_linesize[4],
+                                      const uint8_t *overlay, int overlay_linesize,
+                                      int x0, int y0, int x1, int y1)
+{
+    int x, y, i, j;
+
+    for (y = y0; y < y1; y += 2) {
+        const uint32_t *ov[2] = {
+            (const uint32_t *)(overlay +  y      * overlay_linesize),
+            (const uint32_t *)(overlay + (y + 1) * overlay_linesize),
+        };
+        uint8_t *lum[2] = {
+            dst[0] +  y      * dst_linesize[0],
+            dst[0] + (y + 1) * dst_linesize[0],
+        };
+        uint8_t *cb = dst[1] + (y >> 1) * dst_linesize[1];
+        uint8_t *cr = dst[2] + (y >> 1) * dst_linesize[2];
+
+        for (x = x0; x < x1; x += 2) {
+            int sa = 0, sr = 0, sg = 0, sb = 0;
+
+            if (!(ov[0][x] | ov[0][x + 1] | ov[1][x] | ov[1][x + 1]))
+                continue;
+            for (j = 0; j < 2; j++) {
+                for (i = 0; i < 2; i++) {
+                    const uint32_t px = ov[j][x + i];
+                    const int a = px >> 24;
+                    const int r = (px >> 16) & 0xff;
+                    const int g = (px >>  8) & 0xff;
+                    const int b =  px        & 0xff;
+                    if (a) {
+                        const int yo = (66 * r + 129 * g + 25 * b + 16 * a + 128) >> 8;
+                        lum[j][x + i] = av_clip_uint8((lum[j][x + i] * (255 - a) + 127) / 255 + yo);
+                    }
+                    sa += a; sr += r; sg += g; sb += b;
+                }
+            }
+            if (sa) {
+                const int a  = (sa + 2) >> 2;
+                const int uo = (-38 * sr -  74 * sg + 112 * sb + 512 * a + 512) >> 10;
+                const int vo = (112 * sr -  94 * sg -  18 * sb + 512 * a + 512) >> 10;
+                cb[x >> 1] = av_clip_uint8((cb[x >> 1] * (255 - a) + 127) / 255 + uo);
+                cr[x >> 1] = av_clip_uint8((cr[x >> 1] * (255 - a) + 127) / 255 + vo);
+            }
+        }
+    }
+}
+
+#endif /* COMPAT_SACCUBUS_SACCUBUS_HOST_H */
@@ -130,6 +130,10 @@ static void do_video_stats(OutputStream *ost, int frame_size);
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
 static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
+#if HAVE_THREADS
+static int send_to_filtergraph_thread(FilterGraph *fg, InputFilter *ifilter,
+                                      AVFrame *frame, int64_t pts);
+#endif
 
 static int run_as_daemon  = 0;
 static int nb_frames_dup = 0;
@@ -166,6 +170,7 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_encoder_threads(void);
 #endif
 
 /* sub2video hack:
@@ -228,6 +233,14 @@ static void sub2video_push_ref(InputStream *ist, int64_t pts)
     av_assert1(frame->data[0]);
     ist->sub2video.last_pts = frame->pts = pts;
     for (i = 0; i < ist->nb_filters; i++) {
+#if HAVE_THREADS
+        FilterGraph *fg = ist->filters[i]->graph;
+        if (fg->thread_active) {
+            AVFrame *ref = av_frame_clone(frame);
+            ret = ref ? send_to_filtergraph_thread(fg, ist->filters[i], ref, 0) :
+                        AVERROR(ENOMEM);
+        } else
+#endif
         ret = av_buffersrc_add_frame_flags(ist->filters[i]->filter, frame,
                                            AV_BUFFERSRC_FLAG_KEEP_REF |
                                            AV_BUFFERSRC_FLAG_PUSH);
@@ -294,8 +307,18 @@ static void sub2video_heartbeat(InputStream *ist, int64_t pts)
         if (pts2 >= ist2->sub2video.end_pts ||
             (!ist2->sub2video.frame->data[0] && ist2->sub2video.end_pts < INT64_MAX))
             sub2video_update(ist2, NULL);
-        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++)
+        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++) {
+#if HAVE_THREADS
+            FilterGraph *fg = ist2->filters[j]->graph;
+            if (fg->thread_active) {
+                pthread_mutex_lock(&fg->lock);
+                nb_reqs += ist2->filters[j]->thread_failed_requests;
+                pthread_mutex_unlock(&fg->lock);
+                continue;
+            }
+#endif
             nb_reqs += av_buffersrc_get_nb_failed_requests(ist2->filters[j]->filter);
+        }
         if (nb_reqs)
             sub2video_push_ref(ist2, pts2);
     }
@@ -309,6 +332,12 @@ static void sub2video_flush(InputStream *ist)
     if (ist->sub2video.end_pts < INT64_MAX)
         sub2video_update(ist, NULL);
     for (i = 0; i < ist->nb_filters; i++) {
+#if HAVE_THREADS
+        if (ist->filters[i]->graph->thread_active)
+            ret = send_to_filtergraph_thread(ist->filters[i]->graph, ist->filters[i],
+                                             NULL, AV_NOPTS_VALUE);
+        else
+#endif
         ret = av_buffersrc_add_frame(ist->filters[i]->filter, NULL);
         if (ret != AVERROR_EOF && ret < 0)
             av_log(NULL, AV_LOG_WARNING, "Flush the frame error.\n");
@@ -489,8 +518,15 @@ static void ffmpeg_cleanup(int ret)
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
     }
 
+#if HAVE_THREADS
+    free_encoder_threads();
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+#if HAVE_THREADS
+        free_filtergraph_thread(fg);
+#endif
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             while (av_fifo_size(fg->inputs[j]->frame_queue)) {
@@ -614,6 +650,7 @@ static void ffmpeg_cleanup(int ret)
                    av_err2str(AVERROR(errno)));
     }
     av_freep(&vstats_filename);
+    av_freep(&filter_complex_thread_type);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -678,6 +715,122 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static AVMutex stage_stats_lock = AV_MUTEX_INITIALIZER;
+
+int64_t stage_stats_now(void)
+{
+    return stage_times ? av_gettime_relative() : 0;
+}
+
+static int stage_stats_bucket(int64_t duration)
+{
+    int e;
+
+    if (duration < 4)
+        return FFMAX(duration, 0);
+    duration = FFMIN(duration, INT_MAX);
+    e = av_log2(duration);
+    return ((e - 1) << 2) + ((duration >> (e - 2)) & 3);
+}
+
+/* smallest duration falling into the given bucket */
+static int64_t stage_stats_bucket_start(int bucket)
+{
+    if (bucket < 4)
+        return bucket;
+    return (int64_t)(4 + (bucket & 3)) << ((bucket >> 2) - 1);
+}
+
+void stage_stats_update(StageStats *st, int64_t duration, int done)
+{
+    if (!stage_times)
+        return;
+    ff_mutex_lock(&stage_stats_lock);
+    st->total += duration;
+    if (done) {
+        st->nb++;
+        st->hist[stage_stats_bucket(st->pending + duration)]++;
+        st->pending = 0;
+    } else {
+        st->pending += duration;
+    }
+    ff_mutex_unlock(&stage_stats_lock);
+}
+
+/* upper bound of the bucket holding the given percentile */
+static int64_t stage_stats_percentile(const StageStats *st, int percent)
+{
+    int64_t rank = (st->nb * percent + 99) / 100, n = 0;
+    int i;
+
+    for (i = 0; i < STAGE_STATS_BUCKETS - 1; i++) {
+        n += st->hist[i];
+        if (n >= rank)
+            break;
+    }
+    return stage_stats_bucket_start(i + 1) - 1;
+}
+
+static void print_stage_stats(AVBPrint *buf_script, const char *prefix,
+                              const char *stage, const StageStats *st)
+{
+    av_bprintf(buf_script, "%s_%s_count=%"PRId64"\n", prefix, stage, st->nb);
+    av_bprintf(buf_script, "%s_%s_us=%"PRId64"\n", prefix, stage, st->total);
+    av_bprintf(buf_script, "%s_%s_p50_us=%"PRId64"\n", prefix, stage,
+               st->nb ? stage_stats_percentile(st, 50) : 0);
+    av_bprintf(buf_script, "%s_%s_p99_us=%"PRId64"\n", prefix, stage,
+               st->nb ? stage_stats_percentile(st, 99) : 0);
+}
+
+static void print_all_stage_stats(AVBPrint *buf_script)
+{
+    char prefix[64];
+    int i;
+
+    ff_mutex_lock(&stage_stats_lock);
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        snprintf(prefix, sizeof(prefix), "input_%d_%d", ist->file_index, ist->st->index);
+        print_stage_stats(buf_script, prefix, "demux", &ist->demux_stats);
+        if (ist->decoding_needed)
+            print_stage_stats(buf_script, prefix, "decode", &ist->decode_stats);
+    }
+    for (i = 0; i < nb_filtergraphs; i++) {
+        snprintf(prefix, sizeof(prefix), "filtergraph_%d", i);
+        print_stage_stats(buf_script, prefix, "filter", &filtergraphs[i]->filter_stats);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        snprintf(prefix, sizeof(prefix), "stream_%d_%d", ost->file_index, ost->index);
+        if (ost->encoding_needed)
+            print_stage_stats(buf_script, prefix, "encode", &ost->encode_stats);
+        print_stage_stats(buf_script, prefix, "mux", &ost->mux_stats);
+    }
+    ff_mutex_unlock(&stage_stats_lock);
+
+#if HAVE_THREADS
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        if (!f->in_thread_queue)
+            continue;
+        av_bprintf(buf_script, "input_%d_queue=%d\n", i,
+                   av_thread_message_queue_nb_elems(f->in_thread_queue));
+        pthread_mutex_lock(&f->queue_lock);
+        av_bprintf(buf_script, "input_%d_queue_bytes=%"PRId64"\n", i, f->queued_bytes);
+        pthread_mutex_unlock(&f->queue_lock);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (!ost->enc_thread_active)
+            continue;
+        pthread_mutex_lock(&ost->enc_lock);
+        av_bprintf(buf_script, "stream_%d_%d_enc_queue=%d\n", ost->file_index, ost->index,
+                   (int)(av_fifo_size(ost->enc_frame_queue) / sizeof(AVFrame *)));
+        pthread_mutex_unlock(&ost->enc_lock);
+    }
+#endif
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -691,6 +844,7 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    int64_t mux_start;
     int ret;
 
     /*
@@ -813,7 +967,9 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+    mux_start = stage_stats_now();
     ret = av_interleaved_write_frame(s, pkt);
+    stage_stats_update(&ost->mux_stats, stage_stats_now() - mux_start, 1);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
@@ -908,11 +1064,279 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
+#if HAVE_THREADS
+/*
+ * Encoding threads (-thread_encode).
+ *
+ * Each audio and video output stream gets a thread that owns its encoder.
+ * The main thread still does all the timestamp and frame rate handling and
+ * queues the resulting frames; the encoded packets are queued back and muxed
+ * on the main thread, so the order of the packets in each stream does not
+ * change.  A single condition variable is used for both directions, so that
+ * the main thread keeps muxing while it waits for room in a full frame queue.
+ */
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    AVCodecContext *enc = ost->enc_ctx;
+    int ret = 0, eof = 0;
+
+    while (!eof) {
+        AVFrame *frame = NULL;
+        int64_t pts, enc_start, enc_time = 0;
+
+        pthread_mutex_lock(&ost->enc_lock);
+        while (!av_fifo_size(ost->enc_frame_queue) && !ost->enc_eof && !ost->enc_abort)
+            pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+        if (ost->enc_abort) {
+            pthread_mutex_unlock(&ost->enc_lock);
+            break;
+        }
+        if (av_fifo_size(ost->enc_frame_queue))
+            av_fifo_generic_read(ost->enc_frame_queue, &frame, sizeof(frame), NULL);
+        else
+            eof = 1;
+        pthread_cond_broadcast(&ost->enc_cond);
+        pthread_mutex_unlock(&ost->enc_lock);
+
+        /* same as flush_encoders(): these encoders have nothing to flush */
+        if (eof && enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
+            break;
+
+        if (frame && enc->codec_type == AVMEDIA_TYPE_VIDEO && !ost->frame_aspect_ratio.num)
+            enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+        pts = frame ? frame->pts : AV_NOPTS_VALUE;
+        enc_start = stage_stats_now();
+        ret = avcodec_send_frame(enc, frame);
+        av_frame_free(&frame);
+        if (ret < 0)
+            break;
+
+        while (1) {
+            AVPacket pkt;
+
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+            ret = avcodec_receive_packet(enc, &pkt);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                if (ret == AVERROR_EOF && ost->logfile && enc->stats_out)
+                    fprintf(ost->logfile, "%s", enc->stats_out);
+                if (!eof)
+                    stage_stats_update(&ost->encode_stats, enc_time + stage_stats_now() - enc_start, 1);
+                ret = 0;
+                break;
+            }
+            if (ret < 0)
+                goto finish;
+            /* the queueing is not part of the encoding time, as in do_video_out() */
+            enc_time += stage_stats_now() - enc_start;
+
+            if (enc->codec_type == AVMEDIA_TYPE_VIDEO && !eof &&
+                pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+                pkt.pts = pts;
+            av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
+
+            /* if two pass, output log */
+            if (ost->logfile && enc->stats_out)
+                fprintf(ost->logfile, "%s", enc->stats_out);
+
+            pthread_mutex_lock(&ost->enc_lock);
+            if (!av_fifo_space(ost->enc_pkt_queue))
+                ret = av_fifo_grow(ost->enc_pkt_queue, av_fifo_size(ost->enc_pkt_queue));
+            if (ret >= 0) {
+                av_fifo_generic_write(ost->enc_pkt_queue, &pkt, sizeof(pkt), NULL);
+                memcpy(ost->enc_error, enc->error, sizeof(ost->enc_error));
+                pthread_cond_broadcast(&ost->enc_cond);
+            }
+            pthread_mutex_unlock(&ost->enc_lock);
+            if (ret < 0) {
+                av_packet_unref(&pkt);
+                goto finish;
+            }
+            enc_start = stage_stats_now();
+        }
+    }
+
+finish:
+    pthread_mutex_lock(&ost->enc_lock);
+    memcpy(ost->enc_error, enc->error, sizeof(ost->enc_error));
+    ost->enc_ret  = ret;
+    ost->enc_done = 1;
+    pthread_cond_broadcast(&ost->enc_cond);
+    pthread_mutex_unlock(&ost->enc_lock);
+    return NULL;
+}
+
+/* Mux the packets the encoding thread of ost has produced so far. */
+static void reap_encoder_thread(OutputStream *ost, int flushing)
+{
+    OutputFile *of = output_files[ost->file_index];
+    int ret;
+
+    pthread_mutex_lock(&ost->enc_lock);
+    while (av_fifo_size(ost->enc_pkt_queue)) {
+        AVPacket pkt;
+        int pkt_size;
+
+        av_fifo_generic_read(ost->enc_pkt_queue, &pkt, sizeof(pkt), NULL);
+        pthread_mutex_unlock(&ost->enc_lock);
+
+        if (flushing && (ost->finished & MUXER_FINISHED)) {
+            av_packet_unref(&pkt);
+        } else {
+            pkt_size = pkt.size;
+            output_packet(of, &pkt, ost, 0);
+            if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename)
+                do_video_stats(ost, pkt_size);
+        }
+
+        pthread_mutex_lock(&ost->enc_lock);
+    }
+    ret = ost->enc_ret;
+    pthread_mutex_unlock(&ost->enc_lock);
+
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
+               av_get_media_type_string(ost->enc_ctx->codec_type), av_err2str(ret));
+        exit_program(1);
+    }
+}
+
+static void reap_encoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i]->enc_thread_active)
+            reap_encoder_thread(output_streams[i], 0);
+}
+
+/* Queue a reference to frame for the encoding thread of ost. */
+static void send_frame_to_encoder_thread(OutputStream *ost, const AVFrame *frame)
+{
+    AVFrame *ref = av_frame_clone(frame);
+
+    if (!ref)
+        exit_program(1);
+
+    pthread_mutex_lock(&ost->enc_lock);
+    while (!av_fifo_space(ost->enc_frame_queue) && !ost->enc_done) {
+        if (av_fifo_size(ost->enc_pkt_queue)) {
+            pthread_mutex_unlock(&ost->enc_lock);
+            reap_encoder_thread(ost, 0);
+            pthread_mutex_lock(&ost->enc_lock);
+            continue;
+        }
+        pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+    }
+    if (!ost->enc_done) {
+        av_fifo_generic_write(ost->enc_frame_queue, &ref, sizeof(ref), NULL);
+        pthread_cond_broadcast(&ost->enc_cond);
+        ref = NULL;
+    }
+    pthread_mutex_unlock(&ost->enc_lock);
+    av_frame_free(&ref);
+
+    reap_encoder_thread(ost, 0);
+}
+
+/* Flush the encoder of ost, mux everything it returns and join the thread. */
+static void finish_encoder_thread(OutputStream *ost)
+{
+    pthread_mutex_lock(&ost->enc_lock);
+    ost->enc_eof = 1;
+    pthread_cond_broadcast(&ost->enc_cond);
+    while (!ost->enc_done) {
+        if (av_fifo_size(ost->enc_pkt_queue)) {
+            pthread_mutex_unlock(&ost->enc_lock);
+            reap_encoder_thread(ost, 1);
+            pthread_mutex_lock(&ost->enc_lock);
+            continue;
+        }
+        pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+    }
+    pthread_mutex_unlock(&ost->enc_lock);
+
+    pthread_join(ost->enc_thread, NULL);
+    ost->enc_thread_active = 0;
+    reap_encoder_thread(ost, 1);
+}
+
+static void free_encoder_thread(OutputStream *ost)
+{
+    if (ost->enc_thread_active) {
+        pthread_mutex_lock(&ost->enc_lock);
+        ost->enc_abort = 1;
+        pthread_cond_broadcast(&ost->enc_cond);
+        pthread_mutex_unlock(&ost->enc_lock);
+        pthread_join(ost->enc_thread, NULL);
+        ost->enc_thread_active = 0;
+    }
+    if (ost->enc_frame_queue) {
+        while (av_fifo_size(ost->enc_frame_queue)) {
+            AVFrame *frame;
+            av_fifo_generic_read(ost->enc_frame_queue, &frame, sizeof(frame), NULL);
+            av_frame_free(&frame);
+        }
+        av_fifo_freep(&ost->enc_frame_queue);
+        pthread_cond_destroy(&ost->enc_cond);
+        pthread_mutex_destroy(&ost->enc_lock);
+    }
+    if (ost->enc_pkt_queue) {
+        while (av_fifo_size(ost->enc_pkt_queue)) {
+            AVPacket pkt;
+            av_fifo_generic_read(ost->enc_pkt_queue, &pkt, sizeof(pkt), NULL);
+            av_packet_unref(&pkt);
+        }
+        av_fifo_freep(&ost->enc_pkt_queue);
+    }
+}
+
+static void free_encoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i])
+            free_encoder_thread(output_streams[i]);
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    ost->enc_frame_queue = av_fifo_alloc_array(FFMAX(enc_thread_queue_size, 1), sizeof(AVFrame *));
+    ost->enc_pkt_queue   = av_fifo_alloc_array(8, sizeof(AVPacket));
+    if (!ost->enc_frame_queue || !ost->enc_pkt_queue)
+        return AVERROR(ENOMEM);
+    pthread_mutex_init(&ost->enc_lock, NULL);
+    pthread_cond_init(&ost->enc_cond, NULL);
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        return AVERROR(ret);
+    }
+    ost->enc_thread_active = 1;
+    return 0;
+}
+#endif
+
+static int ost_encodes_on_thread(OutputStream *ost)
+{
+#if HAVE_THREADS
+    return ost->enc_thread_active;
+#else
+    return 0;
+#endif
+}
+
 static void do_audio_out(OutputFile *of, OutputStream *ost,
                          AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket pkt;
+    int64_t enc_start, enc_time = 0;
     int ret;
 
     av_init_packet(&pkt);
@@ -937,6 +1361,14 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+#if HAVE_THREADS
+    if (ost->enc_thread_active) {
+        send_frame_to_encoder_thread(ost, frame);
+        return;
+    }
+#endif
+
+    enc_start = stage_stats_now();
     ret = avcodec_send_frame(enc, frame);
     if (ret < 0)
         goto error;
@@ -949,6 +1381,8 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
             goto error;
 
         update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
+        /* the muxing is timed separately */
+        enc_time += stage_stats_now() - enc_start;
 
         av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
 
@@ -960,7 +1394,9 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
         }
 
         output_packet(of, &pkt, ost, 0);
+        enc_start = stage_stats_now();
     }
+    stage_stats_update(&ost->encode_stats, enc_time + stage_stats_now() - enc_start, 1);
 
     return;
 error:
@@ -1065,6 +1501,7 @@ static void do_video_out(OutputFile *of,
     double delta, delta0;
     double duration = 0;
     int frame_size = 0;
+    int64_t enc_start, enc_time;
     InputStream *ist = NULL;
     AVFilterContext *filter = ost->filter->filter;
 
@@ -1285,6 +1722,18 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+#if HAVE_THREADS
+        if (ost->enc_thread_active) {
+            send_frame_to_encoder_thread(ost, in_picture);
+            av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
+            ost->sync_opts++;
+            ost->frame_number++;
+            continue;
+        }
+#endif
+
+        enc_start = stage_stats_now();
+        enc_time  = 0;
         ret = avcodec_send_frame(enc, in_picture);
         if (ret < 0)
             goto error;
@@ -1319,13 +1768,17 @@ static void do_video_out(OutputFile *of,
             }
 
             frame_size = pkt.size;
+            /* the muxing is timed separately */
+            enc_time += stage_stats_now() - enc_start;
             output_packet(of, &pkt, ost, 0);
+            enc_start = stage_stats_now();
 
             /* if two pass, output log */
             if (ost->logfile && enc->stats_out) {
                 fprintf(ost->logfile, "%s", enc->stats_out);
             }
         }
+        stage_stats_update(&ost->encode_stats, enc_time + stage_stats_now() - enc_start, 1);
         ost->sync_opts++;
         /*
          * For video, number of frames in == number of packets out.
@@ -1415,6 +1868,28 @@ static void finish_output_stream(OutputStream *ost)
     }
 }
 
+/**
+ * Get the next frame available on a filtergraph output, from the buffer sink
+ * or from the queue filled by the filtergraph thread.
+ */
+static int get_filtered_frame(OutputFilter *ofilter, AVFrame *frame)
+{
+#if HAVE_THREADS
+    if (ofilter->graph->thread_active) {
+        AVFrame *queued;
+        int ret = av_thread_message_queue_recv(ofilter->out_queue, &queued,
+                                               AV_THREAD_MESSAGE_NONBLOCK);
+        if (ret < 0)
+            return ret;
+        av_frame_move_ref(frame, queued);
+        av_frame_free(&queued);
+        return 0;
+    }
+#endif
+    return av_buffersink_get_frame_flags(ofilter->filter, frame,
+                                         AV_BUFFERSINK_FLAG_NO_REQUEST);
+}
+
 /**
  * Get and encode new output from any of the filtergraphs, without causing
  * activity.
@@ -1426,6 +1901,10 @@ static int reap_filters(int flush)
     AVFrame *filtered_frame = NULL;
     int i;
 
+#if HAVE_THREADS
+    reap_encoder_threads();
+#endif
+
     /* Reap all buffers present in the buffer sinks */
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
@@ -1455,8 +1934,7 @@ static int reap_filters(int flush)
 
         while (1) {
             double float_pts = AV_NOPTS_VALUE; // this is identical to filtered_frame.pts but with higher precision
-            ret = av_buffersink_get_frame_flags(filter, filtered_frame,
-                                               AV_BUFFERSINK_FLAG_NO_REQUEST);
+            ret = get_filtered_frame(ost->filter, filtered_frame);
             if (ret < 0) {
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_WARNING,
@@ -1492,7 +1970,8 @@ static int reap_filters(int flush)
 
             switch (av_buffersink_get_type(filter)) {
             case AVMEDIA_TYPE_VIDEO:
-                if (!ost->frame_aspect_ratio.num)
+                /* with -thread_encode, the encoding thread does this */
+                if (!ost->frame_aspect_ratio.num && !ost_encodes_on_thread(ost))
                     enc->sample_aspect_ratio = filtered_frame->sample_aspect_ratio;
 
                 if (debug_ts) {
@@ -1525,6 +2004,106 @@ static int reap_filters(int flush)
     return 0;
 }
 
+#if HAVE_THREADS
+/**
+ * Wait for the thread of fg to make progress or, with idle set, to process
+ * everything sent to it. Its output queues are emptied whenever it waits for
+ * room in them, so that it cannot stall.
+ */
+static int wait_filtergraph_thread(FilterGraph *fg, int idle)
+{
+    int done, reaped = 0, ret = 0;
+
+    pthread_mutex_lock(&fg->lock);
+    done = fg->thread_done;
+    while (!fg->thread_exited &&
+           (idle ? fg->thread_done != fg->thread_sent : fg->thread_done == done)) {
+        if (fg->thread_blocked && !reaped) {
+            pthread_mutex_unlock(&fg->lock);
+            ret = reap_filters(0);
+            pthread_mutex_lock(&fg->lock);
+            if (ret < 0)
+                break;
+            reaped = 1;
+            continue;
+        }
+        reaped = 0;
+        pthread_cond_wait(&fg->cond, &fg->lock);
+    }
+    pthread_mutex_unlock(&fg->lock);
+
+    return ret;
+}
+
+/**
+ * Queue a frame, or an EOF if frame is NULL, for an input of the graph, or a
+ * request for output if ifilter is NULL. Takes ownership of frame.
+ */
+static int send_to_filtergraph_thread(FilterGraph *fg, InputFilter *ifilter,
+                                      AVFrame *frame, int64_t pts)
+{
+    FilterGraphMessage msg = { -1, frame, pts };
+    int i, ret, full = 0;
+
+    for (i = 0; ifilter && i < fg->nb_inputs; i++)
+        if (fg->inputs[i] == ifilter)
+            msg.input = i;
+    av_assert0(!ifilter == (msg.input < 0));
+
+    while ((ret = av_thread_message_queue_send(fg->in_queue, &msg,
+                                               AV_THREAD_MESSAGE_NONBLOCK)) == AVERROR(EAGAIN)) {
+        if (!full++)
+            fg->in_queue_full++;
+        if ((ret = wait_filtergraph_thread(fg, 0)) < 0)
+            break;
+    }
+    if (ret < 0) {
+        av_frame_free(&msg.frame);
+        return ret;
+    }
+
+    fg->thread_sent++;
+    fg->in_queue_max = FFMAX(fg->in_queue_max,
+                             av_thread_message_queue_nb_elems(fg->in_queue));
+    return 0;
+}
+
+static int filtergraph_thread_has_output(FilterGraph *fg)
+{
+    int i;
+
+    for (i = 0; i < fg->nb_outputs; i++)
+        if (av_thread_message_queue_nb_elems(fg->outputs[i]->out_queue))
+            return 1;
+    return 0;
+}
+
+static void print_filtergraph_queues(AVBPrint *buf_script)
+{
+    int i, j;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        if (!fg->thread_active)
+            continue;
+        av_bprintf(buf_script, "filtergraph_%d_in_queue=%d\n", i,
+                   av_thread_message_queue_nb_elems(fg->in_queue));
+        av_bprintf(buf_script, "filtergraph_%d_in_queue_max=%d\n", i, fg->in_queue_max);
+        av_bprintf(buf_script, "filtergraph_%d_in_queue_full=%d\n", i, fg->in_queue_full);
+        pthread_mutex_lock(&fg->lock);
+        for (j = 0; j < fg->nb_outputs; j++) {
+            OutputFilter *ofilter = fg->outputs[j];
+            av_bprintf(buf_script, "filtergraph_%d_out_%d_queue=%d\n", i, j,
+                       av_thread_message_queue_nb_elems(ofilter->out_queue));
+            av_bprintf(buf_script, "filtergraph_%d_out_%d_queue_max=%d\n", i, j,
+                       ofilter->out_queue_max);
+        }
+        pthread_mutex_unlock(&fg->lock);
+    }
+}
+#endif
+
 static void print_final_stats(int64_t total_size)
 {
     uint64_t video_size = 0, audio_size = 0, extra_size = 0, other_size = 0;
@@ -1725,10 +2304,21 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 double scale, scale_sum = 0;
                 double p;
                 char type[3] = { 'Y','U','V' };
+                uint64_t enc_error[3];
+
+#if HAVE_THREADS
+                /* the encoding thread owns enc, use what it published */
+                if (ost->enc_thread_active) {
+                    pthread_mutex_lock(&ost->enc_lock);
+                    memcpy(enc_error, ost->enc_error, sizeof(enc_error));
+                    pthread_mutex_unlock(&ost->enc_lock);
+                } else
+#endif
+                memcpy(enc_error, enc->error, sizeof(enc_error));
                 av_bprintf(&buf, "PSNR=");
                 for (j = 0; j < 3; j++) {
                     if (is_last_report) {
-                        error = enc->error[j];
+                        error = enc_error[j];
                         scale = enc->width * enc->height * 255.0 * 255.0 * frame_number;
                     } else {
                         error = ost->error[j];
@@ -1803,6 +2393,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
         av_bprintf(&buf, " dup=%d drop=%d", nb_frames_dup, nb_frames_drop);
     av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+#if HAVE_THREADS
+    print_filtergraph_queues(&buf_script);
+#endif
+    if (stage_times)
+        print_all_stage_stats(&buf_script);
 
     if (speed < 0) {
         av_bprintf(&buf, " speed=N/A");
@@ -1904,6 +2499,20 @@ static void flush_encoders(void)
             }
         }
 
+#if HAVE_THREADS
+        if (ost->enc_thread_active) {
+            finish_encoder_thread(ost);
+            if (!(enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)) {
+                AVPacket pkt;
+                av_init_packet(&pkt);
+                pkt.data = NULL;
+                pkt.size = 0;
+                output_packet(of, &pkt, ost, 1);
+            }
+            continue;
+        }
+#endif
+
         if (enc->codec_type == AVMEDIA_TYPE_AUDIO && enc->frame_size <= 1)
             continue;
 
@@ -2171,6 +2780,11 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
             }
         }
 
+#if HAVE_THREADS
+        /* let the thread finish with the old graph before reaping it */
+        if (fg->thread_active && (ret = wait_filtergraph_thread(fg, 1)) < 0)
+            return ret;
+#endif
         ret = reap_filters(1);
         if (ret < 0 && ret != AVERROR_EOF) {
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2184,7 +2798,20 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
         }
     }
 
-    ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+#if HAVE_THREADS
+    if (fg->thread_active) {
+        AVFrame *tmp = av_frame_alloc();
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        av_frame_move_ref(tmp, frame);
+        ret = send_to_filtergraph_thread(fg, ifilter, tmp, 0);
+    } else
+#endif
+    {
+        int64_t filter_start = stage_stats_now();
+        ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+        stage_stats_update(&fg->filter_stats, stage_stats_now() - filter_start, 1);
+    }
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2201,6 +2828,11 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
     ifilter->eof = 1;
 
     if (ifilter->filter) {
+#if HAVE_THREADS
+        if (ifilter->graph->thread_active)
+            ret = send_to_filtergraph_thread(ifilter->graph, ifilter, NULL, pts);
+        else
+#endif
         ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
         if (ret < 0)
             return ret;
@@ -2276,6 +2908,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     AVFrame *decoded_frame;
     AVCodecContext *avctx = ist->dec_ctx;
     int ret, err = 0;
+    int64_t dec_start;
     AVRational decoded_frame_tb;
 
     if (!ist->decoded_frame && !(ist->decoded_frame = av_frame_alloc()))
@@ -2285,7 +2918,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output,
     decoded_frame = ist->decoded_frame;
 
     update_benchmark(NULL);
+    dec_start = stage_stats_now();
     ret = decode(avctx, decoded_frame, got_output, pkt);
+    stage_stats_update(&ist->decode_stats, stage_stats_now() - dec_start, *got_output);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -2339,6 +2974,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     int i, ret = 0, err = 0;
     int64_t best_effort_timestamp;
     int64_t dts = AV_NOPTS_VALUE;
+    int64_t dec_start;
     AVPacket avpkt;
 
     // With fate-indeo3-2, we're getting 0-sized packets before EOF for some
@@ -2370,7 +3006,9 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+    dec_start = stage_stats_now();
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
+    stage_stats_update(&ist->decode_stats, stage_stats_now() - dec_start, *got_output);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
         *decode_failed = 1;
@@ -3515,9 +4153,18 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
             return ret;
         }
         if (ost->enc->type == AVMEDIA_TYPE_AUDIO &&
-            !(ost->enc->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE))
+            !(ost->enc->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE)) {
+#if HAVE_THREADS
+            if (ost->filter->graph->thread_active)
+                pthread_mutex_lock(&ost->filter->graph->graph_lock);
+#endif
             av_buffersink_set_frame_size(ost->filter->filter,
                                             ost->enc_ctx->frame_size);
+#if HAVE_THREADS
+            if (ost->filter->graph->thread_active)
+                pthread_mutex_unlock(&ost->filter->graph->graph_lock);
+#endif
+        }
         assert_avoptions(ost->encoder_opts);
         if (ost->enc_ctx->bit_rate && ost->enc_ctx->bit_rate < 1000 &&
             ost->enc_ctx->codec_id != AV_CODEC_ID_CODEC2 /* don't complain about 700 bit/s modes */)
@@ -3627,8 +4274,27 @@ static int init_output_stream(OutputStream *ost, char *error, int error_len)
     if (ret < 0)
         return ret;
 
+#if HAVE_THREADS
+    if (thread_encode && ost->encoding_needed &&
+        (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO ||
+         ost->enc_ctx->codec_type == AVMEDIA_TYPE_AUDIO)) {
+        ret = init_encoder_thread(ost);
+        if (ret < 0)
+            return ret;
+    }
+#endif
+
     ost->initialized = 1;
 
+#if HAVE_THREADS
+    /* the filtergraph thread may start pulling frames for this stream now */
+    if (ost->filter && ost->filter->graph->thread_active) {
+        pthread_mutex_lock(&ost->filter->graph->lock);
+        ost->filter->thread_ready = 1;
+        pthread_mutex_unlock(&ost->filter->graph->lock);
+    }
+#endif
+
     ret = check_init_output_file(output_files[ost->file_index], ost->file_index);
     if (ret < 0)
         return ret;
@@ -3939,6 +4605,10 @@ static int check_keyboard_interaction(int64_t cur_time)
             for (i = 0; i < nb_filtergraphs; i++) {
                 FilterGraph *fg = filtergraphs[i];
                 if (fg->graph) {
+#if HAVE_THREADS
+                    if (fg->thread_active)
+                        pthread_mutex_lock(&fg->graph_lock);
+#endif
                     if (time < 0) {
                         ret = avfilter_graph_send_command(fg->graph, target, command, arg, buf, sizeof(buf),
                                                           key == 'c' ? AVFILTER_CMD_FLAG_ONE : 0);
@@ -3951,6 +4621,10 @@ static int check_keyboard_interaction(int64_t cur_time)
                         if (ret < 0)
                             fprintf(stderr, "Queuing command failed with error %s\n", av_err2str(ret));
                     }
+#if HAVE_THREADS
+                    if (fg->thread_active)
+                        pthread_mutex_unlock(&fg->graph_lock);
+#endif
                 }
             }
         } else {
@@ -4010,6 +4684,13 @@ static int check_keyboard_interaction(int64_t cur_time)
     return 0;
 }
 
+static void update_demux_stats(InputFile *f, const AVPacket *pkt, int64_t start)
+{
+    if (stage_times && pkt->stream_index < f->nb_streams)
+        stage_stats_update(&input_streams[f->ist_index + pkt->stream_index]->demux_stats,
+                           stage_stats_now() - start, 1);
+}
+
 #if HAVE_THREADS
 static void *input_thread(void *arg)
 {
@@ -4019,6 +4700,7 @@ static void *input_thread(void *arg)
 
     while (1) {
         AVPacket pkt;
+        int64_t demux_start = stage_stats_now();
         ret = av_read_frame(f->ctx, &pkt);
 
         if (ret == AVERROR(EAGAIN)) {
@@ -4029,6 +4711,15 @@ static void *input_thread(void *arg)
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
+        update_demux_stats(f, &pkt, demux_start);
+        if (f->thread_queue_bytes) {
+            pthread_mutex_lock(&f->queue_lock);
+            /* always let one packet through, however large */
+            while (f->queued_bytes && f->queued_bytes + pkt.size > f->thread_queue_bytes)
+                pthread_cond_wait(&f->queue_cond, &f->queue_lock);
+            f->queued_bytes += pkt.size;
+            pthread_mutex_unlock(&f->queue_lock);
+        }
         ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
@@ -4052,6 +4743,19 @@ static void *input_thread(void *arg)
     return NULL;
 }
 
+static int get_input_packet_mt(InputFile *f, AVPacket *pkt, unsigned flags)
+{
+    int ret = av_thread_message_queue_recv(f->in_thread_queue, pkt, flags);
+
+    if (ret >= 0 && f->thread_queue_bytes) {
+        pthread_mutex_lock(&f->queue_lock);
+        f->queued_bytes -= pkt->size;
+        pthread_cond_signal(&f->queue_cond);
+        pthread_mutex_unlock(&f->queue_lock);
+    }
+    return ret;
+}
+
 static void free_input_thread(int i)
 {
     InputFile *f = input_files[i];
@@ -4060,12 +4764,14 @@ static void free_input_thread(int i)
     if (!f || !f->in_thread_queue)
         return;
     av_thread_message_queue_set_err_send(f->in_thread_queue, AVERROR_EOF);
-    while (av_thread_message_queue_recv(f->in_thread_queue, &pkt, 0) >= 0)
+    while (get_input_packet_mt(f, &pkt, 0) >= 0)
         av_packet_unref(&pkt);
 
     pthread_join(f->thread, NULL);
     f->joined = 1;
     av_thread_message_queue_free(&f->in_thread_queue);
+    pthread_cond_destroy(&f->queue_cond);
+    pthread_mutex_destroy(&f->queue_lock);
 }
 
 static void free_input_threads(void)
@@ -4081,7 +4787,7 @@ static int init_input_thread(int i)
     int ret;
     InputFile *f = input_files[i];
 
-    if (nb_input_files == 1)
+    if (nb_input_files == 1 && !thread_input)
         return 0;
 
     if (f->ctx->pb ? !f->ctx->pb->seekable :
@@ -4091,10 +4797,15 @@ static int init_input_thread(int i)
                                         f->thread_queue_size, sizeof(AVPacket));
     if (ret < 0)
         return ret;
+    f->queued_bytes = 0;
+    pthread_mutex_init(&f->queue_lock, NULL);
+    pthread_cond_init(&f->queue_cond, NULL);
 
     if ((ret = pthread_create(&f->thread, NULL, input_thread, f))) {
         av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
         av_thread_message_queue_free(&f->in_thread_queue);
+        pthread_cond_destroy(&f->queue_cond);
+        pthread_mutex_destroy(&f->queue_lock);
         return AVERROR(ret);
     }
 
@@ -4112,17 +4823,13 @@ static int init_input_threads(void)
     }
     return 0;
 }
-
-static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
-{
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
-}
 #endif
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
 {
+    int64_t demux_start;
+    int ret;
+
     if (f->rate_emu) {
         int i;
         for (i = 0; i < f->nb_streams; i++) {
@@ -4135,10 +4842,18 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     }
 
 #if HAVE_THREADS
+    /* with a single input there is nothing else to read while waiting */
     if (nb_input_files > 1)
-        return get_input_packet_mt(f, pkt);
+        return get_input_packet_mt(f, pkt, f->non_blocking ?
+                                           AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (thread_input)
+        return get_input_packet_mt(f, pkt, 0);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    demux_start = stage_stats_now();
+    ret = av_read_frame(f->ctx, pkt);
+    if (ret >= 0)
+        update_demux_stats(f, pkt, demux_start);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -4514,6 +5229,77 @@ discard_packet:
     return 0;
 }
 
+#if HAVE_THREADS
+/**
+ * transcode_from_filter() for a graph running on its own thread: the thread
+ * does the requests, we only look at the state it leaves when it is idle.
+ */
+static int transcode_from_filter_thread(FilterGraph *graph, InputStream **best_ist)
+{
+    int i, ret, busy, nb_eof = 0;
+    int nb_requests, nb_requests_max = 0;
+    InputStream *ist = graph->thread_ist;
+
+    *best_ist = NULL;
+    if (filtergraph_thread_has_output(graph))
+        return reap_filters(0);
+
+    /* keep feeding the input the graph asked for last while it is busy,
+       instead of waiting for it to drain */
+    if (ist && !input_files[ist->file_index]->eagain &&
+        !input_files[ist->file_index]->eof_reached &&
+        av_thread_message_queue_nb_elems(graph->in_queue) < FFMAX(filter_thread_queue_size, 1)) {
+        pthread_mutex_lock(&graph->lock);
+        busy = graph->thread_done != graph->thread_sent;
+        pthread_mutex_unlock(&graph->lock);
+        if (busy) {
+            *best_ist = ist;
+            return 0;
+        }
+    }
+
+    if ((ret = wait_filtergraph_thread(graph, 1)) < 0)
+        return ret;
+    if (!filtergraph_thread_has_output(graph) &&
+        ((ret = send_to_filtergraph_thread(graph, NULL, NULL, 0)) < 0 ||
+         (ret = wait_filtergraph_thread(graph, 1)) < 0))
+        return ret;
+    if (filtergraph_thread_has_output(graph))
+        return reap_filters(0);
+
+    pthread_mutex_lock(&graph->lock);
+    for (i = 0; i < graph->nb_outputs; i++)
+        nb_eof += graph->outputs[i]->thread_eof;
+    for (i = 0; i < graph->nb_inputs; i++) {
+        ist = graph->inputs[i]->ist;
+        if (input_files[ist->file_index]->eagain ||
+            input_files[ist->file_index]->eof_reached)
+            continue;
+        nb_requests = graph->inputs[i]->thread_failed_requests;
+        if (nb_requests > nb_requests_max) {
+            nb_requests_max = nb_requests;
+            *best_ist = ist;
+        }
+    }
+    pthread_mutex_unlock(&graph->lock);
+
+    if (nb_eof == graph->nb_outputs) {
+        *best_ist = NULL;
+        ret = reap_filters(1);
+        for (i = 0; i < graph->nb_outputs; i++)
+            close_output_stream(graph->outputs[i]->ost);
+        return ret;
+    }
+
+    graph->thread_ist = *best_ist;
+    if (!*best_ist)
+        for (i = 0; i < graph->nb_outputs; i++)
+            graph->outputs[i]->ost->unavailable = 1;
+
+    return 0;
+}
+#endif
+
 /**
  * Perform a step of transcoding for the specified filter graph.
  *
@@ -4525,11 +5311,20 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 {
     int i, ret;
     int nb_requests, nb_requests_max = 0;
+    int64_t filter_start;
     InputFilter *ifilter;
     InputStream *ist;
 
+#if HAVE_THREADS
+    if (graph->thread_active)
+        return transcode_from_filter_thread(graph, best_ist);
+#endif
+
     *best_ist = NULL;
+    filter_start = stage_stats_now();
     ret = avfilter_graph_request_oldest(graph->graph);
+    /* accounted to the next frame sent to the graph */
+    stage_stats_update(&graph->filter_stats, stage_stats_now() - filter_start, 0);
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4757,6 +5552,7 @@ static int transcode(void)
  fail:
 #if HAVE_THREADS
     free_input_threads();
+    free_encoder_threads();
 #endif
 
     if (output_streams) {
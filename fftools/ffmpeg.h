@@ -120,6 +120,7 @@ typedef struct OptionsContext {
     int rate_emu;
     int accurate_seek;
     int thread_queue_size;
+    int64_t thread_queue_bytes;
 
     SpecifierOpt *ts_scale;
     int        nb_ts_scale;
@@ -232,6 +233,16 @@ typedef struct OptionsContext {
     int        nb_enc_time_bases;
 } OptionsContext;
 
+#define STAGE_STATS_BUCKETS 120
+
+/* per-call time of one processing stage, collected with -stage_times */
+typedef struct StageStats {
+    int64_t  nb;                    /* number of timed operations */
+    int64_t  total;                 /* total duration in microseconds */
+    int64_t  pending;               /* time spent towards the next operation */
+    uint32_t hist[STAGE_STATS_BUCKETS]; /* durations, 4 buckets per power of 2 */
+} StageStats;
+
 typedef struct InputFilter {
     AVFilterContext    *filter;
     struct InputStream *ist;
@@ -254,6 +265,10 @@ typedef struct InputFilter {
     AVBufferRef *hw_frames_ctx;
 
     int eof;
+
+#if HAVE_THREADS
+    int thread_failed_requests; /* failed requests of the buffer source, published by the filtergraph thread */
+#endif
 } InputFilter;
 
 typedef struct OutputFilter {
@@ -277,8 +292,24 @@ typedef struct OutputFilter {
     int *formats;
     uint64_t *channel_layouts;
     int *sample_rates;
+
+#if HAVE_THREADS
+    /* filtered frames handed over by the filtergraph thread, see -thread_filter */
+    AVThreadMessageQueue *out_queue;
+    int thread_ready;           /* the encoder is set up, frames may be pulled from the sink */
+    int thread_eof;             /* the sink returned EOF, nothing more will be queued */
+    int out_queue_max;          /* highest number of queued frames seen */
+#endif
 } OutputFilter;
 
+#if HAVE_THREADS
+typedef struct FilterGraphMessage {
+    int      input;             /* index into FilterGraph.inputs, -1 to request output */
+    AVFrame *frame;             /* NULL for EOF */
+    int64_t  pts;               /* timestamp of the EOF */
+} FilterGraphMessage;
+#endif
+
 typedef struct FilterGraph {
     int            index;
     const char    *graph_desc;
@@ -290,6 +321,25 @@ typedef struct FilterGraph {
     int          nb_inputs;
     OutputFilter **outputs;
     int         nb_outputs;
+
+    StageStats filter_stats;
+
+#if HAVE_THREADS
+    /* filtering on a dedicated thread, see -thread_filter */
+    pthread_t thread;
+    pthread_mutex_t graph_lock; /* held by whoever uses the AVFilterGraph */
+    pthread_mutex_t lock;       /* protects the thread state below, never held while filtering */
+    pthread_cond_t cond;        /* signalled whenever the thread makes progress */
+    AVThreadMessageQueue *in_queue; /* FilterGraphMessages waiting to be filtered */
+    int thread_active;          /* the thread has been started and not joined yet */
+    int thread_sent;            /* number of messages sent to the thread */
+    int thread_done;            /* number of messages fully processed by the thread */
+    int thread_blocked;         /* the thread waits for room in an output queue */
+    int thread_exited;          /* the thread stopped because of an error */
+    struct InputStream *thread_ist; /* input the graph asked for last */
+    int in_queue_max;           /* highest number of queued messages seen */
+    int in_queue_full;          /* number of times the main thread found the queue full */
+#endif
 } FilterGraph;
 
 typedef struct InputStream {
@@ -384,6 +434,9 @@ typedef struct InputStream {
     uint64_t frames_decoded;
     uint64_t samples_decoded;
 
+    StageStats demux_stats;
+    StageStats decode_stats;
+
     int64_t *dts_buffer;
     int nb_dts_buffer;
 
@@ -418,6 +471,10 @@ typedef struct InputFile {
     int non_blocking;           /* reading packets from the thread should not block */
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
+    int64_t thread_queue_bytes; /* maximum size of the queued packets, 0 for no limit */
+    int64_t queued_bytes;       /* size of the packets currently queued */
+    pthread_mutex_t queue_lock; /* protects queued_bytes */
+    pthread_cond_t queue_cond;  /* signalled whenever a packet is dequeued */
 #endif
 } InputFile;
 
@@ -549,6 +606,24 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    StageStats encode_stats;
+    StageStats mux_stats;
+
+#if HAVE_THREADS
+    /* encoding on a dedicated thread, see -thread_encode */
+    pthread_t enc_thread;
+    pthread_mutex_t enc_lock;
+    pthread_cond_t enc_cond;        /* signalled whenever either queue or the state changes */
+    AVFifoBuffer *enc_frame_queue;  /* AVFrame pointers waiting to be encoded */
+    AVFifoBuffer *enc_pkt_queue;    /* encoded AVPackets waiting to be muxed */
+    int enc_thread_active;          /* the thread has been started and not joined yet */
+    int enc_eof;                    /* no more frames will be queued */
+    int enc_abort;                  /* stop without flushing the encoder */
+    int enc_done;                   /* the thread has finished */
+    int enc_ret;                    /* error returned by the encoder, if any */
+    uint64_t enc_error[4];          /* enc_ctx->error as of the last queued packet, for print_report() */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -590,6 +665,7 @@ extern int video_sync_method;
 extern float frame_drop_threshold;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern int stage_times;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
@@ -609,7 +685,13 @@ extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern char *filter_complex_thread_type;
 extern int vstats_version;
+extern int thread_input;
+extern int thread_encode;
+extern int enc_thread_queue_size;
+extern int thread_filter;
+extern int filter_thread_queue_size;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -645,9 +727,20 @@ int ist_in_filtergraph(FilterGraph *fg, InputStream *ist);
 int filtergraph_is_simple(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
+#if HAVE_THREADS
+int init_filtergraph_thread(FilterGraph *fg);
+void free_filtergraph_thread(FilterGraph *fg);
+#endif
 
 void sub2video_update(InputStream *ist, AVSubtitle *sub);
 
+int64_t stage_stats_now(void);
+/**
+ * Add duration, in microseconds, to st. Calls with done unset only add to
+ * the time of the next operation, e.g. decoder calls that output no frame.
+ */
+void stage_stats_update(StageStats *st, int64_t duration, int done);
+
 int ifilter_parameters_from_frame(InputFilter *ifilter, const AVFrame *frame);
 
 int ffmpeg_parse_options(int argc, char **argv);
@@ -992,9 +992,229 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+#if HAVE_THREADS
+static void free_filtergraph_message(void *msg)
+{
+    FilterGraphMessage *m = msg;
+    av_frame_free(&m->frame);
+}
+
+static void free_filtered_frame(void *msg)
+{
+    av_frame_free(msg);
+}
+
+/**
+ * Hand a filtered frame over to the main thread, waiting for room in the
+ * queue if needed. The main thread empties the queues while it waits for us.
+ */
+static int send_filtered_frame(FilterGraph *fg, OutputFilter *ofilter, AVFrame **frame)
+{
+    int ret = av_thread_message_queue_send(ofilter->out_queue, frame,
+                                           AV_THREAD_MESSAGE_NONBLOCK);
+    if (ret == AVERROR(EAGAIN)) {
+        pthread_mutex_lock(&fg->lock);
+        fg->thread_blocked = 1;
+        pthread_cond_broadcast(&fg->cond);
+        pthread_mutex_unlock(&fg->lock);
+
+        ret = av_thread_message_queue_send(ofilter->out_queue, frame, 0);
+
+        pthread_mutex_lock(&fg->lock);
+        fg->thread_blocked = 0;
+        pthread_mutex_unlock(&fg->lock);
+    }
+    if (ret < 0)
+        return ret;
+
+    pthread_mutex_lock(&fg->lock);
+    ofilter->out_queue_max = FFMAX(ofilter->out_queue_max,
+                                   av_thread_message_queue_nb_elems(ofilter->out_queue));
+    pthread_mutex_unlock(&fg->lock);
+    return 0;
+}
+
+/* Move everything available in the buffer sinks to the output queues. */
+static int filtergraph_thread_reap(FilterGraph *fg)
+{
+    AVFrame *frame = NULL;
+    int i, ret = 0, ready;
+
+    for (i = 0; i < fg->nb_outputs; i++) {
+        OutputFilter *ofilter = fg->outputs[i];
+
+        while (1) {
+            if (!frame && !(frame = av_frame_alloc()))
+                return AVERROR(ENOMEM);
+
+            pthread_mutex_lock(&fg->lock);
+            ready = ofilter->thread_ready && !ofilter->thread_eof;
+            pthread_mutex_unlock(&fg->lock);
+
+            ret = AVERROR(EAGAIN);
+            if (ready) {
+                pthread_mutex_lock(&fg->graph_lock);
+                ret = av_buffersink_get_frame_flags(ofilter->filter, frame,
+                                                    AV_BUFFERSINK_FLAG_NO_REQUEST);
+                pthread_mutex_unlock(&fg->graph_lock);
+            }
+            if (ret == AVERROR_EOF) {
+                pthread_mutex_lock(&fg->lock);
+                ofilter->thread_eof = 1;
+                pthread_mutex_unlock(&fg->lock);
+            }
+
+            if (ret < 0) {
+                if (ret == AVERROR_EOF)
+                    av_thread_message_queue_set_err_recv(ofilter->out_queue, AVERROR_EOF);
+                else if (ret != AVERROR(EAGAIN))
+                    av_log(NULL, AV_LOG_WARNING,
+                           "Error in av_buffersink_get_frame_flags(): %s\n", av_err2str(ret));
+                break;
+            }
+
+            if ((ret = send_filtered_frame(fg, ofilter, &frame)) < 0) {
+                av_frame_free(&frame);
+                return ret;
+            }
+            frame = NULL;
+        }
+    }
+
+    av_frame_free(&frame);
+    return 0;
+}
+
+static void *filtergraph_thread(void *arg)
+{
+    FilterGraph *fg = arg;
+    FilterGraphMessage msg;
+    int64_t filter_start;
+    int i, ret;
+
+    while (av_thread_message_queue_recv(fg->in_queue, &msg, 0) >= 0) {
+        pthread_mutex_lock(&fg->graph_lock);
+        filter_start = stage_stats_now();
+        if (msg.input < 0)
+            ret = avfilter_graph_request_oldest(fg->graph);
+        else if (msg.frame)
+            ret = av_buffersrc_add_frame_flags(fg->inputs[msg.input]->filter, msg.frame,
+                                               AV_BUFFERSRC_FLAG_PUSH);
+        else
+            ret = av_buffersrc_close(fg->inputs[msg.input]->filter, msg.pts,
+                                     AV_BUFFERSRC_FLAG_PUSH);
+        stage_stats_update(&fg->filter_stats, stage_stats_now() - filter_start,
+                           msg.input >= 0 && msg.frame);
+        pthread_mutex_unlock(&fg->graph_lock);
+        av_frame_free(&msg.frame);
+
+        if (ret < 0 && ret != AVERROR_EOF && ret != AVERROR(EAGAIN))
+            av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
+
+        ret = filtergraph_thread_reap(fg);
+
+        pthread_mutex_lock(&fg->graph_lock);
+        pthread_mutex_lock(&fg->lock);
+        for (i = 0; i < fg->nb_inputs; i++)
+            fg->inputs[i]->thread_failed_requests =
+                av_buffersrc_get_nb_failed_requests(fg->inputs[i]->filter);
+        pthread_mutex_unlock(&fg->graph_lock);
+        fg->thread_done++;
+        if (ret < 0)
+            fg->thread_exited = 1;
+        pthread_cond_broadcast(&fg->cond);
+        pthread_mutex_unlock(&fg->lock);
+
+        if (ret < 0) {
+            if (ret != AVERROR_EOF)
+                av_log(NULL, AV_LOG_ERROR, "Filtergraph thread for graph %d failed: %s\n",
+                       fg->index, av_err2str(ret));
+            av_thread_message_queue_set_err_send(fg->in_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+void free_filtergraph_thread(FilterGraph *fg)
+{
+    int i;
+
+    if (!fg->thread_active)
+        return;
+
+    av_thread_message_queue_set_err_recv(fg->in_queue, AVERROR_EOF);
+    av_thread_message_flush(fg->in_queue);
+    for (i = 0; i < fg->nb_outputs; i++)
+        av_thread_message_queue_set_err_send(fg->outputs[i]->out_queue, AVERROR_EOF);
+    pthread_join(fg->thread, NULL);
+    fg->thread_active = 0;
+
+    av_thread_message_queue_free(&fg->in_queue);
+    for (i = 0; i < fg->nb_outputs; i++)
+        av_thread_message_queue_free(&fg->outputs[i]->out_queue);
+    pthread_cond_destroy(&fg->cond);
+    pthread_mutex_destroy(&fg->lock);
+    pthread_mutex_destroy(&fg->graph_lock);
+}
+
+int init_filtergraph_thread(FilterGraph *fg)
+{
+    int i, ret, queue_size = FFMAX(filter_thread_queue_size, 1);
+
+    if ((ret = av_thread_message_queue_alloc(&fg->in_queue, queue_size,
+                                             sizeof(FilterGraphMessage))) < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(fg->in_queue, free_filtergraph_message);
+
+    for (i = 0; i < fg->nb_outputs; i++) {
+        OutputFilter *ofilter = fg->outputs[i];
+        if ((ret = av_thread_message_queue_alloc(&ofilter->out_queue, queue_size,
+                                                 sizeof(AVFrame *))) < 0)
+            goto fail;
+        av_thread_message_queue_set_free_func(ofilter->out_queue, free_filtered_frame);
+        /* audio sinks must not be read before the encoder frame size is set */
+        ofilter->thread_ready = ofilter->ost->initialized;
+        ofilter->thread_eof   = 0;
+    }
+
+    fg->thread_sent    = 0;
+    fg->thread_done    = 0;
+    fg->thread_blocked = 0;
+    fg->thread_exited  = 0;
+    fg->thread_ist     = NULL;
+    for (i = 0; i < fg->nb_inputs; i++)
+        fg->inputs[i]->thread_failed_requests = 0;
+
+    pthread_mutex_init(&fg->graph_lock, NULL);
+    pthread_mutex_init(&fg->lock, NULL);
+    pthread_cond_init(&fg->cond, NULL);
+    if ((ret = pthread_create(&fg->thread, NULL, filtergraph_thread, fg))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        pthread_cond_destroy(&fg->cond);
+        pthread_mutex_destroy(&fg->lock);
+        pthread_mutex_destroy(&fg->graph_lock);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    fg->thread_active = 1;
+    return 0;
+
+fail:
+    av_thread_message_queue_free(&fg->in_queue);
+    for (i = 0; i < fg->nb_outputs; i++)
+        av_thread_message_queue_free(&fg->outputs[i]->out_queue);
+    return ret;
+}
+#endif
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+#if HAVE_THREADS
+    free_filtergraph_thread(fg);
+#endif
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -1051,6 +1271,10 @@ int configure_filtergraph(FilterGraph *fg)
             av_opt_set(fg->graph, "threads", e->value, 0);
     } else {
         fg->graph->nb_threads = filter_complex_nbthreads;
+        if (filter_complex_thread_type &&
+            (ret = av_opt_set(fg->graph, "thread_type",
+                              filter_complex_thread_type, 0)) < 0)
+            goto fail;
     }
 
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
@@ -1162,6 +1386,12 @@ int configure_filtergraph(FilterGraph *fg)
         }
     }
 
+#if HAVE_THREADS
+    /* from now on the graph belongs to its thread */
+    if (thread_filter && (ret = init_filtergraph_thread(fg)) < 0)
+        goto fail;
+#endif
+
     /* process queued up subtitle packets */
     for (i = 0; i < fg->nb_inputs; i++) {
         InputStream *ist = fg->inputs[i]->ist;
@@ -95,6 +95,7 @@ float frame_drop_threshold = 0;
 int do_deinterlace    = 0;
 int do_benchmark      = 0;
 int do_benchmark_all  = 0;
+int stage_times       = 0;
 int do_hex_dump       = 0;
 int do_pkt_dump       = 0;
 int copy_ts           = 0;
@@ -110,7 +111,13 @@ int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
 int filter_nbthreads = 0;
 int filter_complex_nbthreads = 0;
+char *filter_complex_thread_type;
 int vstats_version = 2;
+int thread_input = 0;
+int thread_encode = 0;
+int enc_thread_queue_size = 8;
+int thread_filter = 0;
+int filter_thread_queue_size = 8;
 
 
 static int intra_only         = 0;
@@ -1212,7 +1219,10 @@ static int open_input_file(OptionsContext *o, const char *filename)
     f->duration = 0;
     f->time_base = (AVRational){ 1, 1 };
 #if HAVE_THREADS
-    f->thread_queue_size = o->thread_queue_size > 0 ? o->thread_queue_size : 8;
+    f->thread_queue_bytes = FFMAX(o->thread_queue_bytes, 0);
+    /* when the size is bounded, the packet count should not be the limit */
+    f->thread_queue_size  = o->thread_queue_size > 0 ? o->thread_queue_size  :
+                            f->thread_queue_bytes   ? 1024 : 8;
 #endif
 
     /* check if all codec options have been used */
@@ -3446,6 +3456,8 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "stage_times",    OPT_BOOL | OPT_EXPERT,                       { &stage_times },
+      "report the per-call time of each stage and queue occupancy with -progress" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
@@ -3523,6 +3535,18 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_complex_thread_type", HAS_ARG | OPT_STRING | OPT_EXPERT, { &filter_complex_thread_type },
+        "set the thread types allowed in -filter_complex graphs", "slice|graph" },
+    { "thread_input",   OPT_BOOL | OPT_EXPERT,                       { &thread_input },
+        "read each input on its own thread, even if there is only one" },
+    { "thread_encode",  OPT_BOOL | OPT_EXPERT,                       { &thread_encode },
+        "encode each audio and video output stream on its own thread" },
+    { "enc_thread_queue_size", HAS_ARG | OPT_INT | OPT_EXPERT,       { &enc_thread_queue_size },
+        "maximum number of frames queued for each encoding thread", "size" },
+    { "thread_filter",  OPT_BOOL | OPT_EXPERT,                       { &thread_filter },
+        "run each filtergraph on its own thread" },
+    { "filter_thread_queue_size", HAS_ARG | OPT_INT | OPT_EXPERT,    { &filter_thread_queue_size },
+        "maximum number of frames queued in and out of each filtergraph thread", "size" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
@@ -3550,6 +3574,9 @@ const OptionDef options[] = {
     { "thread_queue_size", HAS_ARG | OPT_INT | OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
                                                                      { .off = OFFSET(thread_queue_size) },
         "set the maximum number of queued packets from the demuxer" },
+    { "thread_queue_bytes", HAS_ARG | OPT_INT64 | OPT_OFFSET | OPT_EXPERT | OPT_INPUT,
+                                                                     { .off = OFFSET(thread_queue_bytes) },
+        "set the maximum size of the queued packets from the demuxer", "size" },
     { "find_stream_info", OPT_BOOL | OPT_PERFILE | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
 
@@ -69,6 +69,10 @@ typedef struct InputStream {
     AVStream *st;
 
     AVCodecContext *dec_ctx;
+
+    /* used instead of the decoder with -parse_frames */
+    AVCodecParserContext *parser;
+    AVCodecContext *parser_ctx;
 } InputStream;
 
 typedef struct InputFile {
@@ -83,6 +87,7 @@ const int program_birth_year = 2007;
 
 static int do_bitexact = 0;
 static int do_count_frames = 0;
+static int do_parse_frames = 0;
 static int do_count_packets = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
@@ -131,10 +136,11 @@ static ReadInterval *read_intervals;
 static int read_intervals_nb = 0;
 
 static int find_stream_info  = 1;
+static int fast_probe = 0;
 
 /* section structure definition */
 
-#define SECTION_MAX_NB_CHILDREN 10
+#define SECTION_MAX_NB_CHILDREN 11
 
 struct section {
     int id;             ///< unique id identifying a section
@@ -158,6 +164,8 @@ typedef enum {
     SECTION_ID_CHAPTER_TAGS,
     SECTION_ID_CHAPTERS,
     SECTION_ID_ERROR,
+    SECTION_ID_FILE,
+    SECTION_ID_FILES,
     SECTION_ID_FORMAT,
     SECTION_ID_FORMAT_TAGS,
     SECTION_ID_FRAME,
@@ -205,6 +213,9 @@ static struct section sections[] = {
     [SECTION_ID_CHAPTER] =            { SECTION_ID_CHAPTER, "chapter", 0, { SECTION_ID_CHAPTER_TAGS, -1 } },
     [SECTION_ID_CHAPTER_TAGS] =       { SECTION_ID_CHAPTER_TAGS, "tags", SECTION_FLAG_HAS_VARIABLE_FIELDS, { -1 }, .element_name = "tag", .unique_name = "chapter_tags" },
     [SECTION_ID_ERROR] =              { SECTION_ID_ERROR, "error", 0, { -1 } },
+    [SECTION_ID_FILES] =              { SECTION_ID_FILES, "files", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FILE, -1 } },
+    [SECTION_ID_FILE] =               { SECTION_ID_FILE, "file", 0, { SECTION_ID_CHAPTERS, SECTION_ID_FORMAT, SECTION_ID_FRAMES, SECTION_ID_PROGRAMS,
+                                                                 SECTION_ID_STREAMS, SECTION_ID_PACKETS, SECTION_ID_ERROR, -1 } },
     [SECTION_ID_FORMAT] =             { SECTION_ID_FORMAT, "format", 0, { SECTION_ID_FORMAT_TAGS, -1 } },
     [SECTION_ID_FORMAT_TAGS] =        { SECTION_ID_FORMAT_TAGS, "tags", SECTION_FLAG_HAS_VARIABLE_FIELDS, { -1 }, .element_name = "tag", .unique_name = "format_tags" },
     [SECTION_ID_FRAMES] =             { SECTION_ID_FRAMES, "frames", SECTION_FLAG_IS_ARRAY, { SECTION_ID_FRAME, SECTION_ID_SUBTITLE, -1 } },
@@ -240,7 +251,7 @@ static struct section sections[] = {
     [SECTION_ID_ROOT] =               { SECTION_ID_ROOT, "root", SECTION_FLAG_IS_WRAPPER,
                                         { SECTION_ID_CHAPTERS, SECTION_ID_FORMAT, SECTION_ID_FRAMES, SECTION_ID_PROGRAMS, SECTION_ID_STREAMS,
                                           SECTION_ID_PACKETS, SECTION_ID_ERROR, SECTION_ID_PROGRAM_VERSION, SECTION_ID_LIBRARY_VERSIONS,
-                                          SECTION_ID_PIXEL_FORMATS, -1} },
+                                          SECTION_ID_PIXEL_FORMATS, SECTION_ID_FILES, -1} },
     [SECTION_ID_STREAMS] =            { SECTION_ID_STREAMS, "streams", SECTION_FLAG_IS_ARRAY, { SECTION_ID_STREAM, -1 } },
     [SECTION_ID_STREAM] =             { SECTION_ID_STREAM, "stream", 0, { SECTION_ID_STREAM_DISPOSITION, SECTION_ID_STREAM_TAGS, SECTION_ID_STREAM_SIDE_DATA_LIST, -1 } },
     [SECTION_ID_STREAM_DISPOSITION] = { SECTION_ID_STREAM_DISPOSITION, "disposition", 0, { -1 }, .unique_name = "stream_disposition" },
@@ -254,6 +265,8 @@ static const OptionDef *options;
 
 /* FFprobe context */
 static const char *input_filename;
+static const char *batch_filename;
+static int batch_threads;
 static AVInputFormat *iformat = NULL;
 
 static struct AVHashContext *hash;
@@ -2322,6 +2335,81 @@ static av_always_inline int process_frame(WriterContext *w,
     return got_frame || *packet_new;
 }
 
+/**
+ * Describe the frame in pkt from what the parser and the packet tell,
+ * without decoding it. One packet holds one frame.
+ */
+static void parse_frame(WriterContext *w, InputFile *ifile,
+                        AVFrame *frame, AVPacket *pkt)
+{
+    InputStream *ist = &ifile->streams[pkt->stream_index];
+    AVCodecParserContext *pc = ist->parser;
+    AVCodecParameters *par = ist->st->codecpar;
+
+    av_frame_unref(frame);
+    frame->key_frame = !!(pkt->flags & AV_PKT_FLAG_KEY);
+
+    if (pc) {
+        uint8_t *data;
+        int size;
+
+        /* not every parser sets them, do not report stale values */
+        pc->pict_type   = AV_PICTURE_TYPE_NONE;
+        pc->key_frame   = -1;
+        pc->duration    = 0;
+        av_parser_parse2(pc, ist->parser_ctx, &data, &size,
+                         pkt->data, pkt->size, pkt->pts, pkt->dts, pkt->pos);
+
+        if (pc->key_frame >= 0)
+            frame->key_frame = pc->key_frame;
+        frame->pict_type        = pc->pict_type;
+        frame->interlaced_frame = pc->field_order != AV_FIELD_UNKNOWN &&
+                                  pc->field_order != AV_FIELD_PROGRESSIVE;
+        frame->top_field_first  = pc->field_order == AV_FIELD_TT ||
+                                  pc->field_order == AV_FIELD_TB;
+        if (pc->width > 0 && pc->height > 0) {
+            frame->width  = pc->width;
+            frame->height = pc->height;
+        }
+        if (pc->format >= 0)
+            frame->format = pc->format;
+        if (pc->duration > 0)
+            frame->nb_samples = pc->duration;
+    }
+
+    switch (par->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (!frame->width) {
+            frame->width  = par->width;
+            frame->height = par->height;
+        }
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (!frame->nb_samples)
+            frame->nb_samples = par->frame_size;
+        if (!frame->nb_samples && pkt->duration > 0 && par->sample_rate > 0)
+            frame->nb_samples = av_rescale_q(pkt->duration, ist->st->time_base,
+                                             (AVRational){ 1, par->sample_rate });
+        frame->channels       = par->channels;
+        frame->channel_layout = par->channel_layout;
+        frame->sample_rate    = par->sample_rate;
+        break;
+    }
+    if (frame->format < 0)
+        frame->format = par->format;
+
+    frame->pts                   = pkt->pts;
+    frame->pkt_dts               = pkt->dts;
+    frame->best_effort_timestamp = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    frame->pkt_duration          = pkt->duration;
+    frame->pkt_pos               = pkt->pos;
+    frame->pkt_size              = pkt->size;
+
+    nb_streams_frames[pkt->stream_index]++;
+    if (do_show_frames)
+        show_frame(w, frame, ist->st, ifile->fmt_ctx);
+}
+
 static void log_read_interval(const ReadInterval *interval, void *log_ctx, int log_level)
 {
     av_log(log_ctx, log_level, "id:%d", interval->id);
@@ -2428,7 +2516,10 @@ static int read_interval_packets(WriterContext *w, InputFile *ifile,
             }
             if (do_read_frames) {
                 int packet_new = 1;
-                while (process_frame(w, ifile, frame, &pkt, &packet_new) > 0);
+                if (ifile->streams[pkt.stream_index].parser_ctx)
+                    parse_frame(w, ifile, frame, &pkt);
+                else
+                    while (process_frame(w, ifile, frame, &pkt, &packet_new) > 0);
             }
         }
         av_packet_unref(&pkt);
@@ -2652,6 +2743,23 @@ static int show_stream(WriterContext *w, AVFormatContext *fmt_ctx, int stream_id
     else                                print_str_opt("nb_read_frames", "N/A");
     if (nb_streams_packets[stream_idx]) print_fmt    ("nb_read_packets", "%"PRIu64, nb_streams_packets[stream_idx]);
     else                                print_str_opt("nb_read_packets", "N/A");
+    if (stream->inferred_fields) {
+        static const struct { int flag; const char *name; } inferred[] = {
+            { AVSTREAM_INFERRED_FRAME_RATE,     "frame_rate"     },
+            { AVSTREAM_INFERRED_DECODER_DELAY,  "has_b_frames"   },
+            { AVSTREAM_INFERRED_PIX_FMT,        "pix_fmt"        },
+            { AVSTREAM_INFERRED_SIZE,           "size"           },
+            { AVSTREAM_INFERRED_CHANNEL_LAYOUT, "channel_layout" },
+            { AVSTREAM_INFERRED_BIT_RATE,       "bit_rate"       },
+        };
+        int i;
+
+        av_bprint_clear(&pbuf);
+        for (i = 0; i < FF_ARRAY_ELEMS(inferred); i++)
+            if (stream->inferred_fields & inferred[i].flag)
+                av_bprintf(&pbuf, "%s%s", pbuf.len ? "+" : "", inferred[i].name);
+        print_str("inferred_fields", pbuf.str);
+    }
     if (do_show_data)
         writer_print_data(w, "extradata", par->extradata,
                                           par->extradata_size);
@@ -2841,30 +2949,44 @@ static int open_input_file(InputFile *ifile, const char *filename)
     int err, i;
     AVFormatContext *fmt_ctx = NULL;
     AVDictionaryEntry *t;
+    AVDictionary *fmt_opts = NULL;
     int scan_all_pmts_set = 0;
 
     fmt_ctx = avformat_alloc_context();
     if (!fmt_ctx) {
         print_error(filename, AVERROR(ENOMEM));
-        exit_program(1);
+        return AVERROR(ENOMEM);
     }
 
-    if (!av_dict_get(format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
-        av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    if (fast_probe)
+        fmt_ctx->flags |= AVFMT_FLAG_FAST_PROBE;
+
+    /* work on a copy, in batch mode several files are opened concurrently */
+    if ((err = av_dict_copy(&fmt_opts, format_opts, 0)) < 0) {
+        print_error(filename, err);
+        av_dict_free(&fmt_opts);
+        avformat_free_context(fmt_ctx);
+        return err;
+    }
+    if (!av_dict_get(fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
+        av_dict_set(&fmt_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
     }
     if ((err = avformat_open_input(&fmt_ctx, filename,
-                                   iformat, &format_opts)) < 0) {
+                                   iformat, &fmt_opts)) < 0) {
         print_error(filename, err);
+        av_dict_free(&fmt_opts);
         return err;
     }
     ifile->fmt_ctx = fmt_ctx;
     if (scan_all_pmts_set)
-        av_dict_set(&format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
-    if ((t = av_dict_get(format_opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        av_dict_set(&fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
+    t = av_dict_get(fmt_opts, "", NULL, AV_DICT_IGNORE_SUFFIX);
+    if (t)
         av_log(NULL, AV_LOG_ERROR, "Option %s not found.\n", t->key);
+    av_dict_free(&fmt_opts);
+    if (t)
         return AVERROR_OPTION_NOT_FOUND;
-    }
 
     if (find_stream_info) {
         AVDictionary **opts = setup_find_stream_info_opts(fmt_ctx, codec_opts);
@@ -2882,12 +3004,12 @@ static int open_input_file(InputFile *ifile, const char *filename)
         }
     }
 
-    av_dump_format(fmt_ctx, 0, filename, 0);
-
     ifile->streams = av_mallocz_array(fmt_ctx->nb_streams,
                                       sizeof(*ifile->streams));
-    if (!ifile->streams)
-        exit(1);
+    if (!ifile->streams) {
+        print_error(filename, AVERROR(ENOMEM));
+        return AVERROR(ENOMEM);
+    }
     ifile->nb_streams = fmt_ctx->nb_streams;
 
     /* bind a decoder to each input stream */
@@ -2898,6 +3020,25 @@ static int open_input_file(InputFile *ifile, const char *filename)
 
         ist->st = stream;
 
+        if (do_parse_frames &&
+            (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO ||
+             stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO)) {
+            ist->parser_ctx = avcodec_alloc_context3(NULL);
+            if (!ist->parser_ctx) {
+                print_error(filename, AVERROR(ENOMEM));
+                return AVERROR(ENOMEM);
+            }
+            err = avcodec_parameters_to_context(ist->parser_ctx, stream->codecpar);
+            if (err < 0) {
+                print_error(filename, err);
+                return err;
+            }
+            /* the demuxer already splits the packets into frames */
+            ist->parser = av_parser_init(stream->codecpar->codec_id);
+            if (ist->parser)
+                ist->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+        }
+
         if (stream->codecpar->codec_id == AV_CODEC_ID_PROBE) {
             av_log(NULL, AV_LOG_WARNING,
                    "Failed to probe codec for input stream %d\n",
@@ -2917,12 +3058,18 @@ static int open_input_file(InputFile *ifile, const char *filename)
                                                    fmt_ctx, stream, codec);
 
             ist->dec_ctx = avcodec_alloc_context3(codec);
-            if (!ist->dec_ctx)
-                exit(1);
+            if (!ist->dec_ctx) {
+                av_dict_free(&opts);
+                print_error(filename, AVERROR(ENOMEM));
+                return AVERROR(ENOMEM);
+            }
 
             err = avcodec_parameters_to_context(ist->dec_ctx, stream->codecpar);
-            if (err < 0)
-                exit(1);
+            if (err < 0) {
+                av_dict_free(&opts);
+                print_error(filename, err);
+                return err;
+            }
 
             if (do_show_log) {
                 // For loging it is needed to disable at least frame threads as otherwise
@@ -2938,17 +3085,21 @@ static int open_input_file(InputFile *ifile, const char *filename)
             ist->dec_ctx->coded_height = stream->codec->coded_height;
 #endif
 
-            if (avcodec_open2(ist->dec_ctx, codec, &opts) < 0) {
+            if ((err = avcodec_open2(ist->dec_ctx, codec, &opts)) < 0) {
                 av_log(NULL, AV_LOG_WARNING, "Could not open codec for input stream %d\n",
                        stream->index);
-                exit(1);
+                av_dict_free(&opts);
+                print_error(filename, err);
+                return err;
             }
 
             if ((t = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
                 av_log(NULL, AV_LOG_ERROR, "Option %s for input stream %d not found\n",
                        t->key, stream->index);
+                av_dict_free(&opts);
                 return AVERROR_OPTION_NOT_FOUND;
             }
+            av_dict_free(&opts);
         }
     }
 
@@ -2960,10 +3111,12 @@ static void close_input_file(InputFile *ifile)
 {
     int i;
 
-    /* close decoder for each stream */
-    for (i = 0; i < ifile->nb_streams; i++)
-        if (ifile->streams[i].st->codecpar->codec_id != AV_CODEC_ID_NONE)
-            avcodec_free_context(&ifile->streams[i].dec_ctx);
+    /* close decoder for each stream, open_input_file() may have stopped halfway */
+    for (i = 0; i < ifile->nb_streams; i++) {
+        avcodec_free_context(&ifile->streams[i].dec_ctx);
+        av_parser_close(ifile->streams[i].parser);
+        avcodec_free_context(&ifile->streams[i].parser_ctx);
+    }
 
     av_freep(&ifile->streams);
     ifile->nb_streams = 0;
@@ -2971,30 +3124,27 @@ static void close_input_file(InputFile *ifile)
     avformat_close_input(&ifile->fmt_ctx);
 }
 
-static int probe_file(WriterContext *wctx, const char *filename)
+static int probe_input_file(WriterContext *wctx, InputFile *ifile)
 {
-    InputFile ifile = { 0 };
-    int ret, i;
+    int ret = 0, i;
     int section_id;
 
     do_read_frames = do_show_frames || do_count_frames;
     do_read_packets = do_show_packets || do_count_packets;
 
-    ret = open_input_file(&ifile, filename);
-    if (ret < 0)
-        goto end;
+    av_dump_format(ifile->fmt_ctx, 0, ifile->fmt_ctx->url, 0);
 
 #define CHECK_END if (ret < 0) goto end
 
-    nb_streams = ifile.fmt_ctx->nb_streams;
-    REALLOCZ_ARRAY_STREAM(nb_streams_frames,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(nb_streams_packets,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(selected_streams,0,ifile.fmt_ctx->nb_streams);
+    nb_streams = ifile->fmt_ctx->nb_streams;
+    REALLOCZ_ARRAY_STREAM(nb_streams_frames,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(nb_streams_packets,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(selected_streams,0,ifile->fmt_ctx->nb_streams);
 
-    for (i = 0; i < ifile.fmt_ctx->nb_streams; i++) {
+    for (i = 0; i < ifile->fmt_ctx->nb_streams; i++) {
         if (stream_specifier) {
-            ret = avformat_match_stream_specifier(ifile.fmt_ctx,
-                                                  ifile.fmt_ctx->streams[i],
+            ret = avformat_match_stream_specifier(ifile->fmt_ctx,
+                                                  ifile->fmt_ctx->streams[i],
                                                   stream_specifier);
             CHECK_END;
             else
@@ -3004,7 +3154,7 @@ static int probe_file(WriterContext *wctx, const char *filename)
             selected_streams[i] = 1;
         }
         if (!selected_streams[i])
-            ifile.fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+            ifile->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
     }
 
     if (do_read_frames || do_read_packets) {
@@ -3017,33 +3167,31 @@ static int probe_file(WriterContext *wctx, const char *filename)
             section_id = SECTION_ID_FRAMES;
         if (do_show_frames || do_show_packets)
             writer_print_section_header(wctx, section_id);
-        ret = read_packets(wctx, &ifile);
+        ret = read_packets(wctx, ifile);
         if (do_show_frames || do_show_packets)
             writer_print_section_footer(wctx);
         CHECK_END;
     }
 
     if (do_show_programs) {
-        ret = show_programs(wctx, &ifile);
+        ret = show_programs(wctx, ifile);
         CHECK_END;
     }
 
     if (do_show_streams) {
-        ret = show_streams(wctx, &ifile);
+        ret = show_streams(wctx, ifile);
         CHECK_END;
     }
     if (do_show_chapters) {
-        ret = show_chapters(wctx, &ifile);
+        ret = show_chapters(wctx, ifile);
         CHECK_END;
     }
     if (do_show_format) {
-        ret = show_format(wctx, &ifile);
+        ret = show_format(wctx, ifile);
         CHECK_END;
     }
 
 end:
-    if (ifile.fmt_ctx)
-        close_input_file(&ifile);
     av_freep(&nb_streams_frames);
     av_freep(&nb_streams_packets);
     av_freep(&selected_streams);
@@ -3051,6 +3199,223 @@ end:
     return ret;
 }
 
+static int probe_file(WriterContext *wctx, const char *filename)
+{
+    InputFile ifile = { 0 };
+    int ret;
+
+    ret = open_input_file(&ifile, filename);
+    if (ret >= 0)
+        ret = probe_input_file(wctx, &ifile);
+    if (ifile.fmt_ctx)
+        close_input_file(&ifile);
+
+    return ret;
+}
+
+static int read_batch_list(const char *listname, char ***filenames, int *nb_filenames)
+{
+    FILE *f = strcmp(listname, "-") ? fopen(listname, "r") : stdin;
+    AVBPrint line;
+    int c, ret = 0;
+
+    if (!f) {
+        ret = AVERROR(errno);
+        print_error(listname, ret);
+        return ret;
+    }
+
+    /* one file per line, empty lines are skipped */
+    av_bprint_init(&line, 0, AV_BPRINT_SIZE_UNLIMITED);
+    do {
+        c = getc(f);
+        if (c != EOF && c != '\n') {
+            av_bprint_chars(&line, c, 1);
+            continue;
+        }
+        if (line.len && line.str[line.len - 1] == '\r')
+            line.str[--line.len] = 0;
+        if (line.len) {
+            char *filename = av_strdup(line.str);
+            if (!filename || av_dynarray_add_nofree(filenames, nb_filenames, filename) < 0) {
+                av_free(filename);
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+        }
+        av_bprint_clear(&line);
+    } while (c != EOF);
+    if (!av_bprint_is_complete(&line))
+        ret = AVERROR(ENOMEM);
+    av_bprint_finalize(&line, NULL);
+
+    if (f != stdin)
+        fclose(f);
+    return ret;
+}
+
+typedef struct BatchFile {
+    char *filename;
+    InputFile ifile;
+    int ret;
+    int opened;
+} BatchFile;
+
+typedef struct Batch {
+    BatchFile *files;
+    int nb_files;
+    int next;       ///< index of the next file to be opened
+    int done;       ///< number of files already printed and closed
+    int window;     ///< maximum number of files opened ahead of the output
+#if HAVE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} Batch;
+
+#if HAVE_THREADS
+static void *batch_thread(void *arg)
+{
+    Batch *b = arg;
+    BatchFile *bf;
+    int ret;
+
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        while (b->next < b->nb_files && b->next >= b->done + b->window)
+            pthread_cond_wait(&b->cond, &b->lock);
+        if (b->next >= b->nb_files)
+            break;
+        bf = &b->files[b->next++];
+        pthread_mutex_unlock(&b->lock);
+
+        ret = open_input_file(&bf->ifile, bf->filename);
+
+        pthread_mutex_lock(&b->lock);
+        bf->ret    = ret;
+        bf->opened = 1;
+        pthread_cond_broadcast(&b->cond);
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    return NULL;
+}
+#endif
+
+/**
+ * Probe every file of the list, opening them on a pool of threads and
+ * printing them in list order, each one within its own FILE section.
+ */
+static int probe_batch(WriterContext *wctx, const char *listname)
+{
+    Batch b = { 0 };
+    char **filenames = NULL;
+    int nb_threads = 0, ret, i;
+    int err = 0;
+#if HAVE_THREADS
+    pthread_t *threads = NULL;
+#endif
+
+    ret = read_batch_list(listname, &filenames, &b.nb_files);
+    if (ret < 0)
+        goto end;
+    b.files = av_mallocz_array(b.nb_files, sizeof(*b.files));
+    if (b.nb_files && !b.files) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < b.nb_files; i++)
+        b.files[i].filename = filenames[i];
+
+#if HAVE_THREADS
+    /* the frame logs are not attributed to a file, keep them in order */
+    if (!do_show_log) {
+        nb_threads = batch_threads > 0 ? batch_threads : av_cpu_count();
+        nb_threads = FFMIN(nb_threads, b.nb_files);
+    }
+    b.window = 2 * nb_threads;
+    if (nb_threads) {
+        threads = av_mallocz_array(nb_threads, sizeof(*threads));
+        if (!threads) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        pthread_mutex_init(&b.lock, NULL);
+        pthread_cond_init(&b.cond, NULL);
+        for (i = 0; i < nb_threads; i++) {
+            ret = pthread_create(&threads[i], NULL, batch_thread, &b);
+            if (ret) {
+                av_log(NULL, AV_LOG_WARNING, "Could not create a batch thread: %s\n",
+                       av_err2str(AVERROR(ret)));
+                break;
+            }
+        }
+        /* fall back to opening the files here if no thread could start */
+        nb_threads = i;
+        ret = 0;
+    }
+#endif
+
+    writer_print_section_header(wctx, SECTION_ID_FILES);
+    for (i = 0; i < b.nb_files; i++) {
+        BatchFile *bf = &b.files[i];
+
+#if HAVE_THREADS
+        if (nb_threads) {
+            pthread_mutex_lock(&b.lock);
+            while (!bf->opened)
+                pthread_cond_wait(&b.cond, &b.lock);
+            pthread_mutex_unlock(&b.lock);
+        } else
+#endif
+            bf->ret = open_input_file(&bf->ifile, bf->filename);
+
+        writer_print_section_header(wctx, SECTION_ID_FILE);
+        writer_print_string(wctx, "filename", bf->filename, 0);
+        ret = bf->ret;
+        if (ret >= 0)
+            ret = probe_input_file(wctx, &bf->ifile);
+        if (ret < 0) {
+            if (!err)
+                err = ret;
+            if (do_show_error)
+                show_error(wctx, ret);
+        }
+        writer_print_section_footer(wctx);
+
+        if (bf->ifile.fmt_ctx)
+            close_input_file(&bf->ifile);
+
+#if HAVE_THREADS
+        if (nb_threads) {
+            pthread_mutex_lock(&b.lock);
+            b.done = i + 1;
+            pthread_cond_broadcast(&b.cond);
+            pthread_mutex_unlock(&b.lock);
+        }
+#endif
+    }
+    writer_print_section_footer(wctx);
+    ret = err;
+
+end:
+#if HAVE_THREADS
+    if (threads) {
+        for (i = 0; i < nb_threads; i++)
+            pthread_join(threads[i], NULL);
+        pthread_mutex_destroy(&b.lock);
+        pthread_cond_destroy(&b.cond);
+        av_freep(&threads);
+    }
+#endif
+    for (i = 0; i < b.nb_files; i++)
+        av_freep(&filenames[i]);
+    av_freep(&filenames);
+    av_freep(&b.files);
+
+    return ret;
+}
+
 static void show_usage(void)
 {
     av_log(NULL, AV_LOG_INFO, "Simple multimedia streams analyzer\n");
@@ -3534,6 +3899,7 @@ static const OptionDef real_options[] = {
     { "show_chapters", 0, { .func_arg = &opt_show_chapters }, "show chapters info" },
     { "count_frames", OPT_BOOL, {(void*)&do_count_frames}, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, {(void*)&do_count_packets}, "count the number of packets per stream" },
+    { "parse_frames", OPT_BOOL, {(void*)&do_parse_frames}, "get the frames information from the parsers instead of decoding" },
     { "show_program_version",  0, { .func_arg = &opt_show_program_version },  "show ffprobe version" },
     { "show_library_versions", 0, { .func_arg = &opt_show_library_versions }, "show library versions" },
     { "show_versions",         0, { .func_arg = &opt_show_versions }, "show program and library versions" },
@@ -3544,8 +3910,16 @@ static const OptionDef real_options[] = {
     { "read_intervals", HAS_ARG, {.func_arg = opt_read_intervals}, "set read intervals", "read_intervals" },
     { "default", HAS_ARG | OPT_AUDIO | OPT_VIDEO | OPT_EXPERT, {.func_arg = opt_default}, "generic catch all option", "" },
     { "i", HAS_ARG, {.func_arg = opt_input_file_i}, "read specified file", "input_file"},
+    { "batch", OPT_STRING | HAS_ARG, {(void*)&batch_filename},
+      "probe each file listed in the specified file, one per line, - for stdin", "list_file" },
+#if HAVE_THREADS
+    { "batch_threads", OPT_INT | HAS_ARG, {(void*)&batch_threads},
+      "set the number of files opened in parallel in batch mode", "count" },
+#endif
     { "find_stream_info", OPT_BOOL | OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
+    { "fast_probe", OPT_BOOL | OPT_INPUT | OPT_EXPERT, { &fast_probe },
+        "trust the container codec parameters and decode only to fill missing ones" },
     { NULL, },
 };
 
@@ -3623,6 +3997,10 @@ int main(int argc, char **argv)
     SET_DO_SHOW(PROGRAM_STREAM_TAGS, stream_tags);
     SET_DO_SHOW(PACKET_TAGS, packet_tags);
 
+    /* the file name identifies each record in batch mode */
+    if (!sections[SECTION_ID_FILE].entries_to_show)
+        sections[SECTION_ID_FILE].show_all_entries = 1;
+
     if (do_bitexact && (do_show_program_version || do_show_library_versions)) {
         av_log(NULL, AV_LOG_ERROR,
                "-bitexact and -show_program_version or -show_library_versions "
@@ -3684,7 +4062,12 @@ int main(int argc, char **argv)
         if (do_show_pixel_formats)
             ffprobe_show_pixel_formats(wctx);
 
-        if (!input_filename &&
+        if (input_filename && batch_filename) {
+            av_log(NULL, AV_LOG_ERROR, "-batch cannot be used together with an input file.\n");
+            ret = AVERROR(EINVAL);
+        } else if (batch_filename) {
+            ret = probe_batch(wctx, batch_filename);
+        } else if (!input_filename &&
             ((do_show_format || do_show_programs || do_show_streams || do_show_chapters || do_show_packets || do_show_error) ||
              (!do_show_program_version && !do_show_library_versions && !do_show_pixel_formats))) {
             show_usage();
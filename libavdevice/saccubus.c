@@ -23,47 +23,76 @@
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
+#include "libavformat/internal.h"
 #include "libswscale/swscale.h"
-#include "saccubus_adapter.h"
+#include "compat/saccubus/saccubus_host.h"
 #include "avdevice.h"
 
-//ダイナミックロード
-#if HAVE_DLFCN_H
-#include <dlfcn.h>
-#else
-//dlfcn.hの無いWindows Mingw環境用
-#include <windows.h>
-#define dlopen(a,b) ((void*)LoadLibrary(a))
-#define dlsym(a,b) ((void*)GetProcAddress((HMODULE)(a),(b)))
-#define dlclose(a) FreeLibrary((HMODULE)(a));
-#define dlerror() "dlerror()"
-#define RTLD_NOW 0
-#endif
-
 #define SACC_DELIM '#'
 
 #define COLOR_FORMAT (AV_PIX_FMT_RGB32)
+#define OVERLAY_FORMAT (AV_PIX_FMT_RGB32)
 
 #define VIDEO_STREAM (0)
 #define AUDIO_STREAM (1)
 
+enum SaccJobState {
+	JOB_EMPTY = 0,
+	JOB_QUEUED,
+	JOB_RUNNING,
+	JOB_DONE,
+};
+
+/* 合成一回分の仕事 */
+typedef struct {
+	AVFrame* video;
+	AVBufferRef* buf;
+	AVBufferRef* overlayBuf;
+	uint8_t* overlay;
+	int64_t dts;
+	int64_t duration;
+	int64_t pos;
+	enum SaccJobState state;
+	int targetFlags;
+	int videoFlags;
+	int maxDirty;
+	int nbDirty;
+	SaccRect dirty[SACC_MAX_DIRTY_RECTS];
+	/* 計測用。ワーカーで測った分は、パケットにする時に足し込む */
+	int64_t processTime;
+	int64_t layoutTime;
+} SaccJob;
+
 typedef struct {
 	AVClass *klass;///< class for private options
 	int eof;
 	int videoCount;
 /* 動画管理 */
 	AVFormatContext *formatContext;
+	AVCodecContext *videoCodecContext;
 	int videoStreamIndex;
 	int audioStreamIndex;
+	int draining;
+	int64_t videoSkipUntil;
+	int64_t audioSkipUntil;
+	int seekFlags;
+	int threads;
+	int threadType;
 	AVFrame* rawFrame;
 	AVFrame* scaledFrame;
-	AVFrame* dstFrame;
 	struct SwsContext *swsContext;
-	int scaledBufferSize;
-	uint8_t* scaledBuffer;
+	enum AVPixelFormat pixFmt;
+	int surfaceFormat;
+	uint8_t* overlay;
+	int overlayLinesize;
 	int dstBufferSize;
-	uint8_t* dstBuffer;
+	AVBufferPool* dstPool;
+	AVBufferRef* prevBuf;
 	int srcWidth, srcHeight;
 	int scaledWidth, scaledHeight;
 	int dstWidth, dstHeight;
@@ -88,28 +117,68 @@ typedef struct {
 	SaccMeasureFnPtr saccMeasure;
 	SaccProcessFnPtr saccProcess;
 	SaccReleaseFnPtr saccRelease;
+/* SaccProcessの並列実行 */
+	int processThreads;
+	int inputEnded;
+	int nbJobs;
+	int jobHead;
+	int jobCount;
+	SaccJob* jobs;
+	AVBufferPool* overlayPool;
+#if HAVE_THREADS
+	int nbWorkers;
+	int workerQuit;
+	pthread_t* workers;
+	pthread_mutex_t jobLock;
+	pthread_cond_t jobQueued;
+	pthread_cond_t jobDone;
+#endif
+/* 段階毎の計測(マイクロ秒) */
+	int bench;
+	int64_t benchFrames;
+	int64_t benchDecode;
+	int64_t benchScale;
+	int64_t benchProcess;
+	int64_t benchLayout;
 } SaccContext;
 
 
 static av_cold int SaccContext_init(AVFormatContext *avctx);
 static av_cold int SaccContext_delete(AVFormatContext *avctx);
 static int SaccContext_readPacket(AVFormatContext *avctx, AVPacket *pkt);
+static int SaccContext_readSeek(AVFormatContext *avctx, int stream_index, int64_t timestamp, int flags);
 
 static void SaccContext_clear(SaccContext* const self);
 static void SaccContext_closeCodec(SaccContext* const self);
 static int SaccContext_configureAdapter(SaccContext* const self, const char* const filename);
 static int SaccContext_loadAdapter(SaccContext* const self, const char* const filename);
 static void SaccContext_releaseAdapter(SaccContext* const self);
+static int SaccContext_startWorkers(SaccContext* const self);
+static void SaccContext_stopWorkers(SaccContext* const self);
 static int SaccToolBox_loadVideo(SaccToolBox* const box, const char* const filename);
+static int SaccToolBox_seek(SaccToolBox* const box, double pts);
+static int SaccContext_seek(SaccContext* const self, double pts, int flags);
 
 //---------------------------------------------------------------------------------------------------------------------
 #define OFFSET(x) offsetof(SaccContext, x)
 #define DEC AV_OPT_FLAG_DECODING_PARAM
+#define BENCH (AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY)
 static const AVOption options[] = {
 	{ "sacc", "SaccubusArgs", OFFSET(arg),  AV_OPT_TYPE_STRING, {.str = NULL }, 0,  0, DEC },
 	{ "width", "width", OFFSET(scaledWidth), AV_OPT_TYPE_INT, {.dbl = 0}, 0, INT_MAX, DEC},
 	{ "height", "height", OFFSET(scaledHeight), AV_OPT_TYPE_INT, {.dbl = 0}, 0, INT_MAX, DEC},
 	{ "minfps", "Minimum fps", OFFSET(minfps), AV_OPT_TYPE_INT, {.dbl = 0}, 0, DBL_MAX, DEC},
+	{ "threads", "number of video decoding threads (0 = auto)", OFFSET(threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, DEC},
+	{ "thread_type", "video decoding threading methods", OFFSET(threadType), AV_OPT_TYPE_FLAGS, {.i64 = FF_THREAD_SLICE|FF_THREAD_FRAME}, 0, INT_MAX, DEC, "thread_type"},
+	{ "slice", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_SLICE}, INT_MIN, INT_MAX, DEC, "thread_type"},
+	{ "frame", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = FF_THREAD_FRAME}, INT_MIN, INT_MAX, DEC, "thread_type"},
+	{ "process_threads", "number of threads running a reentrant SaccProcess (0 = run inline)", OFFSET(processThreads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, DEC},
+	{ "bench", "measure the time spent in each stage and log it on close", OFFSET(bench), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC},
+	{ "bench_frames", "number of video packets output", OFFSET(benchFrames), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, BENCH},
+	{ "bench_decode", "microseconds spent demuxing and decoding", OFFSET(benchDecode), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, BENCH},
+	{ "bench_scale", "microseconds spent in sws_scale", OFFSET(benchScale), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, BENCH},
+	{ "bench_process", "microseconds spent in SaccProcess, summed over worker threads", OFFSET(benchProcess), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, BENCH},
+	{ "bench_layout", "microseconds spent placing video, blending the overlay and building packets", OFFSET(benchLayout), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, BENCH},
 	{ NULL },
 };
 
@@ -127,7 +196,8 @@ AVInputFormat ff_saccubus_demuxer = {
 	.read_header	= SaccContext_init,
 	.read_packet	= SaccContext_readPacket,
 	.read_close	 = SaccContext_delete,
-	.flags		  = AVFMT_NOFILE,
+	.read_seek	  = SaccContext_readSeek,
+	.flags		  = AVFMT_NOFILE | AVFMT_NO_BYTE_SEEK | AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH,
 	.priv_class	 = &avklass,
 };
 //---------------------------------------------------------------------------------------------------------------------
@@ -138,31 +208,40 @@ static av_cold int SaccContext_init(AVFormatContext *avctx)
 	SaccContext_clear(self);
 	if(SaccContext_loadAdapter(self, avctx->filename) < 0) return -1;
 	if(SaccContext_configureAdapter(self, avctx->filename) < 0) return -1;
+	if(!self->formatContext){
+		av_log(self, AV_LOG_ERROR, "The adapter did not load any video.\n");
+		return AVERROR(EINVAL);
+	}
+	if(self->toolbox.surfaceFormat != self->surfaceFormat){
+		/* バッファはloadVideoの時の形式で用意してあるので、後から変えられない */
+		av_log(self, AV_LOG_ERROR, "The surface format was changed after loadVideo.\n");
+		return AVERROR(EINVAL);
+	}
 
 	{ /* VIDEOストリームの初期化 */
 		AVStream *st;
 		const AVStream *orig = self->formatContext->streams[self->videoStreamIndex];
+		AVRational frameRate = orig->r_frame_rate;
+		AVRational timeBase = orig->time_base;
 		if (!(st = avformat_new_stream(avctx, NULL))){
 			return AVERROR(ENOMEM);
 		}
 		st->id = VIDEO_STREAM;
-		st->codec->codec_type = AVMEDIA_TYPE_VIDEO;
+		st->codecpar->codec_type			= AVMEDIA_TYPE_VIDEO;
+		st->codecpar->codec_id				= AV_CODEC_ID_RAWVIDEO;
+		st->codecpar->format				= self->pixFmt;
 
-		st->codec->codec_id					= AV_CODEC_ID_RAWVIDEO;
-		st->codec->pix_fmt					= COLOR_FORMAT;
-
-		st->r_frame_rate					= orig->r_frame_rate;
-		st->start_time						= orig->start_time;
-		st       ->time_base				= orig       ->time_base;
-		st->codec->time_base				= orig->codec->time_base;
 		if(self->minfps > 0){
-			self->fpsFactor = ceil((double)self->minfps*st->r_frame_rate.den/st->r_frame_rate.num);
-			st       ->time_base.den *= self->fpsFactor;
-			st->codec->time_base.den *= self->fpsFactor;
-			st->r_frame_rate.num *= self->fpsFactor;
+			self->fpsFactor = ceil((double)self->minfps*frameRate.den/frameRate.num);
+			timeBase.den *= self->fpsFactor;
+			frameRate.num *= self->fpsFactor;
 		}else{
 			self->fpsFactor = 1;
 		}
+		avpriv_set_pts_info(st, 64, timeBase.num, timeBase.den);
+		st->r_frame_rate					= frameRate;
+		st->avg_frame_rate					= frameRate;
+		st->start_time						= orig->start_time;
 		{
 			AVRational sec = { st->time_base.den, st->time_base.num };
 			self->dstFrameTime = av_div_q(sec, st->r_frame_rate);
@@ -174,135 +253,592 @@ static av_cold int SaccContext_init(AVFormatContext *avctx)
 		self->pktDts = AV_NOPTS_VALUE;
 		av_log(self, AV_LOG_WARNING, "FPS Factor: %d (%f -> %f), min %dfps\n",
 				self->fpsFactor,
-				(double)self->formatContext->streams[self->videoStreamIndex]->r_frame_rate.num/self->formatContext->streams[self->videoStreamIndex]->r_frame_rate.den,
-				(double)st->r_frame_rate.num/st->r_frame_rate.den,
+				av_q2d(orig->r_frame_rate),
+				av_q2d(st->r_frame_rate),
 				self->minfps
 				);
 
-		st->codec->width					= self->dstWidth;
-		st->codec->height					= self->dstHeight;
+		st->codecpar->width					= self->dstWidth;
+		st->codecpar->height				= self->dstHeight;
 
-		st       ->sample_aspect_ratio	= self->formatContext->streams[self->videoStreamIndex]       ->sample_aspect_ratio;
-		st->codec->sample_aspect_ratio	= self->formatContext->streams[self->videoStreamIndex]->codec->sample_aspect_ratio;
+		st->sample_aspect_ratio				= orig->sample_aspect_ratio;
+		st->codecpar->sample_aspect_ratio	= orig->codecpar->sample_aspect_ratio;
 	}
 	
-	{ /* AUDIOストリームの初期化 */
+	if(self->audioStreamIndex >= 0){ /* AUDIOストリームの初期化 */
 		const AVStream *orig = self->formatContext->streams[self->audioStreamIndex];
 		AVStream *st;
-		if (!(st = avformat_new_stream(avctx, self->formatContext->streams[self->audioStreamIndex]->codec->codec))){
+		int ret;
+		if (!(st = avformat_new_stream(avctx, NULL))){
 			return AVERROR(ENOMEM);
 		}
+		if ((ret = avcodec_parameters_copy(st->codecpar, orig->codecpar)) < 0){
+			return ret;
+		}
 		st->id				= AUDIO_STREAM;
+		avpriv_set_pts_info(st, 64, orig->time_base.num, orig->time_base.den);
 		st->r_frame_rate	= orig->r_frame_rate;
-		st->pts				= orig->pts;
-		st->duration		= orig->duration;
 		st->duration		= orig->duration;
 		st->nb_frames		= orig->nb_frames;
-		st->nb_index_entries= orig->nb_index_entries;
 		st->start_time		= orig->start_time;
-		st->time_base		= orig->time_base;
 		st->discard			= orig->discard;
 		st->disposition		= orig->disposition;
-		avcodec_copy_context(st->codec, orig->codec);
 	}
-	return 0;
+	return SaccContext_startWorkers(self);
 }
 
 static av_cold int SaccContext_delete(AVFormatContext *avctx)
 {
 	SaccContext* const self = (SaccContext*)avctx->priv_data;
 	av_log(self, AV_LOG_WARNING, "Closing...\n");
+	SaccContext_stopWorkers(self);
+	if(self->bench && self->benchFrames > 0){
+		const double n = self->benchFrames * 1000.0;
+		av_log(self, AV_LOG_INFO, "bench: %"PRId64" frames, per frame decode=%.3fms scale=%.3fms process=%.3fms layout=%.3fms\n",
+				self->benchFrames, self->benchDecode / n, self->benchScale / n, self->benchProcess / n, self->benchLayout / n);
+	}
 	SaccContext_closeCodec(self);
 	SaccContext_releaseAdapter(self);
 	SaccContext_clear(self);
 	return 0;
 }
 
-static int createVideoPacket(SaccContext* const self, AVPacket *pkt)
+static int64_t SaccContext_benchStart(const SaccContext* const self)
+{
+	return self->bench ? av_gettime_relative() : 0;
+}
+
+static void SaccContext_benchStop(const SaccContext* const self, int64_t* const total, int64_t const start)
+{
+	if(self->bench){
+		*total += av_gettime_relative() - start;
+	}
+}
+
+static void SaccFrame_fill(SaccFrame* const frame, double const vpos, int const format, uint8_t* const data[], const int linesize[], int const w, int const h)
+{
+	const int nbPlanes = format == SACC_SURFACE_YUV420P ? 3 : format == SACC_SURFACE_NV12 ? 2 : 1;
+	frame->vpos = vpos;
+	frame->data = data[0];
+	frame->linesize = linesize[0];
+	frame->w = w;
+	frame->h = h;
+	frame->format = format;
+	for(int i=0;i<4;++i){
+		frame->planes[i] = i < nbPlanes ? data[i] : NULL;
+		frame->linesizes[i] = i < nbPlanes ? linesize[i] : 0;
+	}
+}
+
+static void SaccContext_placeVideo(SaccContext* const self, const AVFrame* const video, uint8_t* const dst[4], const int dstLinesize[4],
+		int const x0, int const y0, int const x1, int const y1)
 {
-	const int64_t dstDts = self->pktDts+(self->dstFrameTime.num*(self->fpsFactor-self->frameLeft)/self->dstFrameTime.den);
+	/**
+	 * 重ね合わせモード用。dstの(x0,y0)-(x1,y1)を黒で埋めて、スケール済みの動画を中央に置く。
+	 * YUV420Pなので、位置は偶数に揃える。
+	 */
+	const int w = FFMIN(self->scaledWidth, self->dstWidth);
+	const int h = FFMIN(self->scaledHeight, self->dstHeight);
+	const int x = ((self->dstWidth - w) / 2) & ~1;
+	const int y = ((self->dstHeight - h) / 2) & ~1;
+	for(int i=0;i<3;++i){
+		const int shift = i ? 1 : 0;
+		const int vx0 = x >> shift, vx1 = vx0 + AV_CEIL_RSHIFT(w, shift);
+		const int vy0 = y >> shift, vy1 = vy0 + AV_CEIL_RSHIFT(h, shift);
+		const int rx0 = x0 >> shift, rx1 = AV_CEIL_RSHIFT(x1, shift);
+		const int cx0 = FFMAX(rx0, vx0), cx1 = FFMIN(rx1, vx1);
+		for(int row = y0 >> shift; row < AV_CEIL_RSHIFT(y1, shift); ++row){
+			uint8_t* const line = dst[i] + row * dstLinesize[i];
+			if(row < vy0 || row >= vy1 || cx0 >= cx1){
+				memset(line + rx0, i ? 128 : 16, rx1 - rx0);
+				continue;
+			}
+			if(rx0 < cx0){
+				memset(line + rx0, i ? 128 : 16, cx0 - rx0);
+			}
+			memcpy(line + cx0, video->data[i] + (row - vy0) * video->linesize[i] + (cx0 - vx0), cx1 - cx0);
+			if(cx1 < rx1){
+				memset(line + cx1, i ? 128 : 16, rx1 - cx1);
+			}
+		}
+	}
+}
+
+static void SaccContext_composeOverlay(SaccContext* const self, const SaccJob* const job, uint8_t* const dst[4], const int dstLinesize[4],
+		int x0, int y0, int x1, int y1)
+{
+	/* 2x2単位に広げて、画面内に収める */
+	x0 = av_clip(x0 & ~1, 0, self->dstWidth);
+	y0 = av_clip(y0 & ~1, 0, self->dstHeight);
+	x1 = av_clip(FFALIGN(x1, 2), 0, self->dstWidth);
+	y1 = av_clip(FFALIGN(y1, 2), 0, self->dstHeight);
+	if(x0 >= x1 || y0 >= y1){
+		return;
+	}
+	SaccContext_placeVideo(self, job->video, dst, dstLinesize, x0, y0, x1, y1);
+	/* プリマルチプライドRGBAの層を、αが0でない画素だけYUVに変換して合成する(フィルタと共通) */
+	sacc_blend_overlay(dst, dstLinesize, job->overlay, self->overlayLinesize, x0, y0, x1, y1);
+}
+
+static void SaccContext_composeJob(SaccContext* const self, SaccJob* const job)
+{
+	/* 重ね合わせモードで、出力全体を動画と層から作り直す */
+	const int64_t start = SaccContext_benchStart(self);
+	uint8_t* dstData[4];
+	int dstLinesize[4];
+	av_image_fill_arrays(dstData, dstLinesize, job->buf->data, self->pixFmt, self->dstWidth, self->dstHeight, 1);
+	SaccContext_composeOverlay(self, job, dstData, dstLinesize, 0, 0, self->dstWidth, self->dstHeight);
+	SaccContext_benchStop(self, &job->layoutTime, start);
+}
+
+static int SaccContext_isLegacy(const SaccContext* const self)
+{
+	/**
+	 * v3の設定を何もしていないプラグインは、v2までと同じく
+	 * targetに前回の合成結果が残っている前提で描いているかもしれない。
+	 */
+	return sacc_is_legacy(&self->toolbox);
+}
+
+static int SaccContext_prepareJob(SaccContext* const self, SaccJob* const job)
+{
+	job->dts = self->pktDts+(self->dstFrameTime.num*(self->fpsFactor-self->frameLeft)/self->dstFrameTime.den);
+	job->duration = self->pktDuration;
+	job->pos = self->pktPos;
+	job->processTime = 0;
+	job->layoutTime = 0;
 	self->frameLeft--;
+	/**
+	 * プールから取ったバッファに直接合成して、そのままパケットとして渡す。
+	 * rawvideoデコーダは参照カウント付きのパケットをコピーせずに使うので、
+	 * フレーム毎のmemcpyが要らなくなる。
+	 */
+	if(!(job->buf = av_buffer_pool_get(self->dstPool))){
+		return AVERROR(ENOMEM);
+	}
+	return 0;
+}
 
-	{ /* dstにさきゅばすを合成 */
-		double const pts = dstDts * av_q2d(self->dstTimebase);
-		SaccFrame dstFrame;
-		{
-			dstFrame.vpos = pts;
-			dstFrame.data = self->dstFrame->data[self->dstFrame->display_picture_number];
-			dstFrame.linesize = self->dstFrame->linesize[self->dstFrame->display_picture_number];
-			dstFrame.w = self->dstWidth;
-			dstFrame.h = self->dstHeight;
+static int SaccContext_processJob(SaccContext* const self, SaccJob* const job)
+{
+	/* dstにさきゅばすを合成 */
+	double const pts = job->dts * av_q2d(self->dstTimebase);
+	SaccFrame dstFrame;
+	SaccFrame videoFrame;
+	uint8_t* dstData[4];
+	int dstLinesize[4];
+	int64_t start;
+	int result;
+	av_image_fill_arrays(dstData, dstLinesize, job->buf->data, self->pixFmt, self->dstWidth, self->dstHeight, 1);
+	if(self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY){
+		/* 動画はこちらで置いて、プラグインには重ね合わせ層だけ描いてもらう */
+		SaccFrame_fill(&dstFrame, pts, SACC_SURFACE_RGBA_OVERLAY, &job->overlay, &self->overlayLinesize, self->dstWidth, self->dstHeight);
+	}else{
+		SaccFrame_fill(&dstFrame, pts, self->toolbox.surfaceFormat, dstData, dstLinesize, self->dstWidth, self->dstHeight);
+	}
+	SaccFrame_fill(&videoFrame, pts,
+			self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY ? SACC_SURFACE_YUV420P : self->toolbox.surfaceFormat,
+			job->video->data, job->video->linesize, self->scaledWidth, self->scaledHeight);
+	dstFrame.flags = job->targetFlags;
+	dstFrame.dirty = job->maxDirty > 0 ? job->dirty : NULL;
+	dstFrame.maxDirty = job->maxDirty;
+	videoFrame.flags = job->videoFlags;
+	start = SaccContext_benchStart(self);
+	result = self->saccProcess(self->saccPriv, &self->toolbox, &dstFrame, &videoFrame);
+	SaccContext_benchStop(self, &job->processTime, start);
+	if(SaccContext_isLegacy(self)){
+		/* v2までの戻り値には意味がないので、全部描いたものとして扱う */
+		return 0;
+	}
+	job->nbDirty = av_clip(dstFrame.nbDirty, 0, job->maxDirty);
+	if((job->targetFlags & SACC_FRAME_FULL_REDRAW) || (result != SACC_PROCESS_UNCHANGED && result != SACC_PROCESS_DIRTY)){
+		result = 0;
+	}
+	if(self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY){
+		/* 動画が変わったなら、層が同じでも全部置き直す */
+		if(result == 0 || !(job->videoFlags & SACC_FRAME_SAME_VIDEO)){
+			SaccContext_composeJob(self, job);
+			result = 0;
 		}
-		SaccFrame videoFrame;
-		{
-			videoFrame.vpos = pts;
-			videoFrame.data = self->scaledFrame->data[self->scaledFrame->display_picture_number];
-			videoFrame.linesize = self->scaledFrame->linesize[self->scaledFrame->display_picture_number];
-			videoFrame.w = self->scaledWidth;
-			videoFrame.h = self->scaledHeight;
+	}else if((result == SACC_PROCESS_UNCHANGED && !(job->videoFlags & SACC_FRAME_SAME_VIDEO)) ||
+	         (result == SACC_PROCESS_DIRTY && !(job->targetFlags & SACC_FRAME_PREVIOUS))){
+		av_log(self, AV_LOG_WARNING, "Ignoring result %d of SaccProcess not allowed here.\n", result);
+		result = 0;
+	}
+	return result;
+}
+
+static void SaccContext_finishJob(SaccContext* const self, SaccJob* const job, AVPacket *pkt)
+{
+	/* パケットの構築 */
+	pkt->buf = job->buf;
+	pkt->data = job->buf->data;
+	pkt->size = self->dstBufferSize;
+	pkt->stream_index = VIDEO_STREAM;
+	pkt->duration = job->duration;
+	pkt->dts = job->dts;
+	pkt->pts = job->dts;
+	pkt->pos = job->pos;
+	job->buf = NULL;
+	self->benchFrames++;
+	self->benchProcess += job->processTime;
+	self->benchLayout += job->layoutTime;
+}
+
+static int createVideoPacket(SaccContext* const self, AVPacket *pkt)
+{
+	/**
+	 * 同じ動画フレームが続く間は、プラグインが「変わっていない」「ここだけ変わった」と
+	 * 教えてくれれば、前回の出力を使い回したり、その部分だけ合成し直したりする。
+	 */
+	const int sameVideo = self->frameLeft < self->fpsFactor && self->prevBuf;
+	const int overlayMode = self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY;
+	const int keepTarget = self->prevBuf && (SaccContext_isLegacy(self) ||
+			(sameVideo && !overlayMode && (self->toolbox.flags & SACC_FLAG_INCREMENTAL)));
+	SaccJob job = { 0 };
+	int ret;
+	job.video = self->scaledFrame;
+	job.overlay = self->overlay;
+	job.videoFlags = sameVideo ? SACC_FRAME_SAME_VIDEO : 0;
+	job.maxDirty = SACC_MAX_DIRTY_RECTS;
+	if(keepTarget && av_buffer_is_writable(self->prevBuf)){
+		/* 前回の出力をもう誰も見ていないので、その上に直接描いてもらう */
+		if((ret = SaccContext_prepareJob(self, &job)) < 0){
+			return ret;
+		}
+		av_buffer_unref(&job.buf);
+		job.buf = av_buffer_ref(self->prevBuf);
+		if(!job.buf){
+			return AVERROR(ENOMEM);
+		}
+		job.targetFlags = SACC_FRAME_PREVIOUS;
+	}else{
+		if((ret = SaccContext_prepareJob(self, &job)) < 0){
+			return ret;
+		}
+		if(keepTarget){
+			const int64_t start = SaccContext_benchStart(self);
+			memcpy(job.buf->data, self->prevBuf->data, self->dstBufferSize);
+			SaccContext_benchStop(self, &job.layoutTime, start);
+			job.targetFlags = SACC_FRAME_PREVIOUS;
 		}
-		self->saccProcess(self->saccPriv, &self->toolbox, &dstFrame, &videoFrame);
 	}
 
-	{ // dstの構築
-		AVPicture dstPict;
-		memcpy(dstPict.data,     self->dstFrame->data,     AV_NUM_DATA_POINTERS*sizeof(self->dstFrame->data[0]));
-		memcpy(dstPict.linesize, self->dstFrame->linesize, AV_NUM_DATA_POINTERS*sizeof(self->dstFrame->linesize[0]));
-		/* パケットの構築 */
-		const int pret = av_new_packet(pkt, self->dstBufferSize);
-		if (pret < 0) {
-			return pret;
+	ret = SaccContext_processJob(self, &job);
+	if(!self->prevBuf && (ret == SACC_PROCESS_UNCHANGED || ret == SACC_PROCESS_DIRTY)){
+		/**
+		 * SaccProcessの中からseekされると、前回の出力はもう捨てられている。
+		 * targetに前回の結果が入っていたならそのまま使えるが、そうでなければ全部作り直す。
+		 */
+		if(overlayMode){
+			SaccContext_composeJob(self, &job);
+		}else if(!(job.targetFlags & SACC_FRAME_PREVIOUS)){
+			job.targetFlags = SACC_FRAME_FULL_REDRAW;
+			job.videoFlags = 0;
+			SaccContext_processJob(self, &job);
 		}
-		avpicture_layout(&dstPict, COLOR_FORMAT, self->dstWidth, self->dstHeight, pkt->data, self->dstBufferSize);
+		ret = 0;
 	}
-	pkt->stream_index = VIDEO_STREAM;
-	pkt->duration = self->pktDuration;
-	pkt->dts = dstDts;
-	pkt->pts = dstDts;
-	pkt->pos = self->pktPos;
-	pkt->size = self->dstBufferSize;
+	switch(ret){
+	case SACC_PROCESS_UNCHANGED:
+		av_buffer_unref(&job.buf);
+		job.buf = av_buffer_ref(self->prevBuf);
+		break;
+	case SACC_PROCESS_DIRTY:
+		if(overlayMode){
+			const int64_t start = SaccContext_benchStart(self);
+			uint8_t* dstData[4];
+			int dstLinesize[4];
+			if(av_buffer_is_writable(self->prevBuf)){
+				av_buffer_unref(&job.buf);
+				job.buf = av_buffer_ref(self->prevBuf);
+			}else{
+				memcpy(job.buf->data, self->prevBuf->data, self->dstBufferSize);
+			}
+			if(!job.buf){
+				return AVERROR(ENOMEM);
+			}
+			av_image_fill_arrays(dstData, dstLinesize, job.buf->data, self->pixFmt, self->dstWidth, self->dstHeight, 1);
+			for(int i=0;i<job.nbDirty;++i){
+				const SaccRect* const r = &job.dirty[i];
+				SaccContext_composeOverlay(self, &job, dstData, dstLinesize, r->x, r->y, r->x + r->w, r->y + r->h);
+			}
+			SaccContext_benchStop(self, &job.layoutTime, start);
+		}
+		break;
+	}
+	if(!job.buf){
+		return AVERROR(ENOMEM);
+	}
+	av_buffer_unref(&self->prevBuf);
+	if(!(self->prevBuf = av_buffer_ref(job.buf))){
+		av_buffer_unref(&job.buf);
+		return AVERROR(ENOMEM);
+	}
+	SaccContext_finishJob(self, &job, pkt);
 	return 0;
 }
 
-static int SaccContext_readPacket(AVFormatContext *avctx, AVPacket *pkt)
+static int SaccContext_receiveFrame(SaccContext* const self)
 {
-	SaccContext* const self = (SaccContext*)avctx->priv_data;
-	if(self->eof){
-		return AVERROR_EOF;
+	/**
+	 * デコーダからフレームを一枚受け取ってスケールする。
+	 * フレームスレッドが有効なら複数パケット分遅れて出てくるので、
+	 * タイムスタンプはパケットではなくフレームのものを使う。
+	 */
+	const AVStream* const st = self->formatContext->streams[self->videoStreamIndex];
+	int64_t start = SaccContext_benchStart(self);
+	for(;;){
+		const int ret = avcodec_receive_frame(self->videoCodecContext, self->rawFrame);
+		int64_t end;
+		if(ret < 0){
+			SaccContext_benchStop(self, &self->benchDecode, start);
+			return ret;
+		}
+		if(self->videoSkipUntil == AV_NOPTS_VALUE || self->rawFrame->best_effort_timestamp == AV_NOPTS_VALUE){
+			break;
+		}
+		/**
+		 * シーク直後は、目的の時刻を表示しているフレームまで読み飛ばす。
+		 * AVSEEK_FLAG_BACKWARDが無ければ、目的の時刻以降に始まるフレームまで。
+		 */
+		end = self->rawFrame->best_effort_timestamp + (self->rawFrame->pkt_duration > 0 ?
+				self->rawFrame->pkt_duration : av_rescale_q(1, av_inv_q(st->r_frame_rate), st->time_base));
+		if((self->seekFlags & AVSEEK_FLAG_BACKWARD) ?
+				end > self->videoSkipUntil :
+				self->rawFrame->best_effort_timestamp >= self->videoSkipUntil){
+			self->videoSkipUntil = AV_NOPTS_VALUE;
+			break;
+		}
+		av_frame_unref(self->rawFrame);
 	}
-	if(self->frameLeft > 0){
-		return createVideoPacket(self, pkt);
+	SaccContext_benchStop(self, &self->benchDecode, start);
+	start = SaccContext_benchStart(self);
+	if(self->rawFrame->format == self->pixFmt &&
+	   self->rawFrame->width == self->scaledWidth && self->rawFrame->height == self->scaledHeight){
+		/* 大きさも形式も同じなら、デコードしたフレームをそのまま使う */
+		av_frame_unref(self->scaledFrame);
+		av_frame_ref(self->scaledFrame, self->rawFrame);
+	}else{
+		int err;
+		self->swsContext = sws_getCachedContext(self->swsContext,
+				self->rawFrame->width, self->rawFrame->height, self->rawFrame->format,
+				self->scaledWidth, self->scaledHeight, self->pixFmt, SWS_BICUBIC, 0, 0, 0);
+		if(!self->swsContext){
+			av_frame_unref(self->rawFrame);
+			return AVERROR(EINVAL);
+		}
+		if(!self->scaledFrame->buf[0] || !av_frame_is_writable(self->scaledFrame)){
+			av_frame_unref(self->scaledFrame);
+			self->scaledFrame->format = self->pixFmt;
+			self->scaledFrame->width = self->scaledWidth;
+			self->scaledFrame->height = self->scaledHeight;
+			if((err = av_frame_get_buffer(self->scaledFrame, 32)) < 0){
+				av_frame_unref(self->rawFrame);
+				return err;
+			}
+		}
+		sws_scale(
+			self->swsContext,
+			(const uint8_t * const*)self->rawFrame->data,
+			self->rawFrame->linesize, 0, self->rawFrame->height,
+			self->scaledFrame->data,
+			self->scaledFrame->linesize);
+	}
+	SaccContext_benchStop(self, &self->benchScale, start);
+	{
+		const int64_t ts = self->rawFrame->best_effort_timestamp;
+		self->pktDuration = self->rawFrame->pkt_duration > 0 ?
+				self->rawFrame->pkt_duration * self->fpsFactor :
+				av_rescale_q(1, av_inv_q(st->r_frame_rate), st->time_base) * self->fpsFactor;
+		self->pktPos = self->rawFrame->pkt_pos;
+		self->pktDts = ts != AV_NOPTS_VALUE ? (ts * self->fpsFactor) : 0;
 	}
+	self->frameLeft = self->fpsFactor;
+	av_frame_unref(self->rawFrame);
+	return 0;
+}
+
+static int SaccContext_readInput(SaccContext* const self, AVPacket *pkt)
+{
+	/**
+	 * 動画のフレームが一枚デコードできたら1、音声のパケットをpktに入れたら0を返す。
+	 */
 	AVPacket packet;
+	int64_t start;
 	int ret = 0;
-	while((ret = av_read_frame(self->formatContext, &packet)) >= 0){
+	for(;;){
+		/* まずデコーダに溜まっているフレームを取り出す */
+		ret = SaccContext_receiveFrame(self);
+		if(ret >= 0){
+			return 1;
+		}
+		if(ret != AVERROR(EAGAIN)){
+			return ret;
+		}
+		/* 足りなければパケットを読んでデコーダに送る */
+		start = SaccContext_benchStart(self);
+		ret = av_read_frame(self->formatContext, &packet);
+		if(ret == AVERROR_EOF && !self->draining){
+			self->draining = 1;
+			avcodec_send_packet(self->videoCodecContext, NULL);
+			continue;
+		}else if(ret < 0){
+			return ret;
+		}
 		if(packet.stream_index == self->videoStreamIndex){
-			int gotPicture = 0;
-			avcodec_decode_video2(self->formatContext->streams[self->videoStreamIndex]->codec, self->rawFrame, &gotPicture, &packet);
-			if(gotPicture){
-				sws_scale(
-					self->swsContext,
-					(const uint8_t * const*)self->rawFrame->data,
-					self->rawFrame->linesize, 0, self->srcHeight,
-					self->scaledFrame->data,
-					self->scaledFrame->linesize);
-				self->pktDuration = packet.duration * self->fpsFactor;
-				self->pktPos = packet.pos;
-				// FIXME:DTSとPTSの区別をつける
-				// DTS!=DPSなフレームが来たら貯めこんでおいて、DTS==DPSなフレームが来たら一気に戻せばOK?
-				// http://htffmpegx.seesaa.net/article/15410871.html
-				self->pktDts = packet.dts != AV_NOPTS_VALUE ? (packet.dts * self->fpsFactor) : 0;
-				self->frameLeft = self->fpsFactor;
-				av_free_packet(&packet);
-				ret = createVideoPacket(self, pkt);
-				break;
+			ret = avcodec_send_packet(self->videoCodecContext, &packet);
+			av_packet_unref(&packet);
+			SaccContext_benchStop(self, &self->benchDecode, start);
+			if(ret < 0 && ret != AVERROR(EAGAIN)){
+				av_log(self, AV_LOG_WARNING, "Failed to decode video packet: %s\n", av_err2str(ret));
 			}
 		} else if(packet.stream_index == self->audioStreamIndex){
-			*pkt = packet;
+			if(self->audioSkipUntil != AV_NOPTS_VALUE && packet.pts != AV_NOPTS_VALUE &&
+			   packet.pts + packet.duration <= self->audioSkipUntil){
+				av_packet_unref(&packet);
+				continue;
+			}
+			self->audioSkipUntil = AV_NOPTS_VALUE;
+			av_packet_move_ref(pkt, &packet);
 			pkt->stream_index = AUDIO_STREAM;
-			break;
+			return 0;
 		} else {
-			av_free_packet(&packet);
+			av_packet_unref(&packet);
+		}
+	}
+}
+
+#if HAVE_THREADS
+static void* SaccContext_worker(void* arg)
+{
+	SaccContext* const self = (SaccContext*)arg;
+	pthread_mutex_lock(&self->jobLock);
+	for(;;){
+		SaccJob* job = NULL;
+		for(int i=0;i<self->jobCount;++i){
+			SaccJob* const candidate = &self->jobs[(self->jobHead + i) % self->nbJobs];
+			if(candidate->state == JOB_QUEUED){
+				job = candidate;
+				break;
+			}
+		}
+		if(!job){
+			if(self->workerQuit){
+				break;
+			}
+			pthread_cond_wait(&self->jobQueued, &self->jobLock);
+			continue;
+		}
+		job->state = JOB_RUNNING;
+		pthread_mutex_unlock(&self->jobLock);
+		SaccContext_processJob(self, job);
+		pthread_mutex_lock(&self->jobLock);
+		job->state = JOB_DONE;
+		pthread_cond_broadcast(&self->jobDone);
+	}
+	pthread_mutex_unlock(&self->jobLock);
+	return NULL;
+}
+
+static int SaccContext_queueJob(SaccContext* const self)
+{
+	SaccJob* const job = &self->jobs[(self->jobHead + self->jobCount) % self->nbJobs];
+	int ret;
+	job->videoFlags = self->frameLeft < self->fpsFactor ? SACC_FRAME_SAME_VIDEO : 0;
+	job->targetFlags = SACC_FRAME_FULL_REDRAW;
+	job->maxDirty = 0;
+	if((ret = SaccContext_prepareJob(self, job)) < 0){
+		return ret;
+	}
+	if((ret = av_frame_ref(job->video, self->scaledFrame)) < 0){
+		av_buffer_unref(&job->buf);
+		return ret;
+	}
+	if(self->overlayPool){
+		if(!(job->overlayBuf = av_buffer_pool_get(self->overlayPool))){
+			av_buffer_unref(&job->buf);
+			av_frame_unref(job->video);
+			return AVERROR(ENOMEM);
+		}
+		job->overlay = job->overlayBuf->data;
+	}
+	pthread_mutex_lock(&self->jobLock);
+	job->state = JOB_QUEUED;
+	self->jobCount++;
+	pthread_cond_signal(&self->jobQueued);
+	pthread_mutex_unlock(&self->jobLock);
+	return 0;
+}
+
+static int SaccContext_readPacketThreaded(SaccContext* const self, AVPacket *pkt)
+{
+	/**
+	 * デコードとスケールはこのスレッドで続けながら、SaccProcessはワーカーに回す。
+	 * 仕事はリングに積んだ順(=DTS順)に取り出すので、出力の順番は変わらない。
+	 */
+	for(;;){
+		SaccJob* const head = &self->jobs[self->jobHead];
+		int ret;
+		pthread_mutex_lock(&self->jobLock);
+		if(self->jobCount > 0 && head->state == JOB_DONE){
+			pthread_mutex_unlock(&self->jobLock);
+			SaccContext_finishJob(self, head, pkt);
+			av_frame_unref(head->video);
+			av_buffer_unref(&head->overlayBuf);
+			pthread_mutex_lock(&self->jobLock);
+			head->state = JOB_EMPTY;
+			self->jobHead = (self->jobHead + 1) % self->nbJobs;
+			self->jobCount--;
+			pthread_mutex_unlock(&self->jobLock);
+			return 0;
+		}
+		if(self->jobCount == self->nbJobs || (self->frameLeft <= 0 && self->inputEnded)){
+			if(self->jobCount == 0){
+				pthread_mutex_unlock(&self->jobLock);
+				return AVERROR_EOF;
+			}
+			pthread_cond_wait(&self->jobDone, &self->jobLock);
+			pthread_mutex_unlock(&self->jobLock);
+			continue;
+		}
+		pthread_mutex_unlock(&self->jobLock);
+		if(self->frameLeft > 0){
+			if((ret = SaccContext_queueJob(self)) < 0){
+				return ret;
+			}
+			continue;
+		}
+		ret = SaccContext_readInput(self, pkt);
+		if(ret == 0){
+			return 0;
+		}else if(ret == AVERROR_EOF){
+			self->inputEnded = 1;
+		}else if(ret < 0){
+			return ret;
+		}
+	}
+}
+#endif
+
+static int SaccContext_readPacket(AVFormatContext *avctx, AVPacket *pkt)
+{
+	SaccContext* const self = (SaccContext*)avctx->priv_data;
+	int ret;
+	if(self->eof){
+		return AVERROR_EOF;
+	}
+#if HAVE_THREADS
+	if(self->nbWorkers > 0){
+		ret = SaccContext_readPacketThreaded(self, pkt);
+	}else
+#endif
+	if(self->frameLeft > 0){
+		ret = createVideoPacket(self, pkt);
+	}else{
+		ret = SaccContext_readInput(self, pkt);
+		if(ret > 0){
+			ret = createVideoPacket(self, pkt);
 		}
 	}
 	if(ret == AVERROR_EOF)
@@ -313,6 +849,133 @@ static int SaccContext_readPacket(AVFormatContext *avctx, AVPacket *pkt)
 	return ret;
 }
 
+static int SaccContext_startWorkers(SaccContext* const self)
+{
+	if(self->processThreads <= 0){
+		return 0;
+	}
+	if(!(self->toolbox.flags & SACC_FLAG_REENTRANT)){
+		av_log(self, AV_LOG_WARNING, "The adapter is not reentrant; running SaccProcess inline.\n");
+		return 0;
+	}
+#if HAVE_THREADS
+	/* 各ワーカーに一つずつと、デコード中の分を合わせた深さのリングにする */
+	self->nbJobs = self->processThreads * 2;
+	if(!(self->jobs = av_mallocz_array(self->nbJobs, sizeof(*self->jobs)))){
+		return AVERROR(ENOMEM);
+	}
+	for(int i=0;i<self->nbJobs;++i){
+		if(!(self->jobs[i].video = av_frame_alloc())){
+			return AVERROR(ENOMEM);
+		}
+	}
+	if(self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY){
+		self->overlayPool = av_buffer_pool_init(self->overlayLinesize * self->dstHeight, av_buffer_allocz);
+		if(!self->overlayPool){
+			return AVERROR(ENOMEM);
+		}
+	}
+	if(!(self->workers = av_mallocz_array(self->processThreads, sizeof(*self->workers)))){
+		return AVERROR(ENOMEM);
+	}
+	pthread_mutex_init(&self->jobLock, NULL);
+	pthread_cond_init(&self->jobQueued, NULL);
+	pthread_cond_init(&self->jobDone, NULL);
+	for(int i=0;i<self->processThreads;++i){
+		const int ret = pthread_create(&self->workers[i], NULL, SaccContext_worker, self);
+		if(ret){
+			av_log(self, AV_LOG_ERROR, "Failed to start worker thread: %s\n", av_err2str(AVERROR(ret)));
+			return AVERROR(ret);
+		}
+		self->nbWorkers++;
+	}
+	av_log(self, AV_LOG_VERBOSE, "running SaccProcess on %d thread(s)\n", self->nbWorkers);
+#else
+	av_log(self, AV_LOG_WARNING, "Built without thread support; running SaccProcess inline.\n");
+#endif
+	return 0;
+}
+
+static void SaccContext_stopWorkers(SaccContext* const self)
+{
+#if HAVE_THREADS
+	if(self->workers){
+		pthread_mutex_lock(&self->jobLock);
+		self->workerQuit = 1;
+		pthread_cond_broadcast(&self->jobQueued);
+		pthread_mutex_unlock(&self->jobLock);
+		for(int i=0;i<self->nbWorkers;++i){
+			pthread_join(self->workers[i], NULL);
+		}
+		pthread_cond_destroy(&self->jobDone);
+		pthread_cond_destroy(&self->jobQueued);
+		pthread_mutex_destroy(&self->jobLock);
+		av_freep(&self->workers);
+	}
+	self->nbWorkers = 0;
+	self->workerQuit = 0;
+#endif
+	for(int i=0;self->jobs && i<self->nbJobs;++i){
+		av_frame_free(&self->jobs[i].video);
+		av_buffer_unref(&self->jobs[i].buf);
+		av_buffer_unref(&self->jobs[i].overlayBuf);
+	}
+	av_freep(&self->jobs);
+	av_buffer_pool_uninit(&self->overlayPool);
+	self->nbJobs = 0;
+	self->jobHead = 0;
+	self->jobCount = 0;
+	self->inputEnded = 0;
+}
+
+static void SaccContext_flushJobs(SaccContext* const self)
+{
+	/* 実行中の仕事が終わるのを待ってから、リングを空にする */
+#if HAVE_THREADS
+	if(self->nbWorkers > 0){
+		pthread_mutex_lock(&self->jobLock);
+		for(int i=0;i<self->jobCount;){
+			const SaccJob* const job = &self->jobs[(self->jobHead + i) % self->nbJobs];
+			if(job->state == JOB_QUEUED || job->state == JOB_RUNNING){
+				pthread_cond_wait(&self->jobDone, &self->jobLock);
+				i = 0;
+				continue;
+			}
+			++i;
+		}
+		pthread_mutex_unlock(&self->jobLock);
+	}
+#endif
+	for(int i=0;self->jobs && i<self->nbJobs;++i){
+		av_frame_unref(self->jobs[i].video);
+		av_buffer_unref(&self->jobs[i].buf);
+		av_buffer_unref(&self->jobs[i].overlayBuf);
+		self->jobs[i].state = JOB_EMPTY;
+	}
+	self->jobHead = 0;
+	self->jobCount = 0;
+	self->inputEnded = 0;
+}
+
+static int SaccContext_readSeek(AVFormatContext *avctx, int stream_index, int64_t timestamp, int flags)
+{
+	SaccContext* const self = (SaccContext*)avctx->priv_data;
+	double pts;
+	if(flags & AVSEEK_FLAG_FRAME){
+		/* フレーム番号は出力する動画ストリームのもの(minfpsで水増しした後) */
+		const AVStream* const st = avctx->streams[VIDEO_STREAM];
+		if(stream_index >= 0 && stream_index != VIDEO_STREAM){
+			return AVERROR(EINVAL);
+		}
+		pts = timestamp * av_q2d(av_inv_q(st->r_frame_rate));
+	}else{
+		pts = stream_index < 0 ?
+				timestamp * av_q2d(AV_TIME_BASE_Q) :
+				timestamp * av_q2d(avctx->streams[stream_index]->time_base);
+	}
+	return SaccContext_seek(self, pts, flags);
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 
 static void SaccContext_clear(SaccContext* const self)
@@ -321,16 +984,23 @@ static void SaccContext_clear(SaccContext* const self)
 	self->videoCount = 0;
 
 	self->formatContext = NULL;
+	self->videoCodecContext = NULL;
 	self->videoStreamIndex = -1;
 	self->audioStreamIndex = -1;
+	self->draining = 0;
+	self->videoSkipUntil = AV_NOPTS_VALUE;
+	self->audioSkipUntil = AV_NOPTS_VALUE;
+	self->seekFlags = 0;
 	self->rawFrame = NULL;
 	self->scaledFrame = NULL;
-	self->dstFrame = NULL;
 	self->swsContext = NULL;
-	self->scaledBufferSize = -1;
-	self->scaledBuffer = NULL;
+	self->pixFmt = COLOR_FORMAT;
+	self->surfaceFormat = SACC_SURFACE_RGB32;
+	self->overlay = NULL;
+	self->overlayLinesize = 0;
 	self->dstBufferSize = -1;
-	self->dstBuffer = NULL;
+	self->dstPool = NULL;
+	self->prevBuf = NULL;
 	self->srcWidth=-1;
 	self->srcHeight=-1;
 	self->dstWidth=-1;
@@ -346,10 +1016,12 @@ static void SaccContext_clear(SaccContext* const self)
 	self->toolbox.ptr = self;
 	self->toolbox.version = TOOLBOX_VERSION;
 	self->toolbox.loadVideo = SaccToolBox_loadVideo;
-	self->toolbox.seek = NULL;//FIXME
+	self->toolbox.seek = SaccToolBox_seek;
 	self->toolbox.currentVideo.width = -1;
 	self->toolbox.currentVideo.height = -1;
 	self->toolbox.currentVideo.length = -1;
+	self->toolbox.surfaceFormat = SACC_SURFACE_RGB32;
+	self->toolbox.flags = 0;
 
 	self->saccDynamic = NULL;
 	self->saccPriv = NULL;
@@ -360,6 +1032,18 @@ static void SaccContext_clear(SaccContext* const self)
 	self->saccMeasure = NULL;
 	self->saccProcess = NULL;
 	self->saccRelease = NULL;
+
+	self->inputEnded = 0;
+	self->nbJobs = 0;
+	self->jobHead = 0;
+	self->jobCount = 0;
+	self->jobs = NULL;
+	self->overlayPool = NULL;
+#if HAVE_THREADS
+	self->nbWorkers = 0;
+	self->workerQuit = 0;
+	self->workers = NULL;
+#endif
 }
 
 static void SaccContext_closeCodec(SaccContext* const self)
@@ -368,34 +1052,21 @@ static void SaccContext_closeCodec(SaccContext* const self)
 	 * 現在開いているコーデックというかファイルがあれば、それをクローズする。
 	 * 開いているかどうかの判断に、ポインタが0であるか否かを用いているので、最初の初期化には使えない。
 	 */
-	if(self->scaledBuffer != NULL){
-		av_free(self->scaledBuffer);
-	}
-	self->scaledBuffer = NULL;
-	if(self->scaledFrame != NULL){
-		av_free(self->scaledFrame);
-	}
-	self->scaledFrame = NULL;
-	if(self->dstBuffer != NULL){
-		av_free(self->dstBuffer);
-	}
-	self->dstBuffer = NULL;
-	if(self->dstFrame != NULL){
-		av_free(self->dstFrame);
-	}
-	self->dstFrame = NULL;
-	if(self->rawFrame != NULL){
-		av_free(self->rawFrame);
-	}
-	self->rawFrame = NULL;
+	av_frame_free(&self->scaledFrame);
+	av_freep(&self->overlay);
+	av_buffer_unref(&self->prevBuf);
+	av_buffer_pool_uninit(&self->dstPool);
+	av_frame_free(&self->rawFrame);
 	if(self->swsContext != NULL){
 		sws_freeContext(self->swsContext);
 	}
 	self->swsContext = NULL;
+	avcodec_free_context(&self->videoCodecContext);
 	if(self->formatContext != NULL)
 	{
-		avformat_free_context(self->formatContext);
+		avformat_close_input(&self->formatContext);
 	}
+	self->draining = 0;
 	self->videoStreamIndex=-1;
 	self->audioStreamIndex=-1;
 	self->formatContext=NULL;
@@ -405,7 +1076,7 @@ static int SaccContext_loadAdapter(SaccContext* const self, const char* const fi
 {
 	self->saccDynamic = dlopen(filename, RTLD_NOW);
 	if(!self->saccDynamic){
-		av_log(self, AV_LOG_ERROR, "Failed to load saccubus adapter: %s\nBecause: %s\n", filename, dlerror());
+		av_log(self, AV_LOG_ERROR, "Failed to load saccubus adapter: %s\nBecause: %s\n", filename, sacc_dlerror());
 		return -1;
 	}
 	self->saccConfigure = dlsym(self->saccDynamic, "SaccConfigure");
@@ -509,22 +1180,38 @@ static int SaccToolBox_loadVideo(SaccToolBox* const box, const char* const filen
 	}
 	self->videoStreamIndex = av_find_best_stream(self->formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, 0, 0);
 	self->audioStreamIndex = av_find_best_stream(self->formatContext, AVMEDIA_TYPE_AUDIO, -1, self->audioStreamIndex, 0, 0);
-
-	AVCodec* const videoCodec = self->videoStreamIndex >= 0 ? avcodec_find_decoder(self->formatContext->streams[self->videoStreamIndex]->codec->codec_id) : 0;
-	AVCodec* const audioCodec = self->audioStreamIndex >= 0 ? avcodec_find_decoder(self->formatContext->streams[self->audioStreamIndex]->codec->codec_id) : 0;
-
-	if(avcodec_open2(self->formatContext->streams[self->videoStreamIndex]->codec, videoCodec, NULL) < 0){
-		av_log(self, AV_LOG_ERROR, "Failed to open video codec: %s\n", filename);
+	if(self->videoStreamIndex < 0){
+		av_log(self, AV_LOG_ERROR, "Failed to find video stream: %s\n", filename);
 		return -1;
 	}
-	if(avcodec_open2(self->formatContext->streams[self->audioStreamIndex]->codec, audioCodec, NULL) < 0){
-		av_log(self, AV_LOG_ERROR, "Failed to open audio codec: %s\n", filename);
-		return -1;
+
+	{ /* ストリームのcodecとは別に、スレッド付きのデコーダを用意する */
+		const AVStream* const st = self->formatContext->streams[self->videoStreamIndex];
+		AVCodec* const videoCodec = avcodec_find_decoder(st->codecpar->codec_id);
+		if(!videoCodec){
+			av_log(self, AV_LOG_ERROR, "Failed to find video codec: %s\n", filename);
+			return -1;
+		}
+		if(!(self->videoCodecContext = avcodec_alloc_context3(videoCodec))){
+			return AVERROR(ENOMEM);
+		}
+		if(avcodec_parameters_to_context(self->videoCodecContext, st->codecpar) < 0){
+			return -1;
+		}
+		self->videoCodecContext->pkt_timebase = st->time_base;
+		self->videoCodecContext->thread_count = self->threads;
+		self->videoCodecContext->thread_type = self->threadType;
+		if(avcodec_open2(self->videoCodecContext, videoCodec, NULL) < 0){
+			av_log(self, AV_LOG_ERROR, "Failed to open video codec: %s\n", filename);
+			return -1;
+		}
+		av_log(self, AV_LOG_VERBOSE, "video decoder: %s, %d thread(s)\n", videoCodec->name, self->videoCodecContext->thread_count);
 	}
 
 	self->eof = 0;
-	self->srcWidth = self->formatContext->streams[self->videoStreamIndex]->codec->width;
-	self->srcHeight = self->formatContext->streams[self->videoStreamIndex]->codec->height;
+	self->draining = 0;
+	self->srcWidth = self->videoCodecContext->width;
+	self->srcHeight = self->videoCodecContext->height;
 	
 	self->scaledWidth = self->scaledWidth <= 0 ? self->srcWidth : self->scaledWidth;
 	self->scaledHeight = self->scaledHeight <= 0 ? self->srcHeight : self->scaledHeight;
@@ -540,7 +1227,7 @@ static int SaccToolBox_loadVideo(SaccToolBox* const box, const char* const filen
 		self->toolbox.currentVideo.length = 
 		self->formatContext->streams[self->videoStreamIndex]->duration *
 		av_q2d(self->formatContext->streams[self->videoStreamIndex]->time_base);
-	}else if(self->formatContext->streams[self->audioStreamIndex]->duration > 0){
+	}else if(self->audioStreamIndex >= 0 && self->formatContext->streams[self->audioStreamIndex]->duration > 0){
 		self->toolbox.currentVideo.length = 
 		self->formatContext->streams[self->audioStreamIndex]->duration *
 		av_q2d(self->formatContext->streams[self->audioStreamIndex]->time_base);
@@ -575,21 +1262,99 @@ static int SaccToolBox_loadVideo(SaccToolBox* const box, const char* const filen
 	}
 	self->videoCount++;
 
+	switch(self->toolbox.surfaceFormat){
+	case SACC_SURFACE_RGB32:
+		self->pixFmt = COLOR_FORMAT;
+		break;
+	case SACC_SURFACE_YUV420P:
+	case SACC_SURFACE_RGBA_OVERLAY:
+		self->pixFmt = AV_PIX_FMT_YUV420P;
+		break;
+	case SACC_SURFACE_NV12:
+		self->pixFmt = AV_PIX_FMT_NV12;
+		break;
+	default:
+		av_log(self, AV_LOG_ERROR, "Unknown surface format: %d\n", self->toolbox.surfaceFormat);
+		return -1;
+	}
+	self->surfaceFormat = self->toolbox.surfaceFormat;
+	av_log(self, AV_LOG_VERBOSE, "surface format: %s\n", av_get_pix_fmt_name(self->pixFmt));
+
 	self->rawFrame = av_frame_alloc();
 	self->scaledFrame = av_frame_alloc();
-	self->dstFrame = av_frame_alloc();
 
-	self->swsContext = sws_getContext(self->srcWidth, self->srcHeight, self->formatContext->streams[self->videoStreamIndex]->codec->pix_fmt, self->scaledWidth, self->scaledHeight, COLOR_FORMAT, SWS_BICUBIC, 0, 0, 0);
+	self->swsContext = sws_getContext(self->srcWidth, self->srcHeight, self->videoCodecContext->pix_fmt, self->scaledWidth, self->scaledHeight, self->pixFmt, SWS_BICUBIC, 0, 0, 0);
 
-	self->scaledBufferSize = avpicture_get_size(COLOR_FORMAT, self->scaledWidth, self->scaledHeight)*sizeof(uint8_t);
-	self->scaledBuffer = (uint8_t*)av_malloc(self->scaledBufferSize);
-	avpicture_fill((AVPicture*)self->scaledFrame, self->scaledBuffer, COLOR_FORMAT, self->scaledWidth, self->scaledHeight);
+	if(self->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY){
+		self->overlayLinesize = av_image_get_linesize(OVERLAY_FORMAT, self->dstWidth, 0);
+		self->overlay = av_mallocz(self->overlayLinesize * self->dstHeight);
+		if(!self->overlay){
+			return AVERROR(ENOMEM);
+		}
+	}
 
-	self->dstBufferSize = avpicture_get_size(COLOR_FORMAT, self->dstWidth, self->dstHeight)*sizeof(uint8_t);
-	self->dstBuffer = (uint8_t*)av_malloc(self->dstBufferSize);
-	avpicture_fill((AVPicture*)self->dstFrame, self->dstBuffer, COLOR_FORMAT, self->dstWidth, self->dstHeight);
+	/* パケットにそのまま使うので、行間に隙間のない詰めたレイアウトにする */
+	self->dstBufferSize = av_image_get_buffer_size(self->pixFmt, self->dstWidth, self->dstHeight, 1);
+	self->dstPool = av_buffer_pool_init(self->dstBufferSize + AV_INPUT_BUFFER_PADDING_SIZE, av_buffer_allocz);
+	if(!self->dstPool){
+		return AVERROR(ENOMEM);
+	}
 
 	return 0;
 }
 
 
+
+static int SaccToolBox_seek(SaccToolBox* const box, double pts)
+{
+	SaccContext* const self = (SaccContext*)box->ptr;
+#if HAVE_THREADS
+	/**
+	 * ワーカーで動いているSaccProcessから呼ばれると、自分自身の仕事が終わるのを
+	 * 待つことになる上に、デマルチプレクサを読んでいるスレッドとも競合するので断る。
+	 */
+	for(int i=0;i<self->nbWorkers;++i){
+		if(pthread_equal(pthread_self(), self->workers[i])){
+			av_log(self, AV_LOG_ERROR, "seek cannot be called from SaccProcess running on a worker thread.\n");
+			return AVERROR(EBUSY);
+		}
+	}
+#endif
+	return SaccContext_seek(self, pts, AVSEEK_FLAG_BACKWARD);
+}
+
+static int SaccContext_seek(SaccContext* const self, double pts, int flags)
+{
+	/**
+	 * ptsは秒。インデックスを使って手前のキーフレームに飛んでから、
+	 * デコーダを空にして目的のフレームまで読み飛ばす。
+	 */
+	const AVStream* st;
+	int64_t ts;
+	int ret;
+	if(!self->formatContext || self->videoStreamIndex < 0){
+		return AVERROR(EINVAL);
+	}
+	st = self->formatContext->streams[self->videoStreamIndex];
+	ts = llrint(pts / av_q2d(st->time_base));
+	if(st->start_time != AV_NOPTS_VALUE && ts < st->start_time){
+		ts = st->start_time;
+	}
+	ret = avformat_seek_file(self->formatContext, self->videoStreamIndex, INT64_MIN, ts, ts, 0);
+	if(ret < 0){
+		av_log(self, AV_LOG_ERROR, "Failed to seek to %f: %s\n", pts, av_err2str(ret));
+		return ret;
+	}
+	SaccContext_flushJobs(self);
+	avcodec_flush_buffers(self->videoCodecContext);
+	av_buffer_unref(&self->prevBuf);
+	self->videoSkipUntil = ts;
+	self->seekFlags = flags;
+	self->audioSkipUntil = self->audioStreamIndex >= 0 ?
+			av_rescale_q(ts, st->time_base, self->formatContext->streams[self->audioStreamIndex]->time_base) :
+			AV_NOPTS_VALUE;
+	self->draining = 0;
+	self->eof = 0;
+	self->frameLeft = 0;
+	return 0;
+}
@@ -627,8 +627,9 @@ static const AVClass *filter_child_class_next(const AVClass *prev)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_GRAPH }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "graph", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_GRAPH }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -899,6 +900,7 @@ int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
 
 int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
 {
+    int thread_type = 0;
     int ret = 0;
 
     ret = av_opt_set_dict(ctx, options);
@@ -910,11 +912,15 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
     if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         ctx->graph->internal->thread_execute) {
-        ctx->thread_type       = AVFILTER_THREAD_SLICE;
+        thread_type           |= AVFILTER_THREAD_SLICE;
         ctx->internal->execute = ctx->graph->internal->thread_execute;
-    } else {
-        ctx->thread_type = 0;
     }
+    if (!(ctx->filter->flags_internal & (FF_FILTER_FLAG_HWFRAME_AWARE |
+                                         FF_FILTER_FLAG_GRAPH_SERIAL)) &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_GRAPH &&
+        ctx->graph->internal->thread_activate)
+        thread_type |= AVFILTER_THREAD_GRAPH;
+    ctx->thread_type = thread_type;
 
     if (ctx->filter->priv_class) {
         ret = av_opt_set_dict2(ctx->priv, options, AV_OPT_SEARCH_CHILDREN);
@@ -50,6 +50,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "graph", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_GRAPH }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
@@ -1441,6 +1442,65 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static int graph_activate_allowed(AVFilterContext *filter)
+{
+    /* sources and sinks are driven by the caller, sinks also update the
+       graph-wide sink links heap */
+    return filter->thread_type & AVFILTER_THREAD_GRAPH &&
+           filter->nb_inputs && filter->nb_outputs;
+}
+
+static void mark_neighbourhood(AVFilterContext *filter, unsigned mark, int depth)
+{
+    unsigned i;
+
+    filter->internal->activate_mark = mark;
+    if (!depth--)
+        return;
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            mark_neighbourhood(filter->inputs[i]->src, mark, depth);
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            mark_neighbourhood(filter->outputs[i]->dst, mark, depth);
+}
+
+/**
+ * Activate filter along with other ready filters that are at least three
+ * links away from it and from each other. Activating a filter only touches
+ * its own links and the state of its direct neighbours, so such filters can
+ * run concurrently without locking and the result is the same as activating
+ * them one after the other.
+ */
+static int graph_activate_concurrently(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    unsigned mark = ++gi->activate_mark;
+    unsigned i;
+    int nb = 0, ret = 0;
+
+    gi->activate_filters[nb++] = filter;
+    mark_neighbourhood(filter, mark, 2);
+    for (i = 0; i < graph->nb_filters && nb < graph->nb_threads; i++) {
+        AVFilterContext *f = graph->filters[i];
+        if (!f->ready || f->internal->activate_mark == mark ||
+            !graph_activate_allowed(f))
+            continue;
+        gi->activate_filters[nb++] = f;
+        mark_neighbourhood(f, mark, 2);
+    }
+    if (nb == 1)
+        return ff_filter_activate(filter);
+
+    gi->thread_activate(graph, gi->activate_filters, gi->activate_rets, nb);
+    for (i = 0; i < nb; i++)
+        if (gi->activate_rets[i] < 0) {
+            ret = gi->activate_rets[i];
+            break;
+        }
+    return ret;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
@@ -1453,5 +1513,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
+    if (graph->internal->thread_activate && graph_activate_allowed(filter))
+        return graph_activate_concurrently(graph, filter);
     return ff_filter_activate(filter);
 }
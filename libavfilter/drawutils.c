@@ -522,16 +522,15 @@ void ff_blend_rectangle(FFDrawContext *draw, FFDrawColor *color,
     }
 }
 
-static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth,
-                          unsigned w, unsigned h, unsigned shift, unsigned xm0)
+/* average of the w x h mask samples covered by one destination sample */
+static unsigned mask_coverage(const uint8_t *mask, int mask_linesize, int l2depth,
+                              unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
     unsigned xmmod = 7 >> l2depth;
     unsigned mbits = (1 << (1 << l2depth)) - 1;
     unsigned mmult = 255 / mbits;
-    uint16_t value = AV_RL16(dst);
 
     for (y = 0; y < h; y++) {
         xm = xm0;
@@ -542,7 +541,16 @@ static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
         }
         mask += mask_linesize;
     }
-    alpha = (t >> shift) * alpha;
+    return t >> shift;
+}
+
+static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
+                          const uint8_t *mask, int mask_linesize, int l2depth,
+                          unsigned w, unsigned h, unsigned shift, unsigned xm0)
+{
+    uint16_t value = AV_RL16(dst);
+
+    alpha = mask_coverage(mask, mask_linesize, l2depth, w, h, shift, xm0) * alpha;
     AV_WL16(dst, ((0x10001 - alpha) * value + alpha * src) >> 16);
 }
 
@@ -550,22 +558,7 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
                         const uint8_t *mask, int mask_linesize, int l2depth,
                         unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
-    unsigned xm, x, y, t = 0;
-    unsigned xmshf = 3 - l2depth;
-    unsigned xmmod = 7 >> l2depth;
-    unsigned mbits = (1 << (1 << l2depth)) - 1;
-    unsigned mmult = 255 / mbits;
-
-    for (y = 0; y < h; y++) {
-        xm = xm0;
-        for (x = 0; x < w; x++) {
-            t += ((mask[xm >> xmshf] >> ((~xm & xmmod) << l2depth)) & mbits)
-                 * mmult;
-            xm++;
-        }
-        mask += mask_linesize;
-    }
-    alpha = (t >> shift) * alpha;
+    alpha = mask_coverage(mask, mask_linesize, l2depth, w, h, shift, xm0) * alpha;
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
@@ -716,6 +709,148 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
     }
 }
 
+static void mask_weights_line(uint32_t *weights, unsigned alpha,
+                              const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                              unsigned hsub, unsigned vsub,
+                              int xm, int left, int right, int hband)
+{
+    int x;
+
+    if (left) {
+        *weights++ = alpha * mask_coverage(mask, mask_linesize, l2depth,
+                                           left, hband, hsub + vsub, xm);
+        xm += left;
+    }
+    for (x = 0; x < w; x++) {
+        *weights++ = alpha * mask_coverage(mask, mask_linesize, l2depth,
+                                           1 << hsub, hband, hsub + vsub, xm);
+        xm += 1 << hsub;
+    }
+    if (right)
+        *weights = alpha * mask_coverage(mask, mask_linesize, l2depth,
+                                         right, hband, hsub + vsub, xm);
+}
+
+int ff_blend_mask_weights(FFDrawContext *draw, FFDrawColor *color,
+                          FFBlendWeights *bw, int dst_w, int dst_h,
+                          const uint8_t *mask, int mask_linesize, int mask_w, int mask_h,
+                          int l2depth, int x0, int y0)
+{
+    unsigned alpha, nb_planes, plane;
+    int xm0, ym0, w_sub, h_sub, x_sub, y_sub, left, right, top, bottom, y;
+    const uint8_t *m;
+    uint32_t *wp;
+
+    bw->nb_planes = 0;
+    clip_interval(dst_w, &x0, &mask_w, &xm0);
+    clip_interval(dst_h, &y0, &mask_h, &ym0);
+    mask += ym0 * mask_linesize;
+    if (mask_w <= 0 || mask_h <= 0 || !color->rgba[3])
+        return 0;
+    if (draw->desc->comp[0].depth <= 8) {
+        alpha = (0x10307 * color->rgba[3] + 0x3) >> 8;
+    } else {
+        alpha = (0x101 * color->rgba[3] + 0x2) >> 8;
+    }
+    nb_planes = draw->nb_planes - !!(draw->desc->flags & AV_PIX_FMT_FLAG_ALPHA && !(draw->flags & FF_DRAW_PROCESS_ALPHA));
+    nb_planes += !nb_planes;
+    for (plane = 0; plane < nb_planes; plane++) {
+        const int hsub = draw->hsub[plane];
+        const int vsub = draw->vsub[plane];
+
+        w_sub = mask_w;
+        h_sub = mask_h;
+        x_sub = x0;
+        y_sub = y0;
+        subsampling_bounds(hsub, &x_sub, &w_sub, &left, &right);
+        subsampling_bounds(vsub, &y_sub, &h_sub, &top, &bottom);
+        bw->x[plane] = x0 >> hsub;
+        bw->y[plane] = y0 >> vsub;
+        bw->w[plane] = !!left + w_sub + !!right;
+        bw->h[plane] = !!top  + h_sub + !!bottom;
+        av_fast_malloc(&bw->weights[plane], &bw->weights_size[plane],
+                       (size_t)bw->w[plane] * bw->h[plane] * sizeof(*bw->weights[plane]));
+        if (!bw->weights[plane]) {
+            ff_blend_weights_free(bw);
+            return AVERROR(ENOMEM);
+        }
+        bw->nb_planes = plane + 1;
+
+        wp = bw->weights[plane];
+        m  = mask;
+        if (top) {
+            mask_weights_line(wp, alpha, m, mask_linesize, l2depth, w_sub,
+                              hsub, vsub, xm0, left, right, top);
+            wp += bw->w[plane];
+            m  += top * mask_linesize;
+        }
+        for (y = 0; y < h_sub; y++) {
+            mask_weights_line(wp, alpha, m, mask_linesize, l2depth, w_sub,
+                              hsub, vsub, xm0, left, right, 1 << vsub);
+            wp += bw->w[plane];
+            m  += mask_linesize << vsub;
+        }
+        if (bottom)
+            mask_weights_line(wp, alpha, m, mask_linesize, l2depth, w_sub,
+                              hsub, vsub, xm0, left, right, bottom);
+    }
+    return 0;
+}
+
+void ff_blend_weights(FFDrawContext *draw, FFDrawColor *color,
+                      const FFBlendWeights *bw,
+                      uint8_t *dst[], int dst_linesize[], int y_start, int y_end)
+{
+    unsigned plane, comp;
+    int x, y;
+
+    for (plane = 0; plane < bw->nb_planes; plane++) {
+        const int vsub  = draw->vsub[plane];
+        const int step  = draw->pixelstep[plane];
+        const int start = FFMAX(AV_CEIL_RSHIFT(y_start, vsub), bw->y[plane]);
+        const int end   = FFMIN(AV_CEIL_RSHIFT(y_end,   vsub), bw->y[plane] + bw->h[plane]);
+
+        for (comp = 0; comp < step; comp++) {
+            const int depth = draw->desc->comp[comp].depth;
+
+            if (!component_used(draw, plane, comp))
+                continue;
+            for (y = start; y < end; y++) {
+                const uint32_t *w = bw->weights[plane] + (y - bw->y[plane]) * bw->w[plane];
+                uint8_t *p = dst[plane] + y * dst_linesize[plane] +
+                             bw->x[plane] * step + comp;
+
+                if (depth <= 8) {
+                    const unsigned src = color->comp[plane].u8[comp];
+                    for (x = 0; x < bw->w[plane]; x++, p += step) {
+                        const unsigned alpha = w[x];
+                        if (alpha)
+                            *p = ((0x1010101 - alpha) * *p + alpha * src) >> 24;
+                    }
+                } else {
+                    const unsigned src = color->comp[plane].u16[comp];
+                    for (x = 0; x < bw->w[plane]; x++, p += step) {
+                        const unsigned alpha = w[x];
+                        if (alpha)
+                            AV_WL16(p, ((0x10001 - alpha) * AV_RL16(p) + alpha * src) >> 16);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ff_blend_weights_free(FFBlendWeights *bw)
+{
+    int plane;
+
+    for (plane = 0; plane < MAX_PLANES; plane++) {
+        av_freep(&bw->weights[plane]);
+        bw->weights_size[plane] = 0;
+    }
+    bw->nb_planes = 0;
+}
+
 int ff_draw_round_to_sub(FFDrawContext *draw, int sub_dir, int round_dir,
                          int value)
 {
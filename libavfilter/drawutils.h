@@ -140,6 +140,49 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    const uint8_t *mask, int mask_linesize, int mask_w, int mask_h,
                    int l2depth, unsigned endianness, int x0, int y0);
 
+/**
+ * Per-sample blending weights of a mask, to blend the same mask into
+ * several frames without going through the mask again.
+ */
+typedef struct FFBlendWeights {
+    unsigned nb_planes;
+    int x[MAX_PLANES], y[MAX_PLANES]; /*< position of the first sample in each plane */
+    int w[MAX_PLANES], h[MAX_PLANES]; /*< size of the weights in each plane */
+    uint32_t *weights[MAX_PLANES];
+    unsigned weights_size[MAX_PLANES];  /*< allocated size of weights, in bytes */
+} FFBlendWeights;
+
+/**
+ * Compute the weights ff_blend_mask() would use for a mask.
+ *
+ * The parameters are the same as for ff_blend_mask(), with the mask bit
+ * order always MSB to the left. weights must be zeroed before the first
+ * call; later calls reuse its buffers when they are large enough. The
+ * buffers must be freed with ff_blend_weights_free().
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_blend_mask_weights(FFDrawContext *draw, FFDrawColor *color,
+                          FFBlendWeights *weights, int dst_w, int dst_h,
+                          const uint8_t *mask, int mask_linesize, int mask_w, int mask_h,
+                          int l2depth, int x0, int y0);
+
+/**
+ * Blend a uniform color with weights computed by ff_blend_mask_weights().
+ *
+ * The result is the same as ff_blend_mask() with the same mask. Only the
+ * lines between y_start (inclusive) and y_end (exclusive) of the
+ * destination are modified, so that a frame can be processed in slices.
+ */
+void ff_blend_weights(FFDrawContext *draw, FFDrawColor *color,
+                      const FFBlendWeights *weights,
+                      uint8_t *dst[], int dst_linesize[], int y_start, int y_end);
+
+/**
+ * Free the weights computed by ff_blend_mask_weights().
+ */
+void ff_blend_weights_free(FFBlendWeights *weights);
+
 /**
  * Round a dimension according to subsampling.
  *
@@ -546,6 +546,7 @@ AVFilter ff_vf_sendcmd = {
     .inputs      = sendcmd_inputs,
     .outputs     = sendcmd_outputs,
     .priv_class  = &sendcmd_class,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_SERIAL,
 };
 
 #endif
@@ -581,6 +582,7 @@ AVFilter ff_af_asendcmd = {
     .inputs      = asendcmd_inputs,
     .outputs     = asendcmd_outputs,
     .priv_class  = &asendcmd_class,
+    .flags_internal = FF_FILTER_FLAG_GRAPH_SERIAL,
 };
 
 #endif
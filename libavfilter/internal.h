@@ -149,10 +149,26 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Activate nb_filters filters concurrently, storing the return values
+     * in rets. Set when AVFILTER_THREAD_GRAPH is in use.
+     */
+    void (*thread_activate)(AVFilterGraph *graph, AVFilterContext **filters,
+                            int *rets, int nb_filters);
+    AVFilterContext **activate_filters; ///< nb_threads entries
+    int              *activate_rets;    ///< nb_threads entries
+    unsigned          activate_mark;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Last concurrent activation round this filter was found to be too
+     * close to a filter already selected for.
+     */
+    unsigned activate_mark;
 };
 
 /**
@@ -384,6 +400,12 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter accesses other filters of the graph, and must never be
+ * activated concurrently with another filter.
+ */
+#define FF_FILTER_FLAG_GRAPH_SERIAL (1 << 1)
+
 /**
  * Run one round of processing on a filter graph.
  */
@@ -42,6 +42,14 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* graph threading: filters activated concurrently share the slice pool */
+    AVSliceThread  *graph_thread;
+    pthread_mutex_t execute_lock;
+
+    /* per-activate parameters */
+    AVFilterContext **filters;
+    int              *activate_rets;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
@@ -52,11 +60,25 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
+static void graph_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+    c->activate_rets[jobnr] = ff_filter_activate(c->filters[jobnr]);
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
 }
 
+static void graph_thread_uninit(ThreadContext *c)
+{
+    if (!c->graph_thread)
+        return;
+    avpriv_slicethread_free(&c->graph_thread);
+    pthread_mutex_destroy(&c->execute_lock);
+}
+
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
                           void *arg, int *ret, int nb_jobs)
 {
@@ -64,15 +86,29 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    if (c->graph_thread)
+        pthread_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    if (c->graph_thread)
+        pthread_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
+static void thread_activate(AVFilterGraph *graph, AVFilterContext **filters,
+                            int *rets, int nb_filters)
+{
+    ThreadContext *c = graph->internal->thread;
+
+    c->filters       = filters;
+    c->activate_rets = rets;
+    avpriv_slicethread_execute(c->graph_thread, nb_filters, 0);
+}
+
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
@@ -81,6 +117,38 @@ static int thread_init_internal(ThreadContext *c, int nb_threads)
     return FFMAX(nb_threads, 1);
 }
 
+/* Graph threading is optional, failing to set it up only disables it. */
+static void graph_thread_init(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    ThreadContext *c = gi->thread;
+    int nb_threads;
+
+    gi->activate_filters = av_malloc_array(graph->nb_threads, sizeof(*gi->activate_filters));
+    gi->activate_rets    = av_malloc_array(graph->nb_threads, sizeof(*gi->activate_rets));
+    if (!gi->activate_filters || !gi->activate_rets)
+        goto fail;
+
+    if (pthread_mutex_init(&c->execute_lock, NULL))
+        goto fail;
+
+    nb_threads = avpriv_slicethread_create(&c->graph_thread, c, graph_worker_func,
+                                           NULL, graph->nb_threads);
+    if (nb_threads <= 1) {
+        avpriv_slicethread_free(&c->graph_thread);
+        pthread_mutex_destroy(&c->execute_lock);
+        goto fail;
+    }
+
+    gi->thread_activate = thread_activate;
+    return;
+
+fail:
+    av_freep(&gi->activate_filters);
+    av_freep(&gi->activate_rets);
+    graph->thread_type &= ~AVFILTER_THREAD_GRAPH;
+}
+
 int ff_graph_thread_init(AVFilterGraph *graph)
 {
     int ret;
@@ -105,12 +173,20 @@ int ff_graph_thread_init(AVFilterGraph *graph)
 
     graph->internal->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_GRAPH)
+        graph_thread_init(graph);
+
     return 0;
 }
 
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
-    if (graph->internal->thread)
+    if (graph->internal->thread) {
+        graph_thread_uninit(graph->internal->thread);
         slice_thread_uninit(graph->internal->thread);
+    }
     av_freep(&graph->internal->thread);
+    av_freep(&graph->internal->activate_filters);
+    av_freep(&graph->internal->activate_rets);
+    graph->internal->thread_activate = NULL;
 }
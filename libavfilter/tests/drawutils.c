@@ -17,18 +17,77 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
 #include "libavfilter/drawutils.h"
 
+#define W 64
+#define H 48
+#define MASK_W 37
+#define MASK_H 23
+
+/* blend masks with ff_blend_mask() and with the weights of the same masks,
+ * clipped at each edge and at odd positions, and compare */
+static int check_blend(FFDrawContext *draw, FFDrawColor *color, AVLFG *rand)
+{
+    static const int pos[][2] = { { -3, -5 }, { 9, 7 }, { 40, 30 }, { -50, 0 } };
+    uint8_t *ref[4], *dst[4];
+    int ref_linesize[4], dst_linesize[4];
+    uint8_t mask[MASK_W * MASK_H];
+    FFBlendWeights weights = { 0 };
+    int size, l2depth, i, j, ret = 0;
+
+    size = av_image_alloc(ref, ref_linesize, W, H, draw->format, 16);
+    if (size < 0)
+        return size;
+    if ((ret = av_image_alloc(dst, dst_linesize, W, H, draw->format, 16)) < 0) {
+        av_freep(&ref[0]);
+        return ret;
+    }
+    for (i = 0; i < size; i++)
+        ref[0][i] = dst[0][i] = av_lfg_get(rand);
+    for (l2depth = 0; l2depth <= 3; l2depth += 3) {
+        const int linesize = l2depth ? MASK_W : (MASK_W + 7) >> 3;
+
+        for (i = 0; i < sizeof(mask); i++)
+            mask[i] = av_lfg_get(rand);
+        for (i = 0; i < FF_ARRAY_ELEMS(pos); i++) {
+            ff_blend_mask(draw, color, ref, ref_linesize, W, H,
+                          mask, linesize, MASK_W, MASK_H, l2depth, 0,
+                          pos[i][0], pos[i][1]);
+            ret = ff_blend_mask_weights(draw, color, &weights, W, H,
+                                        mask, linesize, MASK_W, MASK_H, l2depth,
+                                        pos[i][0], pos[i][1]);
+            if (ret < 0)
+                goto end;
+            /* in two slices, split on an odd line */
+            for (j = 0; j < 2; j++)
+                ff_blend_weights(draw, color, &weights, dst, dst_linesize,
+                                 j ? 17 : 0, j ? H : 17);
+        }
+    }
+    ret = memcmp(ref[0], dst[0], size) ? 1 : 0;
+end:
+    ff_blend_weights_free(&weights);
+    av_freep(&ref[0]);
+    av_freep(&dst[0]);
+    return ret;
+}
+
 int main(void)
 {
     enum AVPixelFormat f;
     const AVPixFmtDescriptor *desc;
     FFDrawContext draw;
     FFDrawColor color;
+    AVLFG rand;
     int r, i;
 
+    av_lfg_init(&rand, 1);
     for (f = 0; av_pix_fmt_desc_get(f); f++) {
         desc = av_pix_fmt_desc_get(f);
         if (!desc->name)
@@ -50,6 +109,12 @@ int main(void)
             printf("fallback color\n");
             continue;
         }
+        ff_draw_color(&draw, &color, (uint8_t[]) { 255, 128, 32, 160 });
+        r = check_blend(&draw, &color, &rand);
+        if (r) {
+            printf("%s\n", r < 0 ? "blend failed" : "weights differ from the mask");
+            continue;
+        }
         printf("ok\n");
     }
     return 0;
@@ -140,6 +140,22 @@ enum expansion_mode {
     EXP_STRFTIME,
 };
 
+enum text_layer {
+    LAYER_SHADOW,
+    LAYER_BORDER,
+    LAYER_TEXT,
+    LAYER_NB
+};
+
+/**
+ * 8-bit coverage of all the glyphs of the laid out text.
+ */
+typedef struct TextMask {
+    uint8_t *data;                  ///< w x h coverage values, linesize is w
+    int x, y;                       ///< position relative to the text origin
+    int w, h;
+} TextMask;
+
 typedef struct DrawTextContext {
     const AVClass *class;
     int exp_mode;                   ///< expansion mode to use for the text
@@ -203,6 +219,20 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+
+    /* layout and bitmaps of the last drawn text, reused while it does not change */
+    char *layout_text;              ///< expanded text the layout was computed for
+    unsigned int layout_fontsize;   ///< font size the layout was computed for
+    int text_w, text_h;             ///< size of the laid out text
+    int text_ascent, text_descent;  ///< max glyph ascent and descent
+    TextMask text_mask;             ///< prerendered glyphs
+    TextMask border_mask;           ///< prerendered glyph borders
+    FFDrawColor layer_color[LAYER_NB];      ///< colors the layers were last drawn with
+    FFBlendWeights layer_weights[LAYER_NB]; ///< blending weights of the text masks
+    int layers_drawn;               ///< the layers were drawn with the current layout
+    int layers_x, layers_y;         ///< text position the layers were last drawn at
+    int weights_valid;
+    int blend_start, blend_end;     ///< range of lines touched by the weights
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -789,6 +819,22 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, ff_draw_supported_pixel_formats(0));
 }
 
+static void free_text_mask(TextMask *mask)
+{
+    av_freep(&mask->data);
+    mask->w = mask->h = 0;
+}
+
+static void free_layers(DrawTextContext *s)
+{
+    int i;
+
+    for (i = 0; i < LAYER_NB; i++)
+        ff_blend_weights_free(&s->layer_weights[i]);
+    s->layers_drawn  = 0;
+    s->weights_valid = 0;
+}
+
 static int glyph_enu_free(void *opaque, void *elem)
 {
     Glyph *glyph = elem;
@@ -813,6 +859,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->positions);
     s->nb_positions = 0;
 
+    av_freep(&s->layout_text);
+    free_text_mask(&s->text_mask);
+    free_text_mask(&s->border_mask);
+    free_layers(s);
+
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
@@ -836,6 +887,7 @@ static int config_input(AVFilterLink *inlink)
     ff_draw_color(&s->dc, &s->shadowcolor, s->shadowcolor.rgba);
     ff_draw_color(&s->dc, &s->bordercolor, s->bordercolor.rgba);
     ff_draw_color(&s->dc, &s->boxcolor,    s->boxcolor.rgba);
+    free_layers(s);
 
     s->var_values[VAR_w]     = s->var_values[VAR_W]     = s->var_values[VAR_MAIN_W] = inlink->w;
     s->var_values[VAR_h]     = s->var_values[VAR_H]     = s->var_values[VAR_MAIN_H] = inlink->h;
@@ -1209,50 +1261,326 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+/**
+ * Render the glyphs (or their borders if borderw is set) of the laid out
+ * text into a single coverage mask.
+ */
+static int render_text_mask(DrawTextContext *s, TextMask *mask, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
+    int i, x, y, x1, y1, pass;
     uint8_t *p;
     Glyph *glyph = NULL;
 
+    free_text_mask(mask);
+
+    /* the first pass measures the mask, the second fills it */
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0, p = text; *p; i++) {
+            FT_Bitmap bitmap;
+            Glyph dummy = { 0 };
+            GET_UTF8(code, *p++, continue;);
+
+            /* skip new line chars, they have no position */
+            if (is_newline(code) || code == '\t')
+                continue;
+
+            dummy.code = code;
+            dummy.fontsize = s->fontsize;
+            glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+
+            bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+
+            if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+                glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+                return AVERROR(EINVAL);
+
+            x1 = s->positions[i].x - borderw;
+            y1 = s->positions[i].y - borderw;
+
+            if (!pass) {
+                if (bitmap.width && bitmap.rows) {
+                    x_min = FFMIN(x_min, x1);
+                    y_min = FFMIN(y_min, y1);
+                    x_max = FFMAX(x_max, x1 + (int)bitmap.width);
+                    y_max = FFMAX(y_max, y1 + (int)bitmap.rows);
+                }
+                continue;
+            }
+
+            for (y = 0; y < bitmap.rows; y++) {
+                const uint8_t *src = bitmap.buffer + y * bitmap.pitch;
+                uint8_t *dst = mask->data + (y1 - mask->y + y) * mask->w + x1 - mask->x;
+
+                for (x = 0; x < bitmap.width; x++) {
+                    unsigned v = bitmap.pixel_mode == FT_PIXEL_MODE_MONO ?
+                                 (src[x >> 3] >> (~x & 7) & 1) * 255 : src[x];
+                    /* overlapping glyphs: coverage of either */
+                    dst[x] += ((255 - dst[x]) * v + 127) / 255;
+                }
+            }
+        }
+
+        if (!pass) {
+            if (x_min >= x_max || y_min >= y_max)
+                return 0;
+            mask->data = av_mallocz_array(y_max - y_min, x_max - x_min);
+            if (!mask->data)
+                return AVERROR(ENOMEM);
+            mask->x = x_min;
+            mask->y = y_min;
+            mask->w = x_max - x_min;
+            mask->h = y_max - y_min;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Load the glyphs of the expanded text, compute their positions and
+ * prerender the text.
+ */
+static int layout_text(AVFilterContext *ctx)
+{
+    DrawTextContext *s = ctx->priv;
+    uint32_t code = 0, prev_code = 0;
+    int x = 0, y = 0, i = 0, ret;
+    int max_text_line_w = 0, len;
+    char *text = s->expanded_text.str;
+    uint8_t *p;
+    int y_min = 32000, y_max = -32000;
+    int x_min = 32000, x_max = -32000;
+    FT_Vector delta;
+    Glyph *glyph = NULL, *prev_glyph = NULL;
+    Glyph dummy = { 0 };
+
+    av_freep(&s->layout_text);
+    s->layers_drawn  = 0;
+    s->weights_valid = 0;
+
+    if ((len = s->expanded_text.len) > s->nb_positions) {
+        if (!(s->positions =
+              av_realloc(s->positions, len*sizeof(*s->positions))))
+            return AVERROR(ENOMEM);
+        s->nb_positions = len;
+    }
+
+    /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
         GET_UTF8(code, *p++, continue;);
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        /* get glyph */
+        dummy.code = code;
+        dummy.fontsize = s->fontsize;
+        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+        if (!glyph) {
+            ret = load_glyph(ctx, &glyph, code);
+            if (ret < 0)
+                return ret;
+        }
+
+        y_min = FFMIN(glyph->bbox.yMin, y_min);
+        y_max = FFMAX(glyph->bbox.yMax, y_max);
+        x_min = FFMIN(glyph->bbox.xMin, x_min);
+        x_max = FFMAX(glyph->bbox.xMax, x_max);
+    }
+    s->max_glyph_h = y_max - y_min;
+    s->max_glyph_w = x_max - x_min;
+
+    /* compute and save position for each glyph */
+    glyph = NULL;
+    for (i = 0, p = text; *p; i++) {
+        GET_UTF8(code, *p++, continue;);
+
+        /* skip the \n in the sequence \r\n */
+        if (prev_code == '\r' && code == '\n')
+            continue;
+
+        prev_code = code;
+        if (is_newline(code)) {
+
+            max_text_line_w = FFMAX(max_text_line_w, x);
+            y += s->max_glyph_h + s->line_spacing;
+            x = 0;
             continue;
+        }
 
+        /* get glyph */
+        prev_glyph = glyph;
         dummy.code = code;
         dummy.fontsize = s->fontsize;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+        /* kerning */
+        if (s->use_kerning && prev_glyph && glyph->code) {
+            FT_Get_Kerning(s->face, prev_glyph->code, glyph->code,
+                           ft_kerning_default, &delta);
+            x += delta.x >> 6;
+        }
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+        /* save position */
+        s->positions[i].x = x + glyph->bitmap_left;
+        s->positions[i].y = y - glyph->bitmap_top + y_max;
+        if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
+        else              x += glyph->advance;
+    }
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+    s->text_w       = FFMAX(x, max_text_line_w);
+    s->text_h       = y + s->max_glyph_h;
+    s->text_ascent  = y_max;
+    s->text_descent = y_min;
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
-    }
+    if ((ret = render_text_mask(s, &s->text_mask, 0)) < 0 ||
+        (s->borderw && (ret = render_text_mask(s, &s->border_mask, s->borderw)) < 0))
+        return ret;
+
+    s->layout_text = av_strdup(text);
+    if (!s->layout_text)
+        return AVERROR(ENOMEM);
+    s->layout_fontsize = s->fontsize;
+
+    return 0;
+}
+
+/**
+ * Tell whether the color of a drawn layer differs from the one it was last
+ * drawn with. Layers that are not drawn never change.
+ */
+static int layer_color_changed(DrawTextContext *s, enum text_layer layer,
+                               const FFDrawColor *color)
+{
+    if ((layer == LAYER_SHADOW && !s->shadowx && !s->shadowy) ||
+        (layer == LAYER_BORDER && !s->borderw))
+        return 0;
+    return memcmp(s->layer_color[layer].rgba, color->rgba, sizeof(color->rgba));
+}
+
+static void blend_layer(DrawTextContext *s, AVFrame *frame, enum text_layer layer,
+                        const TextMask *mask, int width, int height, int x, int y)
+{
+    if (!mask->data)
+        return;
+    ff_blend_mask(&s->dc, &s->layer_color[layer],
+                  frame->data, frame->linesize, width, height,
+                  mask->data, mask->w, mask->w, mask->h,
+                  3, 0, s->x + x + mask->x, s->y + y + mask->y);
+}
+
+static int update_layer(DrawTextContext *s, enum text_layer layer,
+                        const TextMask *mask, int width, int height, int x, int y)
+{
+    FFBlendWeights *weights = &s->layer_weights[layer];
+    int ret;
+
+    if (!mask->data)
+        return 0;
+    ret = ff_blend_mask_weights(&s->dc, &s->layer_color[layer], weights,
+                                width, height, mask->data, mask->w, mask->w, mask->h,
+                                3, s->x + x + mask->x, s->y + y + mask->y);
+    if (ret < 0 || !weights->nb_planes)
+        return ret;
+
+    s->blend_start = FFMIN(s->blend_start, weights->y[0]);
+    s->blend_end   = FFMAX(s->blend_end,   weights->y[0] + weights->h[0]);
+    return 0;
+}
+
+/**
+ * Compute the blending weights of the shadow, border and text layers for
+ * the colors and the position they were last drawn with.
+ */
+static int update_layers(DrawTextContext *s, int width, int height)
+{
+    int i, ret;
 
+    /* the weight buffers are kept and reused by ff_blend_mask_weights() */
+    for (i = 0; i < LAYER_NB; i++)
+        s->layer_weights[i].nb_planes = 0;
+    s->blend_start = height;
+    s->blend_end   = 0;
+
+    if ((s->shadowx || s->shadowy) &&
+        (ret = update_layer(s, LAYER_SHADOW, &s->text_mask,
+                            width, height, s->shadowx, s->shadowy)) < 0)
+        return ret;
+    if (s->borderw &&
+        (ret = update_layer(s, LAYER_BORDER, &s->border_mask,
+                            width, height, 0, 0)) < 0)
+        return ret;
+    if ((ret = update_layer(s, LAYER_TEXT, &s->text_mask,
+                            width, height, 0, 0)) < 0)
+        return ret;
+
+    /* a subsampled chroma line is blended by the slice of its first luma line */
+    s->blend_start &= ~((1 << s->dc.vsub_max) - 1);
+    s->weights_valid = 1;
+    return 0;
+}
+
+static int draw_layers_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    const int h = s->blend_end - s->blend_start;
+    const int slice_start = s->blend_start + (h *  jobnr   ) / nb_jobs;
+    const int slice_end   = s->blend_start + (h * (jobnr+1)) / nb_jobs;
+    int i;
+
+    for (i = 0; i < LAYER_NB; i++)
+        ff_blend_weights(&s->dc, &s->layer_color[i], &s->layer_weights[i],
+                         frame->data, frame->linesize, slice_start, slice_end);
     return 0;
 }
 
+/**
+ * Blend the shadow, border and text layers.
+ *
+ * Computing the weights and applying them costs more than blending the
+ * masks once, so frames where the text, its position or its colors changed
+ * blend the masks directly. The weights are computed once the layers are
+ * drawn unchanged, and reused with slice threading until the next change.
+ */
+static int draw_layers(AVFilterContext *ctx, AVFrame *frame, int width, int height,
+                       const FFDrawColor *shadowcolor,
+                       const FFDrawColor *bordercolor,
+                       const FFDrawColor *fontcolor)
+{
+    DrawTextContext *s = ctx->priv;
+    int ret;
+
+    if (!s->layers_drawn || s->layers_x != s->x || s->layers_y != s->y ||
+        layer_color_changed(s, LAYER_SHADOW, shadowcolor) ||
+        layer_color_changed(s, LAYER_BORDER, bordercolor) ||
+        layer_color_changed(s, LAYER_TEXT,   fontcolor)) {
+        s->layer_color[LAYER_SHADOW] = *shadowcolor;
+        s->layer_color[LAYER_BORDER] = *bordercolor;
+        s->layer_color[LAYER_TEXT]   = *fontcolor;
+        s->layers_x      = s->x;
+        s->layers_y      = s->y;
+        s->layers_drawn  = 1;
+        s->weights_valid = 0;
+
+        if (s->shadowx || s->shadowy)
+            blend_layer(s, frame, LAYER_SHADOW, &s->text_mask,
+                        width, height, s->shadowx, s->shadowy);
+        if (s->borderw)
+            blend_layer(s, frame, LAYER_BORDER, &s->border_mask,
+                        width, height, 0, 0);
+        blend_layer(s, frame, LAYER_TEXT, &s->text_mask, width, height, 0, 0);
+        return 0;
+    }
+
+    if (!s->weights_valid && (ret = update_layers(s, width, height)) < 0)
+        return ret;
+    if (s->blend_end > s->blend_start)
+        ctx->internal->execute(ctx, draw_layers_slice, frame, NULL,
+                               FFMIN(s->blend_end - s->blend_start,
+                                     ff_filter_get_nb_threads(ctx)));
+    return 0;
+}
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1282,17 +1610,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     DrawTextContext *s = ctx->priv;
     AVFilterLink *inlink = ctx->inputs[0];
 
-    uint32_t code = 0, prev_code = 0;
-    int x = 0, y = 0, i = 0, ret;
-    int max_text_line_w = 0, len;
+    int ret;
     int box_w, box_h;
-    char *text;
-    uint8_t *p;
-    int y_min = 32000, y_max = -32000;
-    int x_min = 32000, x_max = -32000;
-    FT_Vector delta;
-    Glyph *glyph = NULL, *prev_glyph = NULL;
-    Glyph dummy = { 0 };
 
     time_t now = time(0);
     struct tm ltime;
@@ -1331,13 +1650,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     if (!av_bprint_is_complete(bp))
         return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
-    if ((len = s->expanded_text.len) > s->nb_positions) {
-        if (!(s->positions =
-              av_realloc(s->positions, len*sizeof(*s->positions))))
-            return AVERROR(ENOMEM);
-        s->nb_positions = len;
-    }
 
     if (s->fontcolor_expr[0]) {
         /* If expression is set, evaluate and replace the static value */
@@ -1353,81 +1665,23 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
     }
 
-    x = 0;
-    y = 0;
-
     if ((ret = update_fontsize(ctx)) < 0)
         return ret;
 
-    /* load and cache glyphs */
-    for (i = 0, p = text; *p; i++) {
-        GET_UTF8(code, *p++, continue;);
-
-        /* get glyph */
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-        if (!glyph) {
-            ret = load_glyph(ctx, &glyph, code);
-            if (ret < 0)
-                return ret;
-        }
-
-        y_min = FFMIN(glyph->bbox.yMin, y_min);
-        y_max = FFMAX(glyph->bbox.yMax, y_max);
-        x_min = FFMIN(glyph->bbox.xMin, x_min);
-        x_max = FFMAX(glyph->bbox.xMax, x_max);
-    }
-    s->max_glyph_h = y_max - y_min;
-    s->max_glyph_w = x_max - x_min;
-
-    /* compute and save position for each glyph */
-    glyph = NULL;
-    for (i = 0, p = text; *p; i++) {
-        GET_UTF8(code, *p++, continue;);
-
-        /* skip the \n in the sequence \r\n */
-        if (prev_code == '\r' && code == '\n')
-            continue;
-
-        prev_code = code;
-        if (is_newline(code)) {
-
-            max_text_line_w = FFMAX(max_text_line_w, x);
-            y += s->max_glyph_h + s->line_spacing;
-            x = 0;
-            continue;
-        }
-
-        /* get glyph */
-        prev_glyph = glyph;
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-
-        /* kerning */
-        if (s->use_kerning && prev_glyph && glyph->code) {
-            FT_Get_Kerning(s->face, prev_glyph->code, glyph->code,
-                           ft_kerning_default, &delta);
-            x += delta.x >> 6;
-        }
-
-        /* save position */
-        s->positions[i].x = x + glyph->bitmap_left;
-        s->positions[i].y = y - glyph->bitmap_top + y_max;
-        if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
-        else              x += glyph->advance;
+    /* static text, and clocks between ticks, keep their layout */
+    if (!s->layout_text || s->layout_fontsize != s->fontsize ||
+        strcmp(s->layout_text, s->expanded_text.str)) {
+        if ((ret = layout_text(ctx)) < 0)
+            return ret;
     }
 
-    max_text_line_w = FFMAX(x, max_text_line_w);
-
-    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = max_text_line_w;
-    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = y + s->max_glyph_h;
+    s->var_values[VAR_TW] = s->var_values[VAR_TEXT_W] = s->text_w;
+    s->var_values[VAR_TH] = s->var_values[VAR_TEXT_H] = s->text_h;
 
     s->var_values[VAR_MAX_GLYPH_W] = s->max_glyph_w;
     s->var_values[VAR_MAX_GLYPH_H] = s->max_glyph_h;
-    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = y_max;
-    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = y_min;
+    s->var_values[VAR_MAX_GLYPH_A] = s->var_values[VAR_ASCENT ] = s->text_ascent;
+    s->var_values[VAR_MAX_GLYPH_D] = s->var_values[VAR_DESCENT] = s->text_descent;
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
@@ -1442,8 +1696,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     update_color_with_alpha(s, &bordercolor, s->bordercolor);
     update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
 
-    box_w = max_text_line_w;
-    box_h = y + s->max_glyph_h;
+    box_w = s->text_w;
+    box_h = s->text_h;
 
     if (s->fix_bounds) {
 
@@ -1478,22 +1732,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
                            s->x - s->boxborderw, s->y - s->boxborderw,
                            box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
 
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
-
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
-
-    return 0;
+    return draw_layers(ctx, frame, width, height,
+                       &shadowcolor, &bordercolor, &fontcolor);
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
@@ -1567,5 +1807,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -50,6 +50,7 @@ typedef struct GEQContext {
     uint8_t *dst;               ///< reference pointer to the 8bits output
     uint16_t *dst16;            ///< reference pointer to the 16bits output
     double values[VAR_VARS_NB]; ///< expression values
+    double *xs;                 ///< X of every column, for av_expr_eval_batch()
     int hsub, vsub;             ///< chroma subsampling
     int planes;                 ///< number of planes
     int interpolation;
@@ -251,6 +252,7 @@ static int geq_config_props(AVFilterLink *inlink)
 {
     GEQContext *geq = inlink->dst->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     av_assert0(desc);
 
@@ -258,9 +260,18 @@ static int geq_config_props(AVFilterLink *inlink)
     geq->vsub = desc->log2_chroma_h;
     geq->bps = desc->comp[0].depth;
     geq->planes = desc->nb_components;
+
+    av_freep(&geq->xs);
+    geq->xs = av_malloc_array(inlink->w, sizeof(*geq->xs));
+    if (!geq->xs)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < inlink->w; i++)
+        geq->xs[i] = i;
     return 0;
 }
 
+#define BATCH_SIZE 64
+
 typedef struct ThreadData {
     int height;
     int width;
@@ -278,10 +289,11 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     const int linesize = td->linesize;
     const int slice_start = (height *  jobnr) / nb_jobs;
     const int slice_end = (height * (jobnr+1)) / nb_jobs;
-    int x, y;
+    int x, y, i;
     uint8_t *ptr;
     uint16_t *ptr16;
 
+    double res[BATCH_SIZE];
     double values[VAR_VARS_NB];
     values[VAR_W] = geq->values[VAR_W];
     values[VAR_H] = geq->values[VAR_H];
@@ -295,20 +307,23 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
             ptr = geq->dst + linesize * y;
             values[VAR_Y] = y;
 
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr[x] = av_expr_eval(geq->e[plane], values, geq);
+            for (x = 0; x < width; x += BATCH_SIZE) {
+                const int n = FFMIN(width - x, BATCH_SIZE);
+                av_expr_eval_batch(geq->e[plane], res, n, values, VAR_X, geq->xs + x, geq);
+                for (i = 0; i < n; i++)
+                    ptr[x + i] = res[i];
             }
-            ptr += linesize;
         }
     }
     else {
         for (y = slice_start; y < slice_end; y++) {
             ptr16 = geq->dst16 + (linesize/2) * y;
             values[VAR_Y] = y;
-            for (x = 0; x < width; x++) {
-                values[VAR_X] = x;
-                ptr16[x] = av_expr_eval(geq->e[plane], values, geq);
+            for (x = 0; x < width; x += BATCH_SIZE) {
+                const int n = FFMIN(width - x, BATCH_SIZE);
+                av_expr_eval_batch(geq->e[plane], res, n, values, VAR_X, geq->xs + x, geq);
+                for (i = 0; i < n; i++)
+                    ptr16[x + i] = res[i];
             }
         }
     }
@@ -369,6 +384,7 @@ static av_cold void geq_uninit(AVFilterContext *ctx)
 
     for (i = 0; i < FF_ARRAY_ELEMS(geq->e); i++)
         av_expr_free(geq->e[i]);
+    av_freep(&geq->xs);
 }
 
 static const AVFilterPad geq_inputs[] = {
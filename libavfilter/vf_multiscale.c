@@ -0,0 +1,540 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * scale one input to several output sizes
+ *
+ * The input is converted to the output pixel format once when several
+ * outputs read it, and with cascading enabled an output is scaled from a
+ * larger output instead of the input. The outputs of one pass are computed
+ * in parallel, one job per output.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "scale.h"
+#include "video.h"
+
+typedef struct ScaleOutput {
+    int w, h;                   ///< requested size, as for the scale filter
+    int parent;                 ///< output this one is scaled from, -1 for the input
+    int level;                  ///< pass in which the output is computed
+    int passthrough;            ///< output is a reference to the (converted) input
+    struct SwsContext *sws;
+    AVFrame *frame;             ///< frame being produced
+} ScaleOutput;
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    unsigned int flags;         ///< sws flags
+    enum AVPixelFormat format;  ///< requested output format
+    int cascade;
+
+    int nb_outputs;
+    ScaleOutput *outputs;
+    int nb_levels;
+
+    struct SwsContext *convert; ///< input to output format, at the input size
+    AVFrame *converted;
+    int out_full;               ///< the scalers reading the input produce full range
+
+    int configured;
+    int in_w, in_h;             ///< input parameters the scalers were set up for
+    enum AVPixelFormat in_fmt;
+} MultiScaleContext;
+
+typedef struct ThreadData {
+    AVFrame *in;
+    int level;
+} ThreadData;
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    MultiScaleContext *s = ctx->priv;
+    ScaleOutput *o = &s->outputs[FF_OUTLINK_IDX(outlink)];
+    char w_expr[16], h_expr[16];
+    int w, h, ret;
+
+    snprintf(w_expr, sizeof(w_expr), "%d", o->w);
+    snprintf(h_expr, sizeof(h_expr), "%d", o->h);
+    if ((ret = ff_scale_eval_dimensions(ctx, w_expr, h_expr, inlink, outlink,
+                                        &w, &h)) < 0)
+        return ret;
+
+    outlink->w = w;
+    outlink->h = h;
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ h * inlink->w, w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    s->configured = 0;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d w:%d h:%d fmt:%s\n", FF_OUTLINK_IDX(outlink),
+           w, h, av_get_pix_fmt_name(outlink->format));
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *sizes, *p, *saveptr = NULL;
+    int ret;
+
+    if (!s->sizes_str || !*s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes were given.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        if ((ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags)) < 0)
+            return ret;
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+    for (p = av_strtok(sizes, "|", &saveptr); p; p = av_strtok(NULL, "|", &saveptr)) {
+        ScaleOutput *o;
+        AVFilterPad pad = { 0 };
+        int w, h;
+
+        /* WxH with the special values of the scale filter, or a size name */
+        if (sscanf(p, "%dx%d", &w, &h) != 2 &&
+            av_parse_video_size(&w, &h, p) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", p);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        if ((ret = av_reallocp_array(&s->outputs, s->nb_outputs + 1,
+                                     sizeof(*s->outputs))) < 0) {
+            s->nb_outputs = 0;
+            goto end;
+        }
+        o = &s->outputs[s->nb_outputs];
+        memset(o, 0, sizeof(*o));
+        o->w = w;
+        o->h = h;
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.name         = av_asprintf("output%d", s->nb_outputs);
+        pad.config_props = config_output;
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = ff_insert_outpad(ctx, s->nb_outputs, &pad)) < 0) {
+            av_freep(&pad.name);
+            goto end;
+        }
+        s->nb_outputs++;
+    }
+    if (!s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes were given.\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    av_log(ctx, AV_LOG_VERBOSE, "%d outputs flags:'%s' cascade:%d\n", s->nb_outputs,
+           (char *)av_x_if_null(s->flags_str, ""), s->cascade);
+    ret = 0;
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static void free_scalers(MultiScaleContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        sws_freeContext(s->outputs[i].sws);
+        s->outputs[i].sws = NULL;
+    }
+    sws_freeContext(s->convert);
+    s->convert = NULL;
+    s->configured = 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    int i;
+
+    free_scalers(s);
+    for (i = 0; i < s->nb_outputs; i++)
+        av_frame_free(&s->outputs[i].frame);
+    av_frame_free(&s->converted);
+    av_freep(&s->outputs);
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int is_supported_output(enum AVPixelFormat pix_fmt)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmt);
+
+    return sws_isSupportedOutput(pix_fmt) &&
+           !(desc->flags & (AV_PIX_FMT_FLAG_PAL | FF_PSEUDOPAL));
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    enum AVPixelFormat pix_fmt;
+    int i, ret;
+
+    if (s->format == AV_PIX_FMT_NONE) {
+        /* all outputs keep the input format */
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            pix_fmt = av_pix_fmt_desc_get_id(desc);
+            if (sws_isSupportedInput(pix_fmt) && is_supported_output(pix_fmt) &&
+                (ret = ff_add_format(&formats, pix_fmt)) < 0)
+                return ret;
+        }
+        return ff_set_common_formats(ctx, formats);
+    }
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_isSupportedInput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+    if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->out_formats)) < 0)
+        return ret;
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        formats = NULL;
+        if ((ret = ff_add_format(&formats, s->format)) < 0 ||
+            (ret = ff_formats_ref(formats, &ctx->outputs[i]->in_formats)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static struct SwsContext *alloc_scaler(MultiScaleContext *s,
+                                       int srcw, int srch, enum AVPixelFormat srcfmt,
+                                       int dstw, int dsth, enum AVPixelFormat dstfmt)
+{
+    struct SwsContext *sws = sws_alloc_context();
+
+    if (!sws)
+        return NULL;
+    av_opt_set_int(sws, "srcw", srcw, 0);
+    av_opt_set_int(sws, "srch", srch, 0);
+    av_opt_set_int(sws, "src_format", srcfmt, 0);
+    av_opt_set_int(sws, "dstw", dstw, 0);
+    av_opt_set_int(sws, "dsth", dsth, 0);
+    av_opt_set_int(sws, "dst_format", dstfmt, 0);
+    av_opt_set_int(sws, "sws_flags", s->flags, 0);
+    /* MPEG-2 chroma positions, as the scale filter uses by convention */
+    if (srcfmt == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "src_v_chr_pos", 128, 0);
+    if (dstfmt == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(sws, "dst_v_chr_pos", 128, 0);
+    if (sws_init_context(sws, NULL, NULL) < 0)
+        sws_freeContext(sws), sws = NULL;
+    return sws;
+}
+
+static int set_input_range(MultiScaleContext *s, struct SwsContext *sws,
+                           enum AVColorRange range)
+{
+    int in_full, out_full, brightness, contrast, saturation;
+    const int *inv_table, *table;
+
+    sws_getColorspaceDetails(sws, (int **)&inv_table, &in_full,
+                             (int **)&table, &out_full,
+                             &brightness, &contrast, &saturation);
+    if (range != AVCOL_RANGE_UNSPECIFIED)
+        in_full = range == AVCOL_RANGE_JPEG;
+    s->out_full = out_full;
+    return sws_setColorspaceDetails(sws, inv_table, in_full, table, out_full,
+                                    brightness, contrast, saturation);
+}
+
+static int get_level(MultiScaleContext *s, int i)
+{
+    const int parent = s->outputs[i].parent;
+
+    return parent < 0 ? 0 : get_level(s, parent) + 1;
+}
+
+/**
+ * Decide where each output is scaled from and set up the scalers for the
+ * given input.
+ */
+static int config_scalers(AVFilterContext *ctx, const AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    const enum AVPixelFormat fmt = ctx->outputs[0]->format;
+    const AVPixFmtDescriptor *in_desc  = av_pix_fmt_desc_get(in->format);
+    const AVPixFmtDescriptor *out_desc = av_pix_fmt_desc_get(fmt);
+    int i, j, from_input = 0;
+
+    free_scalers(s);
+    s->in_w   = in->width;
+    s->in_h   = in->height;
+    s->in_fmt = in->format;
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        ScaleOutput *o = &s->outputs[i];
+        int64_t best = INT64_MAX;
+
+        o->parent = -1;
+        if (!s->cascade)
+            continue;
+        /* the smallest output at least twice as large in both directions,
+         * so that every hop is a real downscale */
+        for (j = 0; j < s->nb_outputs; j++) {
+            AVFilterLink *l = ctx->outputs[j];
+            const int64_t area = (int64_t)l->w * l->h;
+
+            if (l->w >= 2 * outlink->w && l->h >= 2 * outlink->h &&
+                l->w <= in->width && l->h <= in->height && area < best) {
+                o->parent = j;
+                best      = area;
+            }
+        }
+    }
+
+    s->nb_levels = 1;
+    for (i = 0; i < s->nb_outputs; i++) {
+        s->outputs[i].level = get_level(s, i);
+        s->nb_levels = FFMAX(s->nb_levels, s->outputs[i].level + 1);
+        from_input += s->outputs[i].parent < 0;
+    }
+
+    /* convert once when several outputs read the input, unless that would
+     * lose precision before scaling */
+    if (from_input > 1 && in->format != fmt &&
+        in_desc->comp[0].depth <= out_desc->comp[0].depth) {
+        s->convert = alloc_scaler(s, in->width, in->height, in->format,
+                                  in->width, in->height, fmt);
+        if (!s->convert)
+            return AVERROR(EINVAL);
+        set_input_range(s, s->convert, in->color_range);
+    }
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        ScaleOutput *o = &s->outputs[i];
+        int srcw = in->width, srch = in->height;
+        enum AVPixelFormat srcfmt = s->convert ? fmt : in->format;
+
+        if (o->parent >= 0) {
+            srcw   = ctx->outputs[o->parent]->w;
+            srch   = ctx->outputs[o->parent]->h;
+            srcfmt = fmt;
+        }
+        o->passthrough = o->parent < 0 && srcfmt == fmt &&
+                         outlink->w == srcw && outlink->h == srch;
+        if (o->passthrough)
+            continue;
+        o->sws = alloc_scaler(s, srcw, srch, srcfmt, outlink->w, outlink->h, fmt);
+        if (!o->sws)
+            return AVERROR(EINVAL);
+        if (o->parent < 0 && !s->convert)
+            set_input_range(s, o->sws, in->color_range);
+    }
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        ScaleOutput *o = &s->outputs[i];
+        char from[32] = "input";
+
+        if (o->parent >= 0)
+            snprintf(from, sizeof(from), "output%d", o->parent);
+        av_log(ctx, AV_LOG_VERBOSE, "output%d: %dx%d from %s, pass %d%s\n", i,
+               ctx->outputs[i]->w, ctx->outputs[i]->h, from,
+               o->level, o->passthrough ? " (passthrough)" : "");
+    }
+    av_log(ctx, AV_LOG_VERBOSE, "%dx%d %s -> %s%s\n", in->width, in->height,
+           av_get_pix_fmt_name(in->format), av_get_pix_fmt_name(fmt),
+           s->convert ? " (converted once)" : "");
+
+    s->configured = 1;
+    return 0;
+}
+
+static int scale_output(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MultiScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    ScaleOutput *o = &s->outputs[jobnr];
+    const AVFrame *src;
+
+    if (o->level != td->level || !o->sws)
+        return 0;
+    src = o->parent < 0 ? td->in : s->outputs[o->parent].frame;
+    sws_scale(o->sws, (const uint8_t * const *)src->data, src->linesize,
+              0, src->height, o->frame->data, o->frame->linesize);
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    MultiScaleContext *s = ctx->priv;
+    ThreadData td;
+    int i, ret = 0;
+
+    if (in->colorspace == AVCOL_SPC_YCGCO)
+        av_log(ctx, AV_LOG_WARNING, "Detected unsupported YCgCo colorspace.\n");
+
+    if (!s->configured || in->width != s->in_w || in->height != s->in_h ||
+        in->format != s->in_fmt) {
+        if ((ret = config_scalers(ctx, in)) < 0)
+            goto end;
+    }
+
+    td.in = in;
+    if (s->convert) {
+        /* the converted frame is reused unless an output still holds it */
+        if (!s->converted || !av_frame_is_writable(s->converted)) {
+            av_frame_free(&s->converted);
+            if (!(s->converted = av_frame_alloc())) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            s->converted->format = ctx->outputs[0]->format;
+            s->converted->width  = in->width;
+            s->converted->height = in->height;
+            if ((ret = av_frame_get_buffer(s->converted, 32)) < 0) {
+                av_frame_free(&s->converted);
+                goto end;
+            }
+        }
+        if ((ret = av_frame_copy_props(s->converted, in)) < 0)
+            goto end;
+        sws_scale(s->convert, (const uint8_t * const *)in->data, in->linesize,
+                  0, in->height, s->converted->data, s->converted->linesize);
+        s->converted->color_range = s->out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        td.in = s->converted;
+    }
+
+    for (i = 0; i < s->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        ScaleOutput *o = &s->outputs[i];
+
+        if (o->passthrough) {
+            o->frame = av_frame_clone(td.in);
+            if (!o->frame) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            continue;
+        }
+        o->frame = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!o->frame) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_frame_copy_props(o->frame, in);
+        o->frame->width  = outlink->w;
+        o->frame->height = outlink->h;
+        if (o->parent >= 0 || s->convert ||
+            in->color_range != AVCOL_RANGE_UNSPECIFIED)
+            o->frame->color_range = s->out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        av_reduce(&o->frame->sample_aspect_ratio.num, &o->frame->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * in->width,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * in->height,
+                  INT_MAX);
+    }
+
+    for (td.level = 0; td.level < s->nb_levels; td.level++)
+        ctx->internal->execute(ctx, scale_output, &td, NULL, s->nb_outputs);
+
+    ret = AVERROR_EOF;
+    for (i = 0; i < s->nb_outputs; i++) {
+        AVFrame *out = s->outputs[i].frame;
+
+        s->outputs[i].frame = NULL;
+        if (ff_outlink_get_status(ctx->outputs[i])) {
+            av_frame_free(&out);
+            continue;
+        }
+        if ((ret = ff_filter_frame(ctx->outputs[i], out)) < 0)
+            break;
+    }
+
+end:
+    for (i = 0; i < s->nb_outputs; i++)
+        av_frame_free(&s->outputs[i].frame);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption multiscale_options[] = {
+    { "sizes",   "set the '|'-separated output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { "flags",   "set libswscale flags", OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bilinear" }, 0, 0, FLAGS },
+    { "format",  "set the output pixel format", OFFSET(format), AV_OPT_TYPE_PIXEL_FMT, { .i64 = AV_PIX_FMT_NONE }, -1, INT_MAX, FLAGS },
+    { "cascade", "scale outputs from larger outputs", OFFSET(cascade), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+static const AVFilterPad multiscale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_multiscale = {
+    .name          = "multiscale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes."),
+    .priv_size     = sizeof(MultiScaleContext),
+    .priv_class    = &multiscale_class,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = multiscale_inputs,
+    .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -85,6 +85,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     ff_framesync_uninit(&s->fs);
     av_expr_free(s->x_pexpr); s->x_pexpr = NULL;
     av_expr_free(s->y_pexpr); s->y_pexpr = NULL;
+    av_freep(&s->alpha_map);
+    s->alpha_map_size = 0;
+    av_frame_free(&s->alpha_map_frame);
 }
 
 static inline int normalize_xy(double d, int chroma_sub)
@@ -350,6 +353,94 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+// the overlay alpha is classified in blocks of ALPHA_BLOCK pixels of a row,
+// so that transparent runs can be skipped and opaque runs copied
+#define ALPHA_BLOCK 16
+#define ALPHA_SOME  1   ///< some alpha in the block is not 0
+#define ALPHA_PART  2   ///< some alpha in the block is not 255
+
+static int build_alpha_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    OverlayContext *s = ctx->priv;
+    const AVFrame *src = arg;
+    const int slice_start = (src->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (src->height * (jobnr+1)) / nb_jobs;
+    const int packed = s->overlay_is_packed_rgb;
+    const int step = packed ? s->overlay_pix_step[0] : 1;
+    const ptrdiff_t linesize = src->linesize[packed ? 0 : 3];
+    const uint8_t *ap = packed ? src->data[0] + s->overlay_rgba_map[A] : src->data[3];
+    int i, j, b;
+
+    ap += slice_start * linesize;
+    for (i = slice_start; i < slice_end; i++) {
+        uint8_t *m = s->alpha_map + i * s->alpha_map_linesize;
+        const uint8_t *a = ap;
+
+        for (b = 0; b < s->alpha_map_linesize; b++) {
+            const int jmax = FFMIN(ALPHA_BLOCK, src->width - b * ALPHA_BLOCK);
+            unsigned any = 0, all = 255;
+
+            for (j = 0; j < jmax; j++) {
+                any |= a[j * step];
+                all &= a[j * step];
+            }
+            m[b] = (any ? ALPHA_SOME : 0) | (all != 255 ? ALPHA_PART : 0);
+            a += ALPHA_BLOCK * step;
+        }
+        ap += linesize;
+    }
+    return 0;
+}
+
+/**
+ * Build the alpha map of the overlay frame, unless it was built for the
+ * same frame already. A reference to that frame is kept, so its buffers
+ * cannot be reused by another frame while the map is cached.
+ */
+static int update_alpha_map(AVFilterContext *ctx, const AVFrame *src)
+{
+    OverlayContext *s = ctx->priv;
+    const AVFrame *prev = s->alpha_map_frame;
+    const int plane = s->overlay_is_packed_rgb ? 0 : 3;
+
+    if (prev && prev->data[plane] == src->data[plane] &&
+        prev->linesize[plane] == src->linesize[plane] &&
+        prev->width == src->width && prev->height == src->height)
+        return 0;
+
+    av_frame_free(&s->alpha_map_frame);
+    s->alpha_map_linesize = (src->width + ALPHA_BLOCK - 1) / ALPHA_BLOCK;
+    av_fast_malloc(&s->alpha_map, &s->alpha_map_size,
+                   s->alpha_map_linesize * src->height);
+    if (!s->alpha_map)
+        return AVERROR(ENOMEM);
+    ctx->internal->execute(ctx, build_alpha_map_slice, (void *)src, NULL,
+                           FFMIN(src->height, ff_filter_get_nb_threads(ctx)));
+
+    s->alpha_map_frame = av_frame_clone(src);
+    if (!s->alpha_map_frame)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+/**
+ * Return the alpha flags of the block containing column k of an overlay
+ * row, in units of 1 << hsub pixels, combined over the map rows m0 and m1.
+ * The following blocks with the same flags are merged into the run, whose
+ * end is stored in kend.
+ */
+static av_always_inline int alpha_run(const uint8_t *m0, const uint8_t *m1,
+                                      int k, int kmax, int hsub, int *kend)
+{
+    int b = (k << hsub) / ALPHA_BLOCK;
+    const int flags = m0[b] | m1[b];
+
+    for (b++; (b * ALPHA_BLOCK) >> hsub < kmax && (m0[b] | m1[b]) == flags; b++)
+        ;
+    *kend = FFMIN((b * ALPHA_BLOCK) >> hsub, kmax);
+    return flags;
+}
+
 /**
  * Blend image in src to destination buffer dst at position (x, y).
  */
@@ -389,52 +480,75 @@ static av_always_inline void blend_slice_packed_rgb(AVFilterContext *ctx,
     dp = dst->data[0] + (y + slice_start) * dst->linesize[0];
 
     for (i = slice_start; i < slice_end; i++) {
-        j = FFMAX(-x, 0);
-        S = sp + j     * sstep;
-        d = dp + (x+j) * dstep;
-
-        for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
-            alpha = S[sa];
-
-            // if the main channel has an alpha channel, alpha has to be calculated
-            // to create an un-premultiplied (straight) alpha value
-            if (main_has_alpha && alpha != 0 && alpha != 255) {
-                uint8_t alpha_d = d[da];
-                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+        const uint8_t *m = s->alpha_map + i * s->alpha_map_linesize;
+        int jend;
+
+        jmax = FFMIN(-x + dst_w, src_w);
+        for (j = FFMAX(-x, 0); j < jmax; j = jend) {
+            const int flags = alpha_run(m, m, j, jmax, 0, &jend);
+
+            if (!(flags & ALPHA_SOME))
+                continue;
+
+            S = sp + j     * sstep;
+            d = dp + (x+j) * dstep;
+
+            if (!(flags & ALPHA_PART)) {
+                for (; j < jend; j++) {
+                    d[dr] = S[sr];
+                    d[dg] = S[sg];
+                    d[db] = S[sb];
+                    if (main_has_alpha)
+                        d[da] = S[sa];
+                    d += dstep;
+                    S += sstep;
+                }
+                continue;
             }
 
-            switch (alpha) {
-            case 0:
-                break;
-            case 255:
-                d[dr] = S[sr];
-                d[dg] = S[sg];
-                d[db] = S[sb];
-                break;
-            default:
-                // main_value = main_value * (1 - alpha) + overlay_value * alpha
-                // since alpha is in the range 0-255, the result must divided by 255
-                d[dr] = is_straight ? FAST_DIV255(d[dr] * (255 - alpha) + S[sr] * alpha) :
-                        FFMIN(FAST_DIV255(d[dr] * (255 - alpha)) + S[sr], 255);
-                d[dg] = is_straight ? FAST_DIV255(d[dg] * (255 - alpha) + S[sg] * alpha) :
-                        FFMIN(FAST_DIV255(d[dg] * (255 - alpha)) + S[sg], 255);
-                d[db] = is_straight ? FAST_DIV255(d[db] * (255 - alpha) + S[sb] * alpha) :
-                        FFMIN(FAST_DIV255(d[db] * (255 - alpha)) + S[sb], 255);
-            }
-            if (main_has_alpha) {
+            for (; j < jend; j++) {
+                alpha = S[sa];
+
+                // if the main channel has an alpha channel, alpha has to be calculated
+                // to create an un-premultiplied (straight) alpha value
+                if (main_has_alpha && alpha != 0 && alpha != 255) {
+                    uint8_t alpha_d = d[da];
+                    alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+                }
+
                 switch (alpha) {
                 case 0:
                     break;
                 case 255:
-                    d[da] = S[sa];
+                    d[dr] = S[sr];
+                    d[dg] = S[sg];
+                    d[db] = S[sb];
                     break;
                 default:
-                    // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
-                    d[da] += FAST_DIV255((255 - d[da]) * S[sa]);
+                    // main_value = main_value * (1 - alpha) + overlay_value * alpha
+                    // since alpha is in the range 0-255, the result must divided by 255
+                    d[dr] = is_straight ? FAST_DIV255(d[dr] * (255 - alpha) + S[sr] * alpha) :
+                            FFMIN(FAST_DIV255(d[dr] * (255 - alpha)) + S[sr], 255);
+                    d[dg] = is_straight ? FAST_DIV255(d[dg] * (255 - alpha) + S[sg] * alpha) :
+                            FFMIN(FAST_DIV255(d[dg] * (255 - alpha)) + S[sg], 255);
+                    d[db] = is_straight ? FAST_DIV255(d[db] * (255 - alpha) + S[sb] * alpha) :
+                            FFMIN(FAST_DIV255(d[db] * (255 - alpha)) + S[sb], 255);
                 }
+                if (main_has_alpha) {
+                    switch (alpha) {
+                    case 0:
+                        break;
+                    case 255:
+                        d[da] = S[sa];
+                        break;
+                    default:
+                        // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
+                        d[da] += FAST_DIV255((255 - d[da]) * S[sa]);
+                    }
+                }
+                d += dstep;
+                S += sstep;
             }
-            d += dstep;
-            S += sstep;
         }
         dp += dst->linesize[0];
         sp += src->linesize[0];
@@ -481,67 +595,88 @@ static av_always_inline void blend_plane(AVFilterContext *ctx,
     dap = dst->data[3] + ((yp + slice_start) << vsub) * dst->linesize[3];
 
     for (j = slice_start; j < slice_end; j++) {
-        k = FFMAX(-xp, 0);
-        d = dp + (xp+k) * dst_step;
-        s = sp + k;
-        a = ap + (k<<hsub);
-        da = dap + ((xp+k) << hsub);
+        // alpha rows averaged for this line of the plane
+        const uint8_t *m0 = octx->alpha_map + (j << vsub) * octx->alpha_map_linesize;
+        const uint8_t *m1 = vsub && j+1 < src_hp ? m0 + octx->alpha_map_linesize : m0;
+        int kend;
+
         kmax = FFMIN(-xp + dst_wp, src_wp);
+        for (k = FFMAX(-xp, 0); k < kmax; k = kend) {
+            const int flags = alpha_run(m0, m1, k, kmax, hsub, &kend);
 
-        if (((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {
-            int c = octx->blend_row[i](d, da, s, a, kmax - k, src->linesize[3]);
+            // premultiplied overlay pixels are added even where alpha is 0
+            if (straight && !(flags & ALPHA_SOME))
+                continue;
+
+            d = dp + (xp+k) * dst_step;
+            s = sp + k;
+            a = ap + (k<<hsub);
+            da = dap + ((xp+k) << hsub);
+
+            if (!(flags & ALPHA_PART)) {
+                if (dst_step == 1)
+                    memcpy(d, s, kend - k);
+                else
+                    for (; k < kend; k++, s++, d += dst_step)
+                        *d = *s;
+                continue;
+            }
+
+            if (((vsub && j+1 < src_hp) || !vsub) && octx->blend_row[i]) {
+                int c = octx->blend_row[i](d, da, s, a, kend - k, src->linesize[3]);
+
+                s += c;
+                d += dst_step * c;
+                da += (1 << hsub) * c;
+                a += (1 << hsub) * c;
+                k += c;
+            }
+            for (; k < kend; k++) {
+                int alpha_v, alpha_h, alpha;
 
-            s += c;
-            d += dst_step * c;
-            da += (1 << hsub) * c;
-            a += (1 << hsub) * c;
-            k += c;
-        }
-        for (; k < kmax; k++) {
-            int alpha_v, alpha_h, alpha;
-
-            // average alpha for color components, improve quality
-            if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
-                alpha = (a[0] + a[src->linesize[3]] +
-                         a[1] + a[src->linesize[3]+1]) >> 2;
-            } else if (hsub || vsub) {
-                alpha_h = hsub && k+1 < src_wp ?
-                    (a[0] + a[1]) >> 1 : a[0];
-                alpha_v = vsub && j+1 < src_hp ?
-                    (a[0] + a[src->linesize[3]]) >> 1 : a[0];
-                alpha = (alpha_v + alpha_h) >> 1;
-            } else
-                alpha = a[0];
-            // if the main channel has an alpha channel, alpha has to be calculated
-            // to create an un-premultiplied (straight) alpha value
-            if (main_has_alpha && alpha != 0 && alpha != 255) {
                 // average alpha for color components, improve quality
-                uint8_t alpha_d;
                 if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
-                    alpha_d = (da[0] + da[dst->linesize[3]] +
-                               da[1] + da[dst->linesize[3]+1]) >> 2;
+                    alpha = (a[0] + a[src->linesize[3]] +
+                             a[1] + a[src->linesize[3]+1]) >> 2;
                 } else if (hsub || vsub) {
                     alpha_h = hsub && k+1 < src_wp ?
-                        (da[0] + da[1]) >> 1 : da[0];
+                        (a[0] + a[1]) >> 1 : a[0];
                     alpha_v = vsub && j+1 < src_hp ?
-                        (da[0] + da[dst->linesize[3]]) >> 1 : da[0];
-                    alpha_d = (alpha_v + alpha_h) >> 1;
+                        (a[0] + a[src->linesize[3]]) >> 1 : a[0];
+                    alpha = (alpha_v + alpha_h) >> 1;
                 } else
-                    alpha_d = da[0];
-                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
-            }
-            if (straight) {
-                *d = FAST_DIV255(*d * (255 - alpha) + *s * alpha);
-            } else {
-                if (i && yuv)
-                    *d = av_clip(FAST_DIV255((*d - 128) * (255 - alpha)) + *s - 128, -128, 128) + 128;
-                else
-                    *d = FFMIN(FAST_DIV255(*d * (255 - alpha)) + *s, 255);
+                    alpha = a[0];
+                // if the main channel has an alpha channel, alpha has to be calculated
+                // to create an un-premultiplied (straight) alpha value
+                if (main_has_alpha && alpha != 0 && alpha != 255) {
+                    // average alpha for color components, improve quality
+                    uint8_t alpha_d;
+                    if (hsub && vsub && j+1 < src_hp && k+1 < src_wp) {
+                        alpha_d = (da[0] + da[dst->linesize[3]] +
+                                   da[1] + da[dst->linesize[3]+1]) >> 2;
+                    } else if (hsub || vsub) {
+                        alpha_h = hsub && k+1 < src_wp ?
+                            (da[0] + da[1]) >> 1 : da[0];
+                        alpha_v = vsub && j+1 < src_hp ?
+                            (da[0] + da[dst->linesize[3]]) >> 1 : da[0];
+                        alpha_d = (alpha_v + alpha_h) >> 1;
+                    } else
+                        alpha_d = da[0];
+                    alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+                }
+                if (straight) {
+                    *d = FAST_DIV255(*d * (255 - alpha) + *s * alpha);
+                } else {
+                    if (i && yuv)
+                        *d = av_clip(FAST_DIV255((*d - 128) * (255 - alpha)) + *s - 128, -128, 128) + 128;
+                    else
+                        *d = FFMIN(FAST_DIV255(*d * (255 - alpha)) + *s, 255);
+                }
+                s++;
+                d += dst_step;
+                da += 1 << hsub;
+                a += 1 << hsub;
             }
-            s++;
-            d += dst_step;
-            da += 1 << hsub;
-            a += 1 << hsub;
         }
         dp += dst->linesize[dst_plane];
         sp += src->linesize[i];
@@ -550,7 +685,8 @@ static av_always_inline void blend_plane(AVFilterContext *ctx,
     }
 }
 
-static inline void alpha_composite(const AVFrame *src, const AVFrame *dst,
+static inline void alpha_composite(const OverlayContext *octx,
+                                   const AVFrame *src, const AVFrame *dst,
                                    int src_w, int src_h,
                                    int dst_w, int dst_h,
                                    int x, int y,
@@ -570,28 +706,43 @@ static inline void alpha_composite(const AVFrame *src, const AVFrame *dst,
     da = dst->data[3] + (y + i + slice_start) * dst->linesize[3];
 
     for (i = i + slice_start; i < slice_end; i++) {
-        j = FFMAX(-x, 0);
-        s = sa + j;
-        d = da + x+j;
-
-        for (jmax = FFMIN(-x + dst_w, src_w); j < jmax; j++) {
-            alpha = *s;
-            if (alpha != 0 && alpha != 255) {
-                uint8_t alpha_d = *d;
-                alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+        const uint8_t *m = octx->alpha_map + i * octx->alpha_map_linesize;
+        int jend;
+
+        jmax = FFMIN(-x + dst_w, src_w);
+        for (j = FFMAX(-x, 0); j < jmax; j = jend) {
+            const int flags = alpha_run(m, m, j, jmax, 0, &jend);
+
+            if (!(flags & ALPHA_SOME))
+                continue;
+
+            s = sa + j;
+            d = da + x+j;
+
+            if (!(flags & ALPHA_PART)) {
+                memset(d, 255, jend - j);
+                continue;
             }
-            switch (alpha) {
-            case 0:
-                break;
-            case 255:
-                *d = *s;
-                break;
-            default:
-                // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
-                *d += FAST_DIV255((255 - *d) * *s);
+
+            for (; j < jend; j++) {
+                alpha = *s;
+                if (alpha != 0 && alpha != 255) {
+                    uint8_t alpha_d = *d;
+                    alpha = UNPREMULTIPLY_ALPHA(alpha, alpha_d);
+                }
+                switch (alpha) {
+                case 0:
+                    break;
+                case 255:
+                    *d = *s;
+                    break;
+                default:
+                    // apply alpha compositing: main_alpha += (1-main_alpha) * overlay_alpha
+                    *d += FAST_DIV255((255 - *d) * *s);
+                }
+                d += 1;
+                s += 1;
             }
-            d += 1;
-            s += 1;
         }
         da += dst->linesize[3];
         sa += src->linesize[3];
@@ -623,7 +774,7 @@ static av_always_inline void blend_slice_yuv(AVFilterContext *ctx,
                 jobnr, nb_jobs);
 
     if (main_has_alpha)
-        alpha_composite(src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
+        alpha_composite(s, src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
 }
 
 static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
@@ -652,7 +803,7 @@ static av_always_inline void blend_slice_planar_rgb(AVFilterContext *ctx,
                 jobnr, nb_jobs);
 
     if (main_has_alpha)
-        alpha_composite(src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
+        alpha_composite(s, src, dst, src_w, src_h, dst_w, dst_h, x, y, jobnr, nb_jobs);
 }
 
 static int blend_slice_yuv420(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
@@ -965,6 +1116,11 @@ static int do_blend(FFFrameSync *fs)
         s->y < mainpic->height && s->y + second->height >= 0) {
         ThreadData td;
 
+        if ((ret = update_alpha_map(ctx, second)) < 0) {
+            av_frame_free(&mainpic);
+            return ret;
+        }
+
         td.dst = mainpic;
         td.src = second;
         ctx->internal->execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(s->y + second->height, FFMIN(second->height, mainpic->height), mainpic->height - s->y)),
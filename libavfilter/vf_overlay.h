@@ -75,6 +75,11 @@ typedef struct OverlayContext {
 
     AVExpr *x_pexpr, *y_pexpr;
 
+    uint8_t *alpha_map;         ///< ALPHA_* flags of each block of overlay pixels
+    unsigned int alpha_map_size;
+    int alpha_map_linesize;     ///< number of blocks in an overlay row
+    AVFrame *alpha_map_frame;   ///< reference to the overlay frame alpha_map was built for
+
     int (*blend_row[4])(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a, int w,
                         ptrdiff_t alinesize);
     int (*blend_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
@@ -0,0 +1,416 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Run saccubus adapter plugins inside a filtergraph.
+ *
+ * The plugin is loaded with the same SaccConfigure/SaccMeasure/SaccProcess/
+ * SaccRelease entry points the saccubus input device uses, but decoding and
+ * scaling are left to the rest of the graph.
+ */
+
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "compat/saccubus/saccubus_host.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define SACC_DELIM '#'
+
+typedef struct SaccubusContext {
+    const AVClass *class;
+    char *adapter;
+    char *args;
+
+    void *dl_handle;
+    SaccConfigureFnPtr configure;
+    SaccMeasureFnPtr measure;
+    SaccProcessFnPtr process;
+    SaccReleaseFnPtr release;
+    void *priv;
+    int configured;
+    int argc;
+    char **argv;
+
+    SaccToolBox toolbox;
+    enum AVPixelFormat pix_fmt;
+    int dst_w, dst_h;
+    uint8_t *overlay;
+    int overlay_linesize;
+    AVFrame *prev;              ///< last output, drawn over again by legacy plugins
+} SaccubusContext;
+
+typedef struct ThreadData {
+    AVFrame *out;
+} ThreadData;
+
+#define OFFSET(x) offsetof(SaccubusContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption saccubus_options[] = {
+    { "adapter", "set the saccubus adapter library to load", OFFSET(adapter), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { "args",    "set the '#'-separated adapter arguments",  OFFSET(args),    AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(saccubus);
+
+static int toolbox_load_video(SaccToolBox *box, const char *filename)
+{
+    SaccubusContext *s = box->ptr;
+    av_log(s, AV_LOG_WARNING, "loadVideo(\"%s\") is not available inside a filtergraph\n", filename);
+    return AVERROR(ENOSYS);
+}
+
+static void *load_sym(AVFilterContext *ctx, const char *sym_name)
+{
+    SaccubusContext *s = ctx->priv;
+    void *sym = dlsym(s->dl_handle, sym_name);
+    if (!sym)
+        av_log(ctx, AV_LOG_ERROR, "Could not find symbol '%s' in loaded module.\n", sym_name);
+    return sym;
+}
+
+static int split_args(AVFilterContext *ctx)
+{
+    SaccubusContext *s = ctx->priv;
+    const char *p = s->args ? s->args : "";
+
+    /* argv[0] is the adapter path, as with the input device */
+    if (!(s->argv = av_mallocz_array(2, sizeof(*s->argv))) ||
+        !(s->argv[s->argc++] = av_strdup(s->adapter)))
+        return AVERROR(ENOMEM);
+    if (!s->args)
+        return 0;
+    for (;;) {
+        const char *end = strchr(p, SACC_DELIM);
+        size_t len = end ? end - p : strlen(p);
+        char **argv = av_realloc_array(s->argv, s->argc + 2, sizeof(*s->argv));
+        if (!argv)
+            return AVERROR(ENOMEM);
+        s->argv = argv;
+        if (!(s->argv[s->argc] = av_strndup(p, len)))
+            return AVERROR(ENOMEM);
+        s->argv[++s->argc] = NULL;
+        if (!end)
+            break;
+        p = end + 1;
+    }
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    SaccubusContext *s = ctx->priv;
+    int ret;
+
+    if (!s->adapter) {
+        av_log(ctx, AV_LOG_ERROR, "No adapter specified.\n");
+        return AVERROR(EINVAL);
+    }
+    s->dl_handle = dlopen(s->adapter, RTLD_NOW|RTLD_LOCAL);
+    if (!s->dl_handle) {
+        av_log(ctx, AV_LOG_ERROR, "Could not load adapter '%s': %s\n", s->adapter, sacc_dlerror());
+        return AVERROR(EINVAL);
+    }
+    if (!(s->configure = load_sym(ctx, "SaccConfigure")) ||
+        !(s->measure   = load_sym(ctx, "SaccMeasure"))   ||
+        !(s->process   = load_sym(ctx, "SaccProcess"))   ||
+        !(s->release   = load_sym(ctx, "SaccRelease")))
+        return AVERROR(EINVAL);
+
+    if ((ret = split_args(ctx)) < 0)
+        return ret;
+
+    s->toolbox.ptr                 = s;
+    s->toolbox.version             = TOOLBOX_VERSION;
+    s->toolbox.loadVideo           = toolbox_load_video;
+    s->toolbox.seek                = NULL;
+    s->toolbox.currentVideo.width  = -1;
+    s->toolbox.currentVideo.height = -1;
+    s->toolbox.currentVideo.length = -1;
+    s->toolbox.surfaceFormat       = SACC_SURFACE_RGB32;
+    s->toolbox.flags               = 0;
+
+    ret = s->configure(&s->priv, &s->toolbox, s->argc, s->argv);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to configure adapter.\n");
+        return AVERROR_EXTERNAL;
+    }
+    s->configured = 1;
+
+    switch (s->toolbox.surfaceFormat) {
+    case SACC_SURFACE_RGB32:        s->pix_fmt = AV_PIX_FMT_RGB32;   break;
+    case SACC_SURFACE_YUV420P:
+    case SACC_SURFACE_RGBA_OVERLAY: s->pix_fmt = AV_PIX_FMT_YUV420P; break;
+    case SACC_SURFACE_NV12:         s->pix_fmt = AV_PIX_FMT_NV12;    break;
+    default:
+        av_log(ctx, AV_LOG_ERROR, "Unknown surface format %d.\n", s->toolbox.surfaceFormat);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    SaccubusContext *s = ctx->priv;
+    int i;
+
+    if (s->configured)
+        s->release(s->priv, &s->toolbox);
+    if (s->dl_handle)
+        dlclose(s->dl_handle);
+    for (i = 0; i < s->argc; i++)
+        av_freep(&s->argv[i]);
+    av_freep(&s->argv);
+    av_freep(&s->overlay);
+    av_frame_free(&s->prev);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    SaccubusContext *s = ctx->priv;
+    const enum AVPixelFormat pix_fmts[] = { s->pix_fmt, AV_PIX_FMT_NONE };
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    SaccubusContext *s = ctx->priv;
+    int surface_format = s->toolbox.surfaceFormat;
+
+    s->toolbox.currentVideo.width  = inlink->w;
+    s->toolbox.currentVideo.height = inlink->h;
+    s->measure(s->priv, &s->toolbox, inlink->w, inlink->h, &s->dst_w, &s->dst_h);
+    if (s->toolbox.surfaceFormat != surface_format) {
+        av_log(ctx, AV_LOG_ERROR, "The surface format must be chosen in SaccConfigure when used as a filter.\n");
+        return AVERROR(EINVAL);
+    }
+    if (s->pix_fmt != AV_PIX_FMT_RGB32) {
+        s->dst_w = FFALIGN(s->dst_w, 2);
+        s->dst_h = FFALIGN(s->dst_h, 2);
+    }
+    if (s->dst_w <= 0 || s->dst_h <= 0 || av_image_check_size(s->dst_w, s->dst_h, 0, ctx) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid output size %dx%d.\n", s->dst_w, s->dst_h);
+        return AVERROR(EINVAL);
+    }
+    av_log(ctx, AV_LOG_VERBOSE, "%dx%d -> %dx%d\n", inlink->w, inlink->h, s->dst_w, s->dst_h);
+
+    if (s->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY) {
+        av_freep(&s->overlay);
+        s->overlay_linesize = FFALIGN(s->dst_w * 4, 32);
+        if (!(s->overlay = av_mallocz(s->overlay_linesize * s->dst_h)))
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    SaccubusContext *s = outlink->src->priv;
+
+    outlink->w = s->dst_w;
+    outlink->h = s->dst_h;
+    return 0;
+}
+
+static void fill_frame(SaccFrame *frame, double vpos, int format,
+                       uint8_t *const data[4], const int linesize[4], int w, int h)
+{
+    const int nb_planes = format == SACC_SURFACE_YUV420P ? 3 :
+                          format == SACC_SURFACE_NV12    ? 2 : 1;
+    int i;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->vpos     = vpos;
+    frame->data     = data[0];
+    frame->linesize = linesize[0];
+    frame->w        = w;
+    frame->h        = h;
+    frame->format   = format;
+    for (i = 0; i < nb_planes; i++) {
+        frame->planes[i]    = data[i];
+        frame->linesizes[i] = linesize[i];
+    }
+}
+
+static void place_video(SaccubusContext *s, AVFrame *out, const AVFrame *in)
+{
+    const int w = FFMIN(in->width,  s->dst_w);
+    const int h = FFMIN(in->height, s->dst_h);
+    const int x = ((s->dst_w - w) / 2) & ~1;
+    const int y = ((s->dst_h - h) / 2) & ~1;
+    uint8_t *dst[4] = { NULL };
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        const int shift = i ? 1 : 0;
+        if (w < s->dst_w || h < s->dst_h)
+            memset(out->data[i], i ? 128 : 16,
+                   out->linesize[i] * AV_CEIL_RSHIFT(s->dst_h, shift));
+        dst[i] = out->data[i] + (y >> shift) * out->linesize[i] + (x >> shift);
+    }
+    av_image_copy(dst, out->linesize, (const uint8_t **)in->data, in->linesize,
+                  AV_PIX_FMT_YUV420P, w, h);
+}
+
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SaccubusContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int rows  = s->dst_h / 2;
+    const int start = 2 * (rows *  jobnr     ) / nb_jobs;
+    const int end   = 2 * (rows * (jobnr + 1)) / nb_jobs;
+
+    sacc_blend_overlay(td->out->data, td->out->linesize, s->overlay, s->overlay_linesize,
+                       0, start, s->dst_w, end);
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    SaccubusContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    const int overlay_mode = s->toolbox.surfaceFormat == SACC_SURFACE_RGBA_OVERLAY;
+    const int legacy = sacc_is_legacy(&s->toolbox);
+    const double vpos = in->pts == AV_NOPTS_VALUE ? NAN : in->pts * av_q2d(inlink->time_base);
+    SaccFrame target, video;
+    int target_flags = SACC_FRAME_FULL_REDRAW;
+    AVFrame *out;
+    int ret;
+
+    if (legacy && s->prev) {
+        /* v2 plugins draw over their previous output, as with the input device */
+        if (av_frame_is_writable(s->prev)) {
+            out = s->prev;
+            s->prev = NULL;
+        } else {
+            out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+            if (!out) {
+                av_frame_free(&in);
+                return AVERROR(ENOMEM);
+            }
+            if ((ret = av_frame_copy(out, s->prev)) < 0) {
+                av_frame_free(&out);
+                av_frame_free(&in);
+                return ret;
+            }
+        }
+        av_frame_copy_props(out, in);
+        target_flags = SACC_FRAME_PREVIOUS;
+    } else if (overlay_mode && in->width == s->dst_w && in->height == s->dst_h) {
+        /* the layer is blended straight into the incoming picture */
+        if ((ret = av_frame_make_writable(in)) < 0) {
+            av_frame_free(&in);
+            return ret;
+        }
+        out = in;
+    } else {
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        av_frame_copy_props(out, in);
+        if (overlay_mode)
+            place_video(s, out, in);
+    }
+
+    fill_frame(&video, vpos, overlay_mode ? SACC_SURFACE_YUV420P : s->toolbox.surfaceFormat,
+               in->data, in->linesize, in->width, in->height);
+    if (overlay_mode) {
+        uint8_t *layer[4]     = { s->overlay };
+        int layer_linesize[4] = { s->overlay_linesize };
+        fill_frame(&target, vpos, SACC_SURFACE_RGBA_OVERLAY,
+                   layer, layer_linesize, s->dst_w, s->dst_h);
+    } else
+        fill_frame(&target, vpos, s->toolbox.surfaceFormat,
+                   out->data, out->linesize, s->dst_w, s->dst_h);
+    target.flags = target_flags;
+
+    ret = s->process(s->priv, &s->toolbox, &target, &video);
+    if (ret < 0 && !legacy) {
+        av_log(ctx, AV_LOG_ERROR, "SaccProcess failed with %d.\n", ret);
+        if (out != in)
+            av_frame_free(&out);
+        av_frame_free(&in);
+        return AVERROR_EXTERNAL;
+    }
+
+    if (overlay_mode) {
+        ThreadData td = { .out = out };
+        ctx->internal->execute(ctx, blend_slice, &td, NULL,
+                               FFMIN(s->dst_h / 2, ff_filter_get_nb_threads(ctx)));
+    }
+    if (out != in)
+        av_frame_free(&in);
+    if (legacy) {
+        av_frame_free(&s->prev);
+        if (!(s->prev = av_frame_clone(out))) {
+            av_frame_free(&out);
+            return AVERROR(ENOMEM);
+        }
+    }
+    return ff_filter_frame(outlink, out);
+}
+
+static const AVFilterPad saccubus_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad saccubus_outputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_output,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_saccubus = {
+    .name          = "saccubus",
+    .description   = NULL_IF_CONFIG_SMALL("Composite video with a saccubus adapter plugin."),
+    .priv_size     = sizeof(SaccubusContext),
+    .priv_class    = &saccubus_class,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = saccubus_inputs,
+    .outputs       = saccubus_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -47,10 +47,17 @@ enum EvalMode {
     EVAL_MODE_NB
 };
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
 typedef struct ScaleContext {
     const AVClass *class;
     struct SwsContext *sws;     ///< software scaler context
     struct SwsContext *isws[2]; ///< software scaler context for interlaced material
+    struct SwsContext **slice_sws; ///< additional contexts for slice threading
+    int nb_slice_sws;
+    int *slice_ret;
     AVDictionary *opts;
 
     /**
@@ -146,6 +153,17 @@ static av_cold int init_dict(AVFilterContext *ctx, AVDictionary **opts)
     return 0;
 }
 
+static void free_slice_contexts(ScaleContext *scale)
+{
+    int i;
+
+    for (i = 0; i < scale->nb_slice_sws; i++)
+        sws_freeContext(scale->slice_sws[i]);
+    av_freep(&scale->slice_sws);
+    av_freep(&scale->slice_ret);
+    scale->nb_slice_sws = 0;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
@@ -153,6 +171,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     sws_freeContext(scale->isws[0]);
     sws_freeContext(scale->isws[1]);
     scale->sws = NULL;
+    free_slice_contexts(scale);
     av_dict_free(&scale->opts);
 }
 
@@ -218,6 +237,63 @@ static const int *parse_yuv_type(const char *s, enum AVColorSpace colorspace)
     return sws_getCoefficients(colorspace);
 }
 
+/**
+ * Allocate and initialize a scaler for the whole frame (field 0) or for
+ * the top (1) or bottom (2) field.
+ */
+static int init_sws(ScaleContext *scale, struct SwsContext **s,
+                    AVFilterLink *inlink0, AVFilterLink *outlink,
+                    enum AVPixelFormat outfmt, int i)
+{
+    int in_v_chr_pos = scale->in_v_chr_pos, out_v_chr_pos = scale->out_v_chr_pos;
+    int ret;
+
+    *s = sws_alloc_context();
+    if (!*s)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(*s, "srcw", inlink0 ->w, 0);
+    av_opt_set_int(*s, "srch", inlink0 ->h >> !!i, 0);
+    av_opt_set_int(*s, "src_format", inlink0->format, 0);
+    av_opt_set_int(*s, "dstw", outlink->w, 0);
+    av_opt_set_int(*s, "dsth", outlink->h >> !!i, 0);
+    av_opt_set_int(*s, "dst_format", outfmt, 0);
+    av_opt_set_int(*s, "sws_flags", scale->flags, 0);
+    av_opt_set_int(*s, "param0", scale->param[0], 0);
+    av_opt_set_int(*s, "param1", scale->param[1], 0);
+    if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
+        av_opt_set_int(*s, "src_range",
+                       scale->in_range == AVCOL_RANGE_JPEG, 0);
+    if (scale->out_range != AVCOL_RANGE_UNSPECIFIED)
+        av_opt_set_int(*s, "dst_range",
+                       scale->out_range == AVCOL_RANGE_JPEG, 0);
+
+    if (scale->opts) {
+        AVDictionaryEntry *e = NULL;
+        while ((e = av_dict_get(scale->opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
+            if ((ret = av_opt_set(*s, e->key, e->value, 0)) < 0)
+                return ret;
+        }
+    }
+    /* Override YUV420P default settings to have the correct (MPEG-2) chroma positions
+     * MPEG-2 chroma positions are used by convention
+     * XXX: support other 4:2:0 pixel formats */
+    if (inlink0->format == AV_PIX_FMT_YUV420P && scale->in_v_chr_pos == -513) {
+        in_v_chr_pos = (i == 0) ? 128 : (i == 1) ? 64 : 192;
+    }
+
+    if (outlink->format == AV_PIX_FMT_YUV420P && scale->out_v_chr_pos == -513) {
+        out_v_chr_pos = (i == 0) ? 128 : (i == 1) ? 64 : 192;
+    }
+
+    av_opt_set_int(*s, "src_h_chr_pos", scale->in_h_chr_pos, 0);
+    av_opt_set_int(*s, "src_v_chr_pos", in_v_chr_pos, 0);
+    av_opt_set_int(*s, "dst_h_chr_pos", scale->out_h_chr_pos, 0);
+    av_opt_set_int(*s, "dst_v_chr_pos", out_v_chr_pos, 0);
+
+    return sws_init_context(*s, NULL, NULL);
+}
+
 static int config_props(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -285,6 +361,7 @@ static int config_props(AVFilterLink *outlink)
     if (scale->isws[1])
         sws_freeContext(scale->isws[1]);
     scale->isws[0] = scale->isws[1] = scale->sws = NULL;
+    free_slice_contexts(scale);
     if (inlink0->w == outlink->w &&
         inlink0->h == outlink->h &&
         !scale->out_color_matrix &&
@@ -293,59 +370,30 @@ static int config_props(AVFilterLink *outlink)
         ;
     else {
         struct SwsContext **swscs[3] = {&scale->sws, &scale->isws[0], &scale->isws[1]};
-        int i;
+        int i, nb_slices;
 
         for (i = 0; i < 3; i++) {
-            int in_v_chr_pos = scale->in_v_chr_pos, out_v_chr_pos = scale->out_v_chr_pos;
-            struct SwsContext **s = swscs[i];
-            *s = sws_alloc_context();
-            if (!*s)
-                return AVERROR(ENOMEM);
-
-            av_opt_set_int(*s, "srcw", inlink0 ->w, 0);
-            av_opt_set_int(*s, "srch", inlink0 ->h >> !!i, 0);
-            av_opt_set_int(*s, "src_format", inlink0->format, 0);
-            av_opt_set_int(*s, "dstw", outlink->w, 0);
-            av_opt_set_int(*s, "dsth", outlink->h >> !!i, 0);
-            av_opt_set_int(*s, "dst_format", outfmt, 0);
-            av_opt_set_int(*s, "sws_flags", scale->flags, 0);
-            av_opt_set_int(*s, "param0", scale->param[0], 0);
-            av_opt_set_int(*s, "param1", scale->param[1], 0);
-            if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
-                av_opt_set_int(*s, "src_range",
-                               scale->in_range == AVCOL_RANGE_JPEG, 0);
-            if (scale->out_range != AVCOL_RANGE_UNSPECIFIED)
-                av_opt_set_int(*s, "dst_range",
-                               scale->out_range == AVCOL_RANGE_JPEG, 0);
-
-            if (scale->opts) {
-                AVDictionaryEntry *e = NULL;
-                while ((e = av_dict_get(scale->opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
-                    if ((ret = av_opt_set(*s, e->key, e->value, 0)) < 0)
-                        return ret;
-                }
-            }
-            /* Override YUV420P default settings to have the correct (MPEG-2) chroma positions
-             * MPEG-2 chroma positions are used by convention
-             * XXX: support other 4:2:0 pixel formats */
-            if (inlink0->format == AV_PIX_FMT_YUV420P && scale->in_v_chr_pos == -513) {
-                in_v_chr_pos = (i == 0) ? 128 : (i == 1) ? 64 : 192;
-            }
-
-            if (outlink->format == AV_PIX_FMT_YUV420P && scale->out_v_chr_pos == -513) {
-                out_v_chr_pos = (i == 0) ? 128 : (i == 1) ? 64 : 192;
-            }
-
-            av_opt_set_int(*s, "src_h_chr_pos", scale->in_h_chr_pos, 0);
-            av_opt_set_int(*s, "src_v_chr_pos", in_v_chr_pos, 0);
-            av_opt_set_int(*s, "dst_h_chr_pos", scale->out_h_chr_pos, 0);
-            av_opt_set_int(*s, "dst_v_chr_pos", out_v_chr_pos, 0);
-
-            if ((ret = sws_init_context(*s, NULL, NULL)) < 0)
+            if ((ret = init_sws(scale, swscs[i], inlink0, outlink, outfmt, i)) < 0)
                 return ret;
             if (!scale->interlaced)
                 break;
         }
+
+        /* slice threading runs sws_scale_dst_slice() on one context per
+         * slice, so that the output is the same as with a single context */
+        nb_slices = FFMIN(ff_filter_get_nb_threads(ctx), outlink->h / 16);
+        if (scale->interlaced <= 0 && !scale->nb_slices && nb_slices > 1) {
+            scale->slice_sws = av_mallocz_array(nb_slices - 1, sizeof(*scale->slice_sws));
+            scale->slice_ret = av_malloc_array(nb_slices, sizeof(*scale->slice_ret));
+            if (!scale->slice_sws || !scale->slice_ret)
+                return AVERROR(ENOMEM);
+            for (i = 0; i < nb_slices - 1; i++) {
+                ret = init_sws(scale, &scale->slice_sws[i], inlink0, outlink, outfmt, 0);
+                scale->nb_slice_sws++;
+                if (ret < 0)
+                    return ret;
+            }
+        }
     }
 
     if (inlink0->sample_aspect_ratio.num){
@@ -412,6 +460,22 @@ static int scale_slice(AVFilterLink *link, AVFrame *out_buf, AVFrame *cur_pic, s
                          out,out_stride);
 }
 
+static int scale_slice_job(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ScaleContext *scale = ctx->priv;
+    ThreadData *td = arg;
+    struct SwsContext *sws = jobnr ? scale->slice_sws[jobnr - 1] : scale->sws;
+    const int h = td->out->height;
+    const int slice_start = (h *  jobnr     / nb_jobs) & ~15;
+    const int slice_end   = jobnr == nb_jobs - 1 ? h : (h * (jobnr + 1) / nb_jobs) & ~15;
+
+    if (slice_end <= slice_start)
+        return 0;
+    return sws_scale_dst_slice(sws, (const uint8_t * const *)td->in->data, td->in->linesize,
+                               td->out->data, td->out->linesize,
+                               slice_start, slice_end - slice_start);
+}
+
 static int scale_frame(AVFilterLink *link, AVFrame *in, AVFrame **frame_out)
 {
     ScaleContext *scale = link->dst->priv;
@@ -419,7 +483,7 @@ static int scale_frame(AVFilterLink *link, AVFrame *in, AVFrame **frame_out)
     AVFrame *out;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     char buf[32];
-    int in_range;
+    int in_range, i;
 
     *frame_out = NULL;
     if (in->colorspace == AVCOL_SPC_YCGCO)
@@ -510,6 +574,10 @@ static int scale_frame(AVFilterLink *link, AVFrame *in, AVFrame **frame_out)
             sws_setColorspaceDetails(scale->isws[1], inv_table, in_full,
                                      table, out_full,
                                      brightness, contrast, saturation);
+        for (i = 0; i < scale->nb_slice_sws; i++)
+            sws_setColorspaceDetails(scale->slice_sws[i], inv_table, in_full,
+                                     table, out_full,
+                                     brightness, contrast, saturation);
 
         out->color_range = out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
     }
@@ -522,6 +590,33 @@ static int scale_frame(AVFilterLink *link, AVFrame *in, AVFrame **frame_out)
     if (scale->interlaced>0 || (scale->interlaced<0 && in->interlaced_frame)) {
         scale_slice(link, out, in, scale->isws[0], 0, (link->h+1)/2, 2, 0);
         scale_slice(link, out, in, scale->isws[1], 0,  link->h   /2, 2, 1);
+    } else if (scale->nb_slice_sws) {
+        ThreadData td = { .in = in, .out = out };
+        const int nb_jobs = scale->nb_slice_sws + 1;
+        int ret = 0;
+
+        link->dst->internal->execute(link->dst, scale_slice_job, &td,
+                                     scale->slice_ret, nb_jobs);
+        for (i = 0; i < nb_jobs; i++) {
+            if (scale->slice_ret[i] == AVERROR(ENOSYS)) {
+                /* nothing was written, convert on this thread from now on */
+                av_log(link->dst, AV_LOG_VERBOSE, "Conversion cannot be sliced, "
+                       "disabling slice threading.\n");
+                free_slice_contexts(scale);
+                scale_slice(link, out, in, scale->sws, 0, link->h, 1, 0);
+                ret = 0;
+                break;
+            }
+            if (scale->slice_ret[i] < 0 && !ret)
+                ret = scale->slice_ret[i];
+        }
+        if (ret < 0) {
+            av_log(link->dst, AV_LOG_ERROR, "Error scaling a slice: %s\n",
+                   av_err2str(ret));
+            av_frame_free(&in);
+            av_frame_free(frame_out);
+            return ret;
+        }
     } else if (scale->nb_slices) {
         int i, slice_h, slice_start, slice_end = 0;
         const int nb_slices = FFMIN(scale->nb_slices, link->h);
@@ -677,6 +772,7 @@ AVFilter ff_vf_scale = {
     .inputs          = avfilter_vf_scale_inputs,
     .outputs         = avfilter_vf_scale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
 
 static const AVClass scale2ref_class = {
@@ -729,4 +825,5 @@ AVFilter ff_vf_scale2ref = {
     .inputs          = avfilter_vf_scale2ref_inputs,
     .outputs         = avfilter_vf_scale2ref_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -44,6 +44,11 @@
 #include "formats.h"
 #include "video.h"
 
+typedef struct AssImage {
+    FFDrawColor    color;
+    FFBlendWeights weights;
+} AssImage;
+
 typedef struct AssContext {
     const AVClass *class;
     ASS_Library  *library;
@@ -60,6 +65,13 @@ typedef struct AssContext {
     int original_w, original_h;
     int shaping;
     FFDrawContext draw;
+
+    /* images of the last rendered frame, blended again while libass
+       reports no change; their weight buffers are kept for the next change */
+    AssImage *images;
+    int nb_images;
+    int nb_images_alloc;
+    int images_valid;
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -124,6 +136,11 @@ static av_cold int init(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     AssContext *ass = ctx->priv;
+    int i;
+
+    for (i = 0; i < ass->nb_images_alloc; i++)
+        ff_blend_weights_free(&ass->images[i].weights);
+    av_freep(&ass->images);
 
     if (ass->track)
         ass_free_track(ass->track);
@@ -151,6 +168,9 @@ static int config_input(AVFilterLink *inlink)
     if (ass->shaping != -1)
         ass_set_shaper(ass->renderer, ass->shaping);
 
+    ass->nb_images    = 0;
+    ass->images_valid = 0;
+
     return 0;
 }
 
@@ -175,12 +195,65 @@ static void overlay_ass_image(AssContext *ass, AVFrame *picref,
     }
 }
 
+/* turn the glyph bitmaps into blending weights, once they are reused */
+static int prepare_ass_images(AssContext *ass, const AVFrame *picref,
+                              const ASS_Image *image)
+{
+    const ASS_Image *img;
+    int nb_images = 0, ret;
+
+    ass->nb_images    = 0;
+    ass->images_valid = 0;
+    for (img = image; img; img = img->next)
+        nb_images++;
+    if (nb_images > ass->nb_images_alloc) {
+        AssImage *images = av_realloc_array(ass->images, nb_images, sizeof(*images));
+        if (!images)
+            return AVERROR(ENOMEM);
+        memset(images + ass->nb_images_alloc, 0,
+               (nb_images - ass->nb_images_alloc) * sizeof(*images));
+        ass->images          = images;
+        ass->nb_images_alloc = nb_images;
+    }
+
+    for (; image; image = image->next) {
+        uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
+        AssImage *dst = &ass->images[ass->nb_images];
+
+        ff_draw_color(&ass->draw, &dst->color, rgba_color);
+        ret = ff_blend_mask_weights(&ass->draw, &dst->color, &dst->weights,
+                                    picref->width, picref->height,
+                                    image->bitmap, image->stride, image->w, image->h,
+                                    3, image->dst_x, image->dst_y);
+        if (ret < 0)
+            return ret;
+        if (dst->weights.nb_planes)
+            ass->nb_images++;
+    }
+    ass->images_valid = 1;
+    return 0;
+}
+
+static int overlay_ass_image_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AssContext *ass = ctx->priv;
+    AVFrame *picref = arg;
+    const int slice_start = (picref->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (picref->height * (jobnr+1)) / nb_jobs;
+    int i;
+
+    for (i = 0; i < ass->nb_images; i++)
+        ff_blend_weights(&ass->draw, &ass->images[i].color, &ass->images[i].weights,
+                         picref->data, picref->linesize, slice_start, slice_end);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
 {
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AssContext *ass = ctx->priv;
-    int detect_change = 0;
+    int detect_change = 0, ret;
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
@@ -188,7 +261,24 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    if (detect_change) {
+        /* computing the weights costs more than blending the bitmaps, so
+           it only pays off if the images are still the same next frame */
+        ass->images_valid = 0;
+        overlay_ass_image(ass, picref, image);
+        return ff_filter_frame(outlink, picref);
+    }
+
+    if (!ass->images_valid) {
+        ret = prepare_ass_images(ass, picref, image);
+        if (ret < 0) {
+            av_frame_free(&picref);
+            return ret;
+        }
+    }
+    if (ass->nb_images)
+        ctx->internal->execute(ctx, overlay_ass_image_slice, picref, NULL,
+                               FFMIN(picref->height, ff_filter_get_nb_threads(ctx)));
 
     return ff_filter_frame(outlink, picref);
 }
@@ -256,6 +346,7 @@ AVFilter ff_vf_ass = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &ass_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
 
@@ -494,5 +585,6 @@ AVFilter ff_vf_subtitles = {
     .inputs        = ass_inputs,
     .outputs       = ass_outputs,
     .priv_class    = &subtitles_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif
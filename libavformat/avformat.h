@@ -1018,6 +1018,22 @@ typedef struct AVStream {
      */
     AVCodecParameters *codecpar;
 
+    /**
+     * Codec parameters taken from the container or the bitstream headers
+     * without decoding, a combination of AVSTREAM_INFERRED_*.
+     *
+     * - demuxing: set by avformat_find_stream_info() with
+     *             AVFMT_FLAG_FAST_PROBE
+     * - muxing: unused
+     */
+    int inferred_fields;
+#define AVSTREAM_INFERRED_FRAME_RATE     0x0001 ///< r_frame_rate and avg_frame_rate come from the headers, not from the timestamps
+#define AVSTREAM_INFERRED_DECODER_DELAY  0x0002 ///< the decoder delay (has_b_frames) was not measured by decoding
+#define AVSTREAM_INFERRED_PIX_FMT        0x0004 ///< the pixel format comes from the parser
+#define AVSTREAM_INFERRED_SIZE           0x0008 ///< the dimensions come from the parser
+#define AVSTREAM_INFERRED_CHANNEL_LAYOUT 0x0010 ///< the channel layout was not checked against a decoded frame
+#define AVSTREAM_INFERRED_BIT_RATE       0x0020 ///< the bit rate comes from the headers of the first few packets
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -1501,6 +1517,7 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+#define AVFMT_FLAG_FAST_PROBE 0x400000 ///< Trust the codec parameters from the container and decode only to fill missing ones in avformat_find_stream_info()
 
     /**
      * Maximum size of the data read from input for determining
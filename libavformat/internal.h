@@ -190,6 +190,19 @@ struct AVStreamInternal {
     int need_context_update;
 
     FFFrac *priv_pts;
+
+    /**
+     * Set by avformat_find_stream_info() with AVFMT_FLAG_FAST_PROBE when
+     * the frame rate analysis was skipped because the headers carry one.
+     */
+    int fps_from_headers;
+
+    /**
+     * Set by try_decode_frame() with AVFMT_FLAG_FAST_PROBE once the decoder
+     * has output a frame, or has taken a packet if it fills in the
+     * parameters without outputting frames.
+     */
+    int fast_probe_decoded;
 };
 
 #ifdef __GNUC__
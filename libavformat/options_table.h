@@ -52,6 +52,7 @@ static const AVOption avformat_options[] = {
 {"keepside", "deprecated, does nothing", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_KEEP_SIDE_DATA }, INT_MIN, INT_MAX, D, "fflags"},
 #endif
 {"fastseek", "fast but inaccurate seeks", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_FAST_SEEK }, INT_MIN, INT_MAX, D, "fflags"},
+{"fastprobe", "trust the container codec parameters and decode only to fill missing ones", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_FAST_PROBE }, INT_MIN, INT_MAX, D, "fflags"},
 #if FF_API_LAVF_MP4A_LATM
 {"latm", "deprecated, does nothing", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_FLAG_MP4A_LATM }, INT_MIN, INT_MAX, E, "fflags"},
 #endif
@@ -3046,6 +3046,60 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
+/**
+ * With AVFMT_FLAG_FAST_PROBE, one frame is still decoded from each audio and
+ * video stream that has a decoder: the profile, the level, the sample aspect
+ * ratio or the chroma location are only set by the decoder.
+ */
+static int fast_probe_needs_frame(AVFormatContext *s, AVStream *st)
+{
+    AVCodecContext *avctx = st->internal->avctx;
+
+    if (avctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+        avctx->codec_type != AVMEDIA_TYPE_AUDIO)
+        return 0;
+    if (st->internal->fast_probe_decoded || st->info->found_decoder < 0)
+        return 0;
+    return avctx->codec || find_probe_decoder(s, st, st->codecpar->codec_id);
+}
+
+/**
+ * With AVFMT_FLAG_FAST_PROBE, fill in what the parser found in the headers
+ * and tell whether the stream can do without decoding. What decoding would
+ * have measured or checked is noted in inferred_fields.
+ */
+static int fast_probe_stream(AVFormatContext *s, AVStream *st)
+{
+    AVCodecContext *avctx    = st->internal->avctx;
+    AVCodecParserContext *pc = st->parser;
+    const AVCodec *codec;
+
+    if (pc && avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+        if (avctx->pix_fmt == AV_PIX_FMT_NONE && pc->format >= 0) {
+            avctx->pix_fmt = pc->format;
+            st->inferred_fields |= AVSTREAM_INFERRED_PIX_FMT;
+        }
+        if (!avctx->width && pc->width > 0 && pc->height > 0) {
+            avctx->width        = pc->width;
+            avctx->height       = pc->height;
+            avctx->coded_width  = pc->coded_width;
+            avctx->coded_height = pc->coded_height;
+            st->inferred_fields |= AVSTREAM_INFERRED_SIZE;
+        }
+    }
+
+    if (!has_codec_parameters(st, NULL) || fast_probe_needs_frame(s, st))
+        return 0;
+
+    if (!has_decode_delay_been_guessed(st))
+        st->inferred_fields |= AVSTREAM_INFERRED_DECODER_DELAY;
+    codec = avctx->codec ? avctx->codec : find_probe_decoder(s, st, st->codecpar->codec_id);
+    if (!st->nb_decoded_frames && codec &&
+        (codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF))
+        st->inferred_fields |= AVSTREAM_INFERRED_CHANNEL_LAYOUT;
+    return 1;
+}
+
 /* returns 1 or 0 if or if not decoded data was returned, or a negative error */
 static int try_decode_frame(AVFormatContext *s, AVStream *st,
                             const AVPacket *avpkt, AVDictionary **options)
@@ -3106,15 +3160,19 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st,
            ret >= 0 &&
            (!has_codec_parameters(st, NULL) || !has_decode_delay_been_guessed(st) ||
             (!st->codec_info_nb_frames &&
-             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)))) {
+             (avctx->codec->capabilities & AV_CODEC_CAP_CHANNEL_CONF)) ||
+            ((s->flags & AVFMT_FLAG_FAST_PROBE) && !st->internal->fast_probe_decoded))) {
         got_picture = 0;
         if (avctx->codec_type == AVMEDIA_TYPE_VIDEO ||
             avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
             ret = avcodec_send_packet(avctx, &pkt);
             if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
                 break;
-            if (ret >= 0)
+            if (ret >= 0) {
                 pkt.size = 0;
+                if (do_skip_frame)
+                    st->internal->fast_probe_decoded = 1;
+            }
             ret = avcodec_receive_frame(avctx, frame);
             if (ret >= 0)
                 got_picture = 1;
@@ -3127,8 +3185,10 @@ static int try_decode_frame(AVFormatContext *s, AVStream *st,
                 pkt.size = 0;
         }
         if (ret >= 0) {
-            if (got_picture)
+            if (got_picture) {
                 st->nb_decoded_frames++;
+                st->internal->fast_probe_decoded = 1;
+            }
             ret       = got_picture;
         }
     }
@@ -3738,6 +3798,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
             st = ic->streams[i];
             if (!has_codec_parameters(st, NULL))
                 break;
+            if ((ic->flags & AVFMT_FLAG_FAST_PROBE) && fast_probe_needs_frame(ic, st))
+                break;
             /* If the timebase is coarse (like the usual millisecond precision
              * of mkv), we need to analyze more frames to reliably arrive at
              * the correct fps. */
@@ -3755,8 +3817,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
                        st->info->duration_count;
             if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
                 st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                if (count < fps_analyze_framecount)
-                    break;
+                if (count < fps_analyze_framecount) {
+                    /* in fast probe mode, a rate from the headers is enough */
+                    if (!(ic->flags & AVFMT_FLAG_FAST_PROBE) ||
+                        !(st->avg_frame_rate.num || st->r_frame_rate.num ||
+                          st->internal->avctx->framerate.num > 0))
+                        break;
+                    st->internal->fps_from_headers = 1;
+                } else
+                    st->internal->fps_from_headers = 0;
             }
             // Look at the first 3 frames if there is evidence of frame delay
             // but the decoder delay is not set.
@@ -3935,9 +4004,10 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * If AV_CODEC_CAP_CHANNEL_CONF is set this will force decoding of at
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
-         * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+         * the container. In fast probe mode the container is trusted. */
+        if (!(ic->flags & AVFMT_FLAG_FAST_PROBE) || !fast_probe_stream(ic, st))
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(&pkt1);
@@ -3997,6 +4067,29 @@ FF_ENABLE_DEPRECATION_WARNINGS
         }
     }
 
+    if (ic->flags & AVFMT_FLAG_FAST_PROBE) {
+        for (i = 0; i < ic->nb_streams; i++) {
+            st = ic->streams[i];
+            avctx = st->internal->avctx;
+            /* audio parsers update the bit rate from each frame header,
+             * and far fewer frames were parsed than usual */
+            if (st->parser && avctx->codec_type == AVMEDIA_TYPE_AUDIO &&
+                avctx->bit_rate > 0)
+                st->inferred_fields |= AVSTREAM_INFERRED_BIT_RATE;
+            /* the decoder confirmed what the parser said */
+            if (st->internal->fast_probe_decoded)
+                st->inferred_fields &= ~(AVSTREAM_INFERRED_PIX_FMT | AVSTREAM_INFERRED_SIZE);
+            if (!st->internal->fps_from_headers)
+                continue;
+            if (!st->r_frame_rate.num)
+                st->r_frame_rate = avctx->framerate.num > 0 && avctx->framerate.den > 0 ?
+                                   avctx->framerate : st->avg_frame_rate;
+            if (!st->avg_frame_rate.num)
+                st->avg_frame_rate = st->r_frame_rate;
+            st->inferred_fields |= AVSTREAM_INFERRED_FRAME_RATE;
+        }
+    }
+
     ff_rfps_calculate(ic);
 
     for (i = 0; i < ic->nb_streams; i++) {
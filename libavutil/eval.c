@@ -55,6 +55,8 @@ typedef struct Parser {
     void *log_ctx;
 #define VARS 10
     double *var;
+    int var_index;                            ///< constant replaced by *var_value, or -1
+    const double *var_value;
 } Parser;
 
 static const AVClass eval_class = {
@@ -174,8 +176,41 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprCode *code;       ///< bytecode for av_expr_eval(), or NULL
+    struct ExprCode *batch_code; ///< branch-free bytecode for av_expr_eval_batch(), or NULL
 };
 
+/* control instructions, the other opcodes are the AVExpr node types */
+enum {
+    op_jz = e_sgn + 1,  ///< jump to a.target if src[0] is zero
+    op_jnz,             ///< jump to a.target if src[0] is not zero
+    op_jmp,             ///< jump to a.target
+    op_scale,           ///< value * src[0]
+};
+
+typedef struct ExprInsn {
+    int op;
+    int dst;
+    int src[4];
+    double value;       ///< constant, or scale of the result as AVExpr.value
+    union {
+        int const_index;
+        int target;
+        double (*func0)(double);
+        double (*func1)(void *, double);
+        double (*func2)(void *, double, double);
+    } a;
+} ExprInsn;
+
+#define EXPR_MAX_REGS   32
+#define EXPR_BATCH_SIZE 16
+
+typedef struct ExprCode {
+    ExprInsn *insns;
+    int nb_insns;
+    int nb_regs;
+} ExprCode;
+
 static double etime(double v)
 {
     return av_gettime() * 0.000001;
@@ -185,7 +220,8 @@ static double eval_expr(Parser *p, AVExpr *e)
 {
     switch (e->type) {
         case e_value:  return e->value;
-        case e_const:  return e->value * p->const_values[e->a.const_index];
+        case e_const:  return e->value * (e->a.const_index == p->var_index ? *p->var_value :
+                                          p->const_values[e->a.const_index]);
         case e_func0:  return e->value * e->a.func0(eval_expr(p, e->param[0]));
         case e_func1:  return e->value * e->a.func1(p->opaque, eval_expr(p, e->param[0]));
         case e_func2:  return e->value * e->a.func2(p->opaque, eval_expr(p, e->param[0]), eval_expr(p, e->param[1]));
@@ -333,6 +369,14 @@ static double eval_expr(Parser *p, AVExpr *e)
 
 static int parse_expr(AVExpr **e, Parser *p);
 
+static void free_code(ExprCode **code)
+{
+    if (!*code)
+        return;
+    av_freep(&(*code)->insns);
+    av_freep(code);
+}
+
 void av_expr_free(AVExpr *e)
 {
     if (!e) return;
@@ -340,6 +384,8 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    free_code(&e->code);
+    free_code(&e->batch_code);
     av_freep(&e);
 }
 
@@ -680,6 +726,307 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+#define EXPR_VARYING      1 ///< depends on more than the expression itself
+#define EXPR_CALLS        2 ///< calls functions which may not be pure
+#define EXPR_SIDE_EFFECTS 4 ///< writes variables or logs
+#define EXPR_TREE_ONLY    8 ///< only evaluated by walking the tree
+
+static int expr_flags(const AVExpr *e)
+{
+    int i, flags = 0;
+
+    switch (e->type) {
+    case e_const:
+    case e_ld:     flags = EXPR_VARYING;                                 break;
+    case e_func1:
+    case e_func2:  flags = EXPR_VARYING | EXPR_CALLS;                    break;
+    case e_func0:  flags = e->a.func0 == etime ? EXPR_VARYING | EXPR_CALLS : 0; break;
+    case e_st:
+    case e_random: flags = EXPR_VARYING | EXPR_SIDE_EFFECTS;             break;
+    case e_print:
+    case e_while:
+    case e_taylor:
+    case e_root:   flags = EXPR_VARYING | EXPR_SIDE_EFFECTS | EXPR_TREE_ONLY; break;
+    }
+    for (i = 0; i < 3; i++)
+        if (e->param[i])
+            flags |= expr_flags(e->param[i]);
+    return flags;
+}
+
+typedef struct ExprCompiler {
+    ExprCode *code;
+    int batch;          ///< no jumps, branches of if() are evaluated and selected
+    int size;
+} ExprCompiler;
+
+static ExprInsn *emit(ExprCompiler *c, int op, int dst, int src, int nb_src, double value)
+{
+    ExprCode *code = c->code;
+    ExprInsn *in;
+    int i;
+
+    if (code->nb_insns == c->size) {
+        int size = FFMAX(16, 2 * c->size);
+        if (av_reallocp_array(&code->insns, size, sizeof(*code->insns)) < 0)
+            return NULL;
+        c->size = size;
+    }
+    in = &code->insns[code->nb_insns++];
+    memset(in, 0, sizeof(*in));
+    in->op    = op;
+    in->dst   = dst;
+    in->value = value;
+    for (i = 0; i < 4; i++)
+        in->src[i] = src + (i < nb_src ? i : 0);
+    code->nb_regs = FFMAX3(code->nb_regs, dst + 1, src + nb_src);
+    return in;
+}
+
+/* compile e so that its value ends up in register r, using registers >= r */
+static int compile_expr(ExprCompiler *c, const AVExpr *e, int r)
+{
+    ExprInsn *in;
+    int i, ret = 0, jump, skip, x2 = r;
+
+    if (e->type != e_value && !expr_flags(e)) {
+        Parser p = { 0 };
+        p.var_index = -1;
+        return emit(c, e_value, r, r, 0, eval_expr(&p, (AVExpr *)e)) ? 0 : AVERROR(ENOMEM);
+    }
+
+    if (!c->batch && e->type == e_between) {
+        /* max is not evaluated if d >= min fails */
+        if ((ret = compile_expr(c, e->param[0], r)) < 0 ||
+            (ret = compile_expr(c, e->param[1], r + 1)) < 0)
+            return ret;
+        jump = c->code->nb_insns + 1;
+        if (!emit(c, e_gte, r + 1, r, 2, 1) ||
+            !emit(c, op_jz, r + 1, r + 1, 1, 0))
+            return AVERROR(ENOMEM);
+        if ((ret = compile_expr(c, e->param[2], r + 1)) < 0)
+            return ret;
+        skip = c->code->nb_insns + 1;
+        if (!emit(c, e_lte, r, r, 2, e->value) ||
+            !emit(c, op_jmp, r, r, 0, 0))
+            return AVERROR(ENOMEM);
+        c->code->insns[jump].a.target = c->code->nb_insns;
+        if (!emit(c, e_value, r, r, 0, e->value * 0.0))
+            return AVERROR(ENOMEM);
+        c->code->insns[skip].a.target = c->code->nb_insns;
+        return 0;
+    }
+
+    if (!c->batch && (e->type == e_if || e->type == e_ifnot)) {
+        if ((ret = compile_expr(c, e->param[0], r)) < 0)
+            return ret;
+        jump = c->code->nb_insns;
+        if (!emit(c, e->type == e_if ? op_jz : op_jnz, r, r, 1, 0))
+            return AVERROR(ENOMEM);
+        if ((ret = compile_expr(c, e->param[1], r)) < 0)
+            return ret;
+        skip = c->code->nb_insns;
+        if (!emit(c, op_jmp, r, r, 0, 0))
+            return AVERROR(ENOMEM);
+        c->code->insns[jump].a.target = c->code->nb_insns;
+        if (e->param[2])
+            ret = compile_expr(c, e->param[2], r);
+        else if (!emit(c, e_value, r, r, 0, 0))
+            ret = AVERROR(ENOMEM);
+        if (ret < 0)
+            return ret;
+        c->code->insns[skip].a.target = c->code->nb_insns;
+        if (e->value != 1 && !emit(c, op_scale, r, r, 1, e->value))
+            return AVERROR(ENOMEM);
+        return 0;
+    }
+
+    if (!c->batch && e->type == e_clip &&
+        expr_flags(e) & (EXPR_CALLS | EXPR_SIDE_EFFECTS)) {
+        /* x is evaluated a second time for the result, but only once the
+         * arguments were found valid */
+        for (i = 0; i < 3; i++)
+            if ((ret = compile_expr(c, e->param[i], r + i)) < 0)
+                return ret;
+        jump = c->code->nb_insns + 2;
+        if (!emit(c, e_clip, r + 3, r, 3, 1) ||
+            !emit(c, e_isnan, r + 3, r + 3, 1, 1) ||
+            !emit(c, op_jnz, r + 3, r + 3, 1, 0))
+            return AVERROR(ENOMEM);
+        if ((ret = compile_expr(c, e->param[0], r + 3)) < 0)
+            return ret;
+        skip = c->code->nb_insns + 1;
+        if (!(in = emit(c, e_clip, r, r, 3, e->value)) ||
+            !emit(c, op_jmp, r, r, 0, 0))
+            return AVERROR(ENOMEM);
+        in->src[3] = r + 3;
+        c->code->insns[jump].a.target = c->code->nb_insns;
+        if (!emit(c, e_value, r, r, 0, NAN))
+            return AVERROR(ENOMEM);
+        c->code->insns[skip].a.target = c->code->nb_insns;
+        return 0;
+    }
+
+    for (i = 0; i < 3; i++) {
+        if (e->param[i])
+            ret = compile_expr(c, e->param[i], r + i);
+        else if (i == 2 && (e->type == e_if || e->type == e_ifnot))
+            ret = emit(c, e_value, r + i, r + i, 0, 0) ? 0 : AVERROR(ENOMEM);
+        else
+            break;
+        if (ret < 0)
+            return ret;
+    }
+    /* clip() evaluates its first argument a second time for the result,
+     * the batch code, without st() or random(), always does */
+    if (e->type == e_clip &&
+        expr_flags(e) & (EXPR_CALLS | EXPR_SIDE_EFFECTS)) {
+        x2 = r + 3;
+        if ((ret = compile_expr(c, e->param[0], x2)) < 0)
+            return ret;
+    }
+
+    if (!(in = emit(c, e->type, r, r, i, e->value)))
+        return AVERROR(ENOMEM);
+    in->src[3] = x2;
+    switch (e->type) {
+    case e_const: in->a.const_index = e->a.const_index; break;
+    case e_func0: in->a.func0       = e->a.func0;       break;
+    case e_func1: in->a.func1       = e->a.func1;       break;
+    case e_func2: in->a.func2       = e->a.func2;       break;
+    }
+    return 0;
+}
+
+static int compile(ExprCode **pcode, const AVExpr *e, int batch)
+{
+    ExprCompiler c = { 0 };
+    int ret;
+
+    c.batch = batch;
+    c.code  = av_mallocz(sizeof(*c.code));
+    if (!c.code)
+        return AVERROR(ENOMEM);
+    ret = compile_expr(&c, e, 0);
+    /* expressions too deep for the register file keep walking the tree */
+    if (ret < 0 || c.code->nb_regs > EXPR_MAX_REGS) {
+        free_code(&c.code);
+        return ret;
+    }
+    *pcode = c.code;
+    return 0;
+}
+
+#define LOOP(x) for (i = 0; i < n; i++) { x; }
+
+/* execute in on n lanes, registers are stride doubles apart */
+static av_always_inline void exec_insn(const ExprInsn *in, double *regs, int stride, int n,
+                                       const double *const_values, int var_index,
+                                       const double *var_values, void *opaque, double *var)
+{
+    double       *d = regs + in->dst    * stride;
+    const double *a = regs + in->src[0] * stride;
+    const double *b = regs + in->src[1] * stride;
+    const double *c = regs + in->src[2] * stride;
+    const double *x = regs + in->src[3] * stride;
+    const double  v = in->value;
+    int i;
+
+    switch (in->op) {
+    case e_value:  LOOP(d[i] = v);                                     break;
+    case e_const:
+        if (in->a.const_index == var_index) {
+            LOOP(d[i] = v * var_values[i]);
+        } else {
+            const double k = v * const_values[in->a.const_index];
+            LOOP(d[i] = k);
+        }
+        break;
+    case e_func0:  LOOP(d[i] = v * in->a.func0(a[i]));                 break;
+    case e_func1:  LOOP(d[i] = v * in->a.func1(opaque, a[i]));         break;
+    case e_func2:  LOOP(d[i] = v * in->a.func2(opaque, a[i], b[i]));   break;
+    case e_squish: LOOP(d[i] = 1/(1+exp(4*a[i])));                     break;
+    case e_gauss:  LOOP(d[i] = exp(-a[i]*a[i]/2)/sqrt(2*M_PI));        break;
+    case e_ld:     LOOP(d[i] = v * var[av_clip(a[i], 0, VARS-1)]);     break;
+    case e_isnan:  LOOP(d[i] = v * !!isnan(a[i]));                     break;
+    case e_isinf:  LOOP(d[i] = v * !!isinf(a[i]));                     break;
+    case e_floor:  LOOP(d[i] = v * floor(a[i]));                       break;
+    case e_ceil:   LOOP(d[i] = v * ceil (a[i]));                       break;
+    case e_trunc:  LOOP(d[i] = v * trunc(a[i]));                       break;
+    case e_round:  LOOP(d[i] = v * round(a[i]));                       break;
+    case e_sgn:    LOOP(d[i] = v * FFDIFFSIGN(a[i], 0));               break;
+    case e_sqrt:   LOOP(d[i] = v * sqrt (a[i]));                       break;
+    case e_not:    LOOP(d[i] = v * (a[i] == 0));                       break;
+    case e_if:     LOOP(d[i] = v * ( a[i] ? b[i] : c[i]));             break;
+    case e_ifnot:  LOOP(d[i] = v * (!a[i] ? b[i] : c[i]));             break;
+    case e_between:LOOP(d[i] = v * (a[i] >= b[i] && a[i] <= c[i]));   break;
+    case e_clip:
+        LOOP(d[i] = isnan(b[i]) || isnan(c[i]) || isnan(a[i]) || b[i] > c[i] ? NAN :
+                    v * av_clipd(x[i], b[i], c[i]));
+        break;
+    case e_lerp:   LOOP(d[i] = a[i] + (b[i] - a[i]) * c[i]);           break;
+    case e_random:
+        LOOP(int idx = av_clip(a[i], 0, VARS-1);
+             uint64_t r = isnan(var[idx]) ? 0 : var[idx];
+             r = r*1664525+1013904223;
+             var[idx] = r;
+             d[i] = v * (r * (1.0/UINT64_MAX)));
+        break;
+    case e_mod:    LOOP(d[i] = v * (a[i] - floor((!CONFIG_FTRAPV || b[i]) ? a[i] / b[i] : a[i] * INFINITY) * b[i])); break;
+    case e_gcd:    LOOP(d[i] = v * av_gcd(a[i], b[i]));                break;
+    case e_max:    LOOP(d[i] = v * (a[i] >  b[i] ? a[i] : b[i]));      break;
+    case e_min:    LOOP(d[i] = v * (a[i] <  b[i] ? a[i] : b[i]));      break;
+    case e_eq:     LOOP(d[i] = v * (a[i] == b[i] ? 1.0 : 0.0));        break;
+    case e_gt:     LOOP(d[i] = v * (a[i] >  b[i] ? 1.0 : 0.0));        break;
+    case e_gte:    LOOP(d[i] = v * (a[i] >= b[i] ? 1.0 : 0.0));        break;
+    case e_lt:     LOOP(d[i] = v * (a[i] <  b[i] ? 1.0 : 0.0));        break;
+    case e_lte:    LOOP(d[i] = v * (a[i] <= b[i] ? 1.0 : 0.0));        break;
+    case e_pow:    LOOP(d[i] = v * pow(a[i], b[i]));                   break;
+    case e_mul:    LOOP(d[i] = v * (a[i] * b[i]));                     break;
+    case e_div:    LOOP(d[i] = v * ((!CONFIG_FTRAPV || b[i]) ? (a[i] / b[i]) : a[i] * INFINITY)); break;
+    case e_add:    LOOP(d[i] = v * (a[i] + b[i]));                     break;
+    case e_last:   LOOP(d[i] = v * b[i]);                              break;
+    case e_st:     LOOP(d[i] = v * (var[av_clip(a[i], 0, VARS-1)] = b[i])); break;
+    case e_hypot:  LOOP(d[i] = v * hypot(a[i], b[i]));                 break;
+    case e_atan2:  LOOP(d[i] = v * atan2(a[i], b[i]));                 break;
+    case e_bitand: LOOP(d[i] = isnan(a[i]) || isnan(b[i]) ? NAN : v * ((long int)a[i] & (long int)b[i])); break;
+    case e_bitor:  LOOP(d[i] = isnan(a[i]) || isnan(b[i]) ? NAN : v * ((long int)a[i] | (long int)b[i])); break;
+    case op_scale: LOOP(d[i] = v * a[i]);                              break;
+    }
+}
+
+static double exec_code(const ExprCode *code, const double *const_values,
+                        int var_index, const double *var_value, void *opaque, double *var)
+{
+    double regs[EXPR_MAX_REGS];
+    const ExprInsn *in  = code->insns;
+    const ExprInsn *end = code->insns + code->nb_insns;
+
+    while (in < end) {
+        switch (in->op) {
+        case op_jz:
+            if (regs[in->src[0]] == 0) {
+                in = code->insns + in->a.target;
+                continue;
+            }
+            break;
+        case op_jnz:
+            if (regs[in->src[0]] != 0) {
+                in = code->insns + in->a.target;
+                continue;
+            }
+            break;
+        case op_jmp:
+            in = code->insns + in->a.target;
+            continue;
+        default:
+            exec_insn(in, regs, 1, 1, const_values, var_index, var_value, opaque, var);
+        }
+        in++;
+    }
+    return regs[0];
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -691,7 +1038,7 @@ int av_expr_parse(AVExpr **expr, const char *s,
     char *w = av_malloc(strlen(s) + 1);
     char *wp = w;
     const char *s0 = s;
-    int ret = 0;
+    int flags, ret = 0;
 
     if (!w)
         return AVERROR(ENOMEM);
@@ -727,6 +1074,11 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(ENOMEM);
         goto end;
     }
+    flags = expr_flags(e);
+    if (!(flags & EXPR_TREE_ONLY) && (ret = compile(&e->code, e, 0)) < 0)
+        goto end;
+    if (!(flags & EXPR_SIDE_EFFECTS) && (ret = compile(&e->batch_code, e, 1)) < 0)
+        goto end;
     *expr = e;
     e = NULL;
 end:
@@ -738,13 +1090,48 @@ end:
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
-    p.var= e->var;
 
+    if (e->code)
+        return exec_code(e->code, const_values, -1, NULL, opaque, e->var);
+
+    p.var= e->var;
+    p.var_index  = -1;
     p.const_values = const_values;
     p.opaque     = opaque;
     return eval_expr(&p, e);
 }
 
+void av_expr_eval_batch(AVExpr *e, double *res, int nb, const double *const_values,
+                        int var_index, const double *var_values, void *opaque)
+{
+    double regs[EXPR_MAX_REGS * EXPR_BATCH_SIZE];
+    const ExprCode *code = e->batch_code;
+    Parser p = { 0 };
+    int i, j;
+
+    if (code) {
+        for (i = 0; i < nb; i += EXPR_BATCH_SIZE) {
+            int n = FFMIN(nb - i, EXPR_BATCH_SIZE);
+            for (j = 0; j < code->nb_insns; j++)
+                exec_insn(&code->insns[j], regs, EXPR_BATCH_SIZE, n, const_values,
+                          var_index, var_values + i, opaque, e->var);
+            memcpy(res + i, regs, n * sizeof(*res));
+        }
+        return;
+    }
+
+    /* side effects must happen in order, evaluate one at a time */
+    p.var          = e->var;
+    p.var_index    = var_index;
+    p.const_values = const_values;
+    p.opaque       = opaque;
+    for (i = 0; i < nb; i++) {
+        p.var_value = &var_values[i];
+        res[i] = e->code ? exec_code(e->code, const_values, var_index, p.var_value, opaque, e->var) :
+                           eval_expr(&p, e);
+    }
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -86,6 +86,27 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for an array of values of one
+ * of its constants, for example all the X coordinates of a row of pixels.
+ *
+ * The result is the same as setting const_values[var_index] to each of
+ * var_values in turn and calling av_expr_eval(), but expressions that do
+ * not store variables are evaluated for several values at once. Both
+ * branches of if() and ifnot() may then be evaluated, so the functions
+ * from funcs1 and funcs2 must not have side effects.
+ *
+ * @param res an array of nb doubles where the results are stored
+ * @param nb number of values to evaluate the expression for
+ * @param const_values a zero terminated array of values for the identifiers from av_expr_parse() const_names,
+ *                     the value at var_index is not used
+ * @param var_index index in const_values of the constant taking the values from var_values
+ * @param var_values an array of nb values for the constant at var_index
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ */
+void av_expr_eval_batch(AVExpr *e, double *res, int nb, const double *const_values,
+                        int var_index, const double *var_values, void *opaque);
+
 /**
  * Free a parsed expression previously created with av_expr_parse().
  */
@@ -37,6 +37,32 @@ static const char *const const_names[] = {
     0
 };
 
+static void check_batch(const char *s)
+{
+    static const double xs[] = { -3, -2.5, -1, -0.5, 0, 0.5, 1, 2, 3, 7, 10, 99,
+                                 -1e9, 1e9, 0.25, 42, 5, 6, 7, 8 };
+    double res[FF_ARRAY_ELEMS(xs)], values[3] = { 0, M_E, 0 };
+    AVExpr *e = NULL, *e2 = NULL;
+    int i;
+
+    if (av_expr_parse(&e,  s, const_names, NULL, NULL, NULL, NULL, 0, NULL) < 0 ||
+        av_expr_parse(&e2, s, const_names, NULL, NULL, NULL, NULL, 0, NULL) < 0) {
+        printf("Failed to parse '%s'\n", s);
+        goto end;
+    }
+    av_expr_eval_batch(e, res, FF_ARRAY_ELEMS(xs), values, 0, xs, NULL);
+    for (i = 0; i < FF_ARRAY_ELEMS(xs); i++) {
+        double d;
+        values[0] = xs[i];
+        d = av_expr_eval(e2, values, NULL);
+        if (memcmp(&d, &res[i], sizeof(d)))
+            printf("'%s' with PI=%f: batch %f != %f\n", s, xs[i], res[i], d);
+    }
+end:
+    av_expr_free(e);
+    av_expr_free(e2);
+}
+
 int main(int argc, char **argv)
 {
     int i;
@@ -138,6 +164,33 @@ int main(int argc, char **argv)
         "clip(0, 2, 1)",
         "clip(0/0, 1, 2)",
         "clip(0, 0/0, 1)",
+        "clip(st(0, ld(0)+1), 2, 1); ld(0)",
+        "clip(st(0, ld(0)+1), 0, 5); ld(0)",
+        "clip(ld(0), st(0, 3)-10, 10)",
+        NULL
+    };
+    static const char *const batch_exprs[] = {
+        "PI*2+E",
+        "-PI^2/(E-1)",
+        "if(gt(PI,1), PI*3, -PI)",
+        "ifnot(PI, 5) + if(lt(PI,0), 1)",
+        "-if(PI, 2, 3)",
+        "between(PI, -1, 7)*4",
+        "-between(PI, 0, 1)",
+        "clip(PI*10, -5, 50)",
+        "clip(PI, 2, 1)",
+        "mod(PI, 3) + floor(PI/2) - ceil(PI*1.5) + trunc(PI) + round(PI)",
+        "max(PI, 0) + min(PI, 1) + abs(PI) + sgn(PI)",
+        "sqrt(PI) + exp(-PI) + sin(PI) + squish(PI) + gauss(PI)",
+        "bitand(PI, 3) + bitor(PI, 8) + not(PI) + isnan(sqrt(PI))",
+        "lerp(1, 9, PI) + hypot(PI, 4) + atan2(PI, 2) + gcd(PI, 6)",
+        "eq(PI, 7) + gte(PI, 2) + lte(PI, 2) + pow(2, PI)",
+        "st(0, PI); ld(0)*2 + ld(0)",
+        "st(1, ld(1) + PI); ld(1)",
+        "random(0)*PI",
+        "clip(st(0, ld(0) + 1), 0, 5) + ld(0)",
+        "clip(ld(0), st(0, PI) - 10, 10)",
+        "st(0, PI); while(lt(ld(0), 10), st(0, ld(0) + 1))",
         NULL
     };
     int ret;
@@ -155,6 +208,9 @@ int main(int argc, char **argv)
             printf("av_expr_parse_and_eval failed\n");
     }
 
+    for (expr = batch_exprs; *expr; expr++)
+        check_batch(*expr);
+
     ret = av_expr_parse_and_eval(&d, "1+(5-2)^(3-1)+1/2+sin(PI)-max(-2.2,-3.1)",
                            const_names, const_values,
                            NULL, NULL, NULL, NULL, NULL, 0, NULL);
@@ -31,6 +31,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "config.h"
 #include "rgb2rgb.h"
 #include "swscale_internal.h"
@@ -234,9 +235,15 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+/**
+ * Scale the given source slice. If dstSliceH is not 0, the source slice
+ * must be the whole image and only the rows from dstSliceY to
+ * dstSliceY + dstSliceH - 1 are written.
+ */
+static int scale_rows(SwsContext *c, const uint8_t *src[],
+                      int srcStride[], int srcSliceY,
+                      int srcSliceH, uint8_t *dst[], int dstStride[],
+                      int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
@@ -263,6 +270,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     int should_dither                = isNBPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
     int lastDstY;
+    int dstEnd = dstH;
 
     /* vars which will change and which we need to store back in the context */
     int dstY         = c->dstY;
@@ -342,6 +350,10 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
+    if (dstSliceH) {
+        dstY   = dstSliceY;
+        dstEnd = dstSliceY + dstSliceH;
+    }
 
     if (!should_dither) {
         c->chrDither8 = c->lumDither8 = sws_pb_64;
@@ -370,7 +382,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -532,6 +544,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return scale_rows(c, src, srcStride, srcSliceY, srcSliceH,
+                      dst, dstStride, 0, 0);
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -746,6 +766,102 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+static void update_palette(SwsContext *c, const uint32_t *pal)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int r, g, b, y, u, v, a = 0xff;
+        if (c->srcFormat == AV_PIX_FMT_PAL8) {
+            uint32_t p = pal[i];
+            a = (p >> 24) & 0xFF;
+            r = (p >> 16) & 0xFF;
+            g = (p >>  8) & 0xFF;
+            b =  p        & 0xFF;
+        } else if (c->srcFormat == AV_PIX_FMT_RGB8) {
+            r = ( i >> 5     ) * 36;
+            g = ((i >> 2) & 7) * 36;
+            b = ( i       & 3) * 85;
+        } else if (c->srcFormat == AV_PIX_FMT_BGR8) {
+            b = ( i >> 6     ) * 85;
+            g = ((i >> 3) & 7) * 36;
+            r = ( i       & 7) * 36;
+        } else if (c->srcFormat == AV_PIX_FMT_RGB4_BYTE) {
+            r = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            b = ( i       & 1) * 255;
+        } else if (c->srcFormat == AV_PIX_FMT_GRAY8 || c->srcFormat == AV_PIX_FMT_GRAY8A) {
+            r = g = b = i;
+        } else {
+            av_assert1(c->srcFormat == AV_PIX_FMT_BGR4_BYTE);
+            b = ( i >> 3     ) * 255;
+            g = ((i >> 1) & 3) * 85;
+            r = ( i       & 1) * 255;
+        }
+#define RGB2YUV_SHIFT 15
+#define BY ( (int) (0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define BV (-(int) (0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define BU ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GY ( (int) (0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GV (-(int) (0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define GU (-(int) (0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RY ( (int) (0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RV ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+#define RU (-(int) (0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
+
+        y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
+        c->pal_yuv[i]= y + (u<<8) + (v<<16) + ((unsigned)a<<24);
+
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_BGR32:
+#if !HAVE_BIGENDIAN
+        case AV_PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]=  r + (g<<8) + (b<<16) + ((unsigned)a<<24);
+            break;
+        case AV_PIX_FMT_BGR32_1:
+#if HAVE_BIGENDIAN
+        case AV_PIX_FMT_BGR24:
+#endif
+            c->pal_rgb[i]= a + (r<<8) + (g<<16) + ((unsigned)b<<24);
+            break;
+        case AV_PIX_FMT_RGB32_1:
+#if HAVE_BIGENDIAN
+        case AV_PIX_FMT_RGB24:
+#endif
+            c->pal_rgb[i]= a + (b<<8) + (g<<16) + ((unsigned)r<<24);
+            break;
+        case AV_PIX_FMT_RGB32:
+#if !HAVE_BIGENDIAN
+        case AV_PIX_FMT_BGR24:
+#endif
+        default:
+            c->pal_rgb[i]=  b + (g<<8) + (r<<16) + ((unsigned)a<<24);
+        }
+    }
+}
+
+static int scale_threaded(SwsContext *c, const uint8_t *const src[],
+                          const int srcStride[], uint8_t *const dst[],
+                          const int dstStride[])
+{
+    int i, nb_jobs = c->nb_slice_ctx + 1;
+
+    c->slice_src        = src;
+    c->slice_src_stride = srcStride;
+    c->slice_dst        = dst;
+    c->slice_dst_stride = dstStride;
+
+    avpriv_slicethread_execute(c->slicethread, nb_jobs, 0);
+
+    for (i = 0; i < nb_jobs; i++)
+        if (c->slice_err[i] < 0)
+            return c->slice_err[i];
+    return c->dstH;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -783,6 +899,14 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         return AVERROR(EINVAL);
     }
 
+    /* whole frames are split by destination rows, unless the conversion
+     * cannot be split, which sws_scale_dst_slice() reports on all bands */
+    if (c->slicethread && srcSliceY == 0 && srcSliceH == c->srcH) {
+        ret = scale_threaded(c, srcSlice, srcStride, dst, dstStride);
+        if (ret != AVERROR(ENOSYS))
+            return ret;
+    }
+
     if (c->gamma_flag && c->cascaded_context[0]) {
         ret = sws_scale(c->cascaded_context[0],
                     srcSlice, srcStride, srcSliceY, srcSliceH,
@@ -843,79 +967,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY == 0) c->sliceDir = 1; else c->sliceDir = -1;
     }
 
-    if (usePal(c->srcFormat)) {
-        for (i = 0; i < 256; i++) {
-            int r, g, b, y, u, v, a = 0xff;
-            if (c->srcFormat == AV_PIX_FMT_PAL8) {
-                uint32_t p = ((const uint32_t *)(srcSlice[1]))[i];
-                a = (p >> 24) & 0xFF;
-                r = (p >> 16) & 0xFF;
-                g = (p >>  8) & 0xFF;
-                b =  p        & 0xFF;
-            } else if (c->srcFormat == AV_PIX_FMT_RGB8) {
-                r = ( i >> 5     ) * 36;
-                g = ((i >> 2) & 7) * 36;
-                b = ( i       & 3) * 85;
-            } else if (c->srcFormat == AV_PIX_FMT_BGR8) {
-                b = ( i >> 6     ) * 85;
-                g = ((i >> 3) & 7) * 36;
-                r = ( i       & 7) * 36;
-            } else if (c->srcFormat == AV_PIX_FMT_RGB4_BYTE) {
-                r = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                b = ( i       & 1) * 255;
-            } else if (c->srcFormat == AV_PIX_FMT_GRAY8 || c->srcFormat == AV_PIX_FMT_GRAY8A) {
-                r = g = b = i;
-            } else {
-                av_assert1(c->srcFormat == AV_PIX_FMT_BGR4_BYTE);
-                b = ( i >> 3     ) * 255;
-                g = ((i >> 1) & 3) * 85;
-                r = ( i       & 1) * 255;
-            }
-#define RGB2YUV_SHIFT 15
-#define BY ( (int) (0.114 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BV (-(int) (0.081 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define BU ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GY ( (int) (0.587 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GV (-(int) (0.419 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define GU (-(int) (0.331 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RY ( (int) (0.299 * 219 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RV ( (int) (0.500 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-#define RU (-(int) (0.169 * 224 / 255 * (1 << RGB2YUV_SHIFT) + 0.5))
-
-            y = av_clip_uint8((RY * r + GY * g + BY * b + ( 33 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            u = av_clip_uint8((RU * r + GU * g + BU * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            v = av_clip_uint8((RV * r + GV * g + BV * b + (257 << (RGB2YUV_SHIFT - 1))) >> RGB2YUV_SHIFT);
-            c->pal_yuv[i]= y + (u<<8) + (v<<16) + ((unsigned)a<<24);
-
-            switch (c->dstFormat) {
-            case AV_PIX_FMT_BGR32:
-#if !HAVE_BIGENDIAN
-            case AV_PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]=  r + (g<<8) + (b<<16) + ((unsigned)a<<24);
-                break;
-            case AV_PIX_FMT_BGR32_1:
-#if HAVE_BIGENDIAN
-            case AV_PIX_FMT_BGR24:
-#endif
-                c->pal_rgb[i]= a + (r<<8) + (g<<16) + ((unsigned)b<<24);
-                break;
-            case AV_PIX_FMT_RGB32_1:
-#if HAVE_BIGENDIAN
-            case AV_PIX_FMT_RGB24:
-#endif
-                c->pal_rgb[i]= a + (b<<8) + (g<<16) + ((unsigned)r<<24);
-                break;
-            case AV_PIX_FMT_RGB32:
-#if !HAVE_BIGENDIAN
-            case AV_PIX_FMT_BGR24:
-#endif
-            default:
-                c->pal_rgb[i]=  b + (g<<8) + (r<<16) + ((unsigned)a<<24);
-            }
-        }
-    }
+    if (usePal(c->srcFormat))
+        update_palette(c, (const uint32_t *)srcSlice[1]);
 
     if (c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)) {
         uint8_t *base;
@@ -991,3 +1044,88 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     av_free(rgb0_tmp);
     return ret;
 }
+
+int attribute_align_arg sws_scale_dst_slice(struct SwsContext *c,
+                                            const uint8_t * const src[],
+                                            const int srcStride[],
+                                            uint8_t *const dst[],
+                                            const int dstStride[],
+                                            int dstSliceY, int dstSliceH)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c->srcFormat);
+    const uint8_t *src2[4];
+    uint8_t *dst2[4];
+    int srcStride2[4];
+    int dstStride2[4];
+    int i;
+
+    if (!src || !srcStride || !dst || !dstStride)
+        return AVERROR(EINVAL);
+
+    if (dstSliceY < 0 || dstSliceH <= 0 || (dstSliceY & 15) ||
+        ((dstSliceH & 15) && dstSliceY + dstSliceH != c->dstH) ||
+        dstSliceY + dstSliceH > c->dstH) {
+        av_log(c, AV_LOG_ERROR, "Slice parameters %d, %d are invalid\n", dstSliceY, dstSliceH);
+        return AVERROR(EINVAL);
+    }
+
+    /* these keep state between rows or go through temporary images */
+    if (c->cascaded_context[0] || c->srcXYZ || c->dstXYZ || c->slice_dependent ||
+        isBayer(c->srcFormat) || c->dither == SWS_DITHER_ED ||
+        (c->src0Alpha && !c->dst0Alpha && isALPHA(c->dstFormat)))
+        return AVERROR(ENOSYS);
+
+    if (!check_image_pointers(src, c->srcFormat, srcStride)) {
+        av_log(c, AV_LOG_ERROR, "bad src image pointers\n");
+        return AVERROR(EINVAL);
+    }
+    if (!check_image_pointers((const uint8_t* const*)dst, c->dstFormat, dstStride)) {
+        av_log(c, AV_LOG_ERROR, "bad dst image pointers\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < 4; i++) {
+        srcStride2[i] = srcStride[i];
+        dstStride2[i] = dstStride[i];
+    }
+    memcpy(src2, src, sizeof(src2));
+    memcpy(dst2, dst, sizeof(dst2));
+
+    if (usePal(c->srcFormat))
+        update_palette(c, (const uint32_t *)src[1]);
+
+    if (c->swscale != swscale) {
+        /* unscaled conversions write the rows of the source slice they get */
+        for (i = 0; i < av_pix_fmt_count_planes(c->srcFormat); i++) {
+            const int vsub = (i == 1 || i == 2) ? c->chrSrcVSubSample : 0;
+            if (i == 1 && desc->flags & AV_PIX_FMT_FLAG_PAL)
+                continue;
+            src2[i] += (dstSliceY >> vsub) * srcStride2[i];
+        }
+        reset_ptr(src2, c->srcFormat);
+        reset_ptr((void*)dst2, c->dstFormat);
+        return c->swscale(c, src2, srcStride2, dstSliceY, dstSliceH, dst2, dstStride2);
+    }
+
+    reset_ptr(src2, c->srcFormat);
+    reset_ptr((void*)dst2, c->dstFormat);
+    return scale_rows(c, src2, srcStride2, 0, c->srcH, dst2, dstStride2,
+                      dstSliceY, dstSliceH);
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
+                         int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext *c = jobnr ? parent->slice_ctx[jobnr - 1] : parent;
+    const int h = parent->dstH;
+    const int slice_start = (h *  jobnr      / nb_jobs) & ~15;
+    const int slice_end   = jobnr == nb_jobs - 1 ? h : (h * (jobnr + 1) / nb_jobs) & ~15;
+    int ret = 0;
+
+    if (slice_end > slice_start)
+        ret = sws_scale_dst_slice(c, parent->slice_src, parent->slice_src_stride,
+                                  parent->slice_dst, parent->slice_dst_stride,
+                                  slice_start, slice_end - slice_start);
+    parent->slice_err[jobnr] = FFMIN(ret, 0);
+}
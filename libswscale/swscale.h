@@ -218,6 +218,38 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Scale the whole source image and write only the rows of the
+ * destination image from dstSliceY to dstSliceY + dstSliceH - 1.
+ *
+ * Unlike sws_scale(), no state is carried from one call to the next, so
+ * several contexts initialized with the same parameters can write
+ * different slices of the same destination image concurrently. The rows
+ * written are identical to the ones written by sws_scale() for the whole
+ * image.
+ *
+ * @param c         the scaling context previously created with
+ *                  sws_getContext()
+ * @param src       the array containing the pointers to the planes of
+ *                  the whole source image
+ * @param srcStride the array containing the strides for each plane of
+ *                  the source image
+ * @param dst       the array containing the pointers to the planes of
+ *                  the whole destination image
+ * @param dstStride the array containing the strides for each plane of
+ *                  the destination image
+ * @param dstSliceY the first row to write, a multiple of 16
+ * @param dstSliceH the number of rows to write, a multiple of 16 unless
+ *                  the slice ends at the last row
+ * @return          the number of rows written, AVERROR(ENOSYS) if the
+ *                  conversion cannot be split (error diffusion dithering,
+ *                  Bayer or XYZ formats, conversions done through several
+ *                  internal contexts), or another negative error code
+ */
+int sws_scale_dst_slice(struct SwsContext *c, const uint8_t *const src[],
+                        const int srcStride[], uint8_t *const dst[],
+                        const int dstStride[], int dstSliceY, int dstSliceH);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -61,6 +61,7 @@
 #define RETCODE_USE_CASCADE -12345
 
 struct SwsContext;
+struct AVSliceThread;
 
 typedef enum SwsDither {
     SWS_DITHER_NONE = 0,
@@ -321,6 +322,20 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* The slice_* fields allow splitting whole frame conversions by
+     * destination rows, each band being scaled by its own context on the
+     * threads of slicethread.
+     */
+    int nb_threads;               ///< Number of threads requested by the user, 0 for automatic.
+    struct AVSliceThread *slicethread;
+    struct SwsContext **slice_ctx;
+    int *slice_err;
+    int nb_slice_ctx;
+    const uint8_t *const *slice_src;
+    const int *slice_src_stride;
+    uint8_t *const *slice_dst;
+    const int *slice_dst_stride;
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -426,6 +441,7 @@ typedef struct SwsContext {
     int dst0Alpha;
     int srcXYZ;
     int dstXYZ;
+    int slice_dependent;          ///< unscaled converter output depends on the slice boundaries
     int src_h_chr_pos;
     int dst_h_chr_pos;
     int src_v_chr_pos;
@@ -852,6 +868,13 @@ void ff_get_unscaled_swscale_ppc(SwsContext *c);
 void ff_get_unscaled_swscale_arm(SwsContext *c);
 void ff_get_unscaled_swscale_aarch64(SwsContext *c);
 
+/**
+ * Slice thread worker: scale one band of the destination image with the
+ * context of the job, see sws_scale_dst_slice().
+ */
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
+                         int nb_threads);
+
 /**
  * Return function pointer to fastest main scaler path function depending
  * on architecture and available optimizations.
@@ -0,0 +1,147 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check that scaling with the threads option gives the same output as
+ * scaling on the calling thread.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+static const struct {
+    enum AVPixelFormat src_fmt, dst_fmt;
+    int src_w, src_h, dst_w, dst_h;
+    int flags;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_YUV420P,   352, 288,  640, 480, SWS_BICUBIC  },
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_RGB24,     352, 288,  352, 288, SWS_BILINEAR },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_YUV420P,   640, 480,  320, 240, SWS_BICUBIC  },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_YUV420P,   720, 576,  480, 270, SWS_LANCZOS  },
+    { AV_PIX_FMT_NV12,        AV_PIX_FMT_BGRA,      320, 240,  600, 338, SWS_POINT    },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_YUVA420P,  200, 150,  200,  40, SWS_AREA     },
+    { AV_PIX_FMT_YUVA444P,    AV_PIX_FMT_YUV444P16LE, 99, 77,  173, 131, SWS_GAUSS    },
+};
+
+static struct SwsContext *alloc_context(int i, int nb_threads)
+{
+    struct SwsContext *c = sws_alloc_context();
+
+    if (!c)
+        return NULL;
+    av_opt_set_int(c, "srcw",       tests[i].src_w,   0);
+    av_opt_set_int(c, "srch",       tests[i].src_h,   0);
+    av_opt_set_int(c, "src_format", tests[i].src_fmt, 0);
+    av_opt_set_int(c, "dstw",       tests[i].dst_w,   0);
+    av_opt_set_int(c, "dsth",       tests[i].dst_h,   0);
+    av_opt_set_int(c, "dst_format", tests[i].dst_fmt, 0);
+    av_opt_set_int(c, "sws_flags",  tests[i].flags | SWS_BITEXACT | SWS_ACCURATE_RND, 0);
+    av_opt_set_int(c, "threads",    nb_threads,       0);
+    if (sws_init_context(c, NULL, NULL) < 0) {
+        sws_freeContext(c);
+        return NULL;
+    }
+    return c;
+}
+
+/* scale src and pack the result without the line padding */
+static int scale(int i, int nb_threads, uint8_t *const src[4], const int src_linesize[4],
+                 uint8_t *out, int out_size)
+{
+    struct SwsContext *c = alloc_context(i, nb_threads);
+    uint8_t *dst[4];
+    int dst_linesize[4];
+    int ret;
+
+    if (!c)
+        return -1;
+    ret = av_image_alloc(dst, dst_linesize, tests[i].dst_w, tests[i].dst_h,
+                         tests[i].dst_fmt, 32);
+    if (ret >= 0) {
+        ret = sws_scale(c, (const uint8_t * const *)src, src_linesize, 0,
+                        tests[i].src_h, dst, dst_linesize);
+        if (ret >= 0)
+            ret = av_image_copy_to_buffer(out, out_size, (const uint8_t * const *)dst,
+                                          dst_linesize, tests[i].dst_fmt,
+                                          tests[i].dst_w, tests[i].dst_h, 1);
+        av_freep(&dst[0]);
+    }
+    sws_freeContext(c);
+    return ret;
+}
+
+int main(void)
+{
+    AVLFG rand;
+    int i, j, ret = 0;
+
+    av_lfg_init(&rand, 1);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        uint8_t *src[4];
+        int src_linesize[4];
+        uint8_t *serial = NULL, *threaded = NULL;
+        int src_size, out_size;
+
+        printf("%s %dx%d -> %s %dx%d: ",
+               av_get_pix_fmt_name(tests[i].src_fmt), tests[i].src_w, tests[i].src_h,
+               av_get_pix_fmt_name(tests[i].dst_fmt), tests[i].dst_w, tests[i].dst_h);
+
+        src_size = av_image_alloc(src, src_linesize, tests[i].src_w, tests[i].src_h,
+                                  tests[i].src_fmt, 32);
+        out_size = av_image_get_buffer_size(tests[i].dst_fmt, tests[i].dst_w,
+                                            tests[i].dst_h, 1);
+        if (src_size < 0 || out_size < 0) {
+            printf("allocation failed\n");
+            return 1;
+        }
+        for (j = 0; j < src_size; j++)
+            src[0][j] = av_lfg_get(&rand);
+        /* keep 10-bit samples in range */
+        if (tests[i].src_fmt == AV_PIX_FMT_YUV422P10LE)
+            for (j = 1; j < src_size; j += 2)
+                src[0][j] &= 3;
+
+        serial   = av_malloc(out_size);
+        threaded = av_malloc(out_size);
+        if (!serial || !threaded ||
+            scale(i, 1, src, src_linesize, serial,   out_size) < 0 ||
+            scale(i, 4, src, src_linesize, threaded, out_size) < 0) {
+            printf("scaling failed\n");
+            ret = 1;
+        } else if (memcmp(serial, threaded, out_size)) {
+            printf("threaded output differs\n");
+            ret = 1;
+        } else {
+            printf("ok\n");
+        }
+
+        av_freep(&src[0]);
+        av_free(serial);
+        av_free(threaded);
+    }
+
+    return ret;
+}
@@ -49,6 +49,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavutil/ppc/cpu.h"
 #include "libavutil/x86/asm.h"
@@ -347,7 +348,7 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
     emms_c(); // FIXME should not be required but IS (even for non-MMX versions)
 
     // NOTE: the +3 is for the MMX(+1) / SSE(+3) scaler which reads over the end
-    FF_ALLOC_ARRAY_OR_GOTO(NULL, *filterPos, (dstW + 3), sizeof(**filterPos), fail);
+    FF_ALLOC_ARRAY_OR_GOTO(NULL, *filterPos, (dstW + 7), sizeof(**filterPos), fail);
 
     if (FFABS(xInc - 0x10000) < 10 && srcPos == dstPos) { // unscaled
         int i;
@@ -677,10 +678,10 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
         }
     }
 
-    // Note the +1 is for the MMX scaler which reads over the end
+    // Note the +7 is for the SIMD scalers which process 8 pixels at a time
     /* align at 16 for AltiVec (needed by hScale_altivec_real) */
     FF_ALLOCZ_ARRAY_OR_GOTO(NULL, *outFilter,
-                            (dstW + 3), *outFilterSize * sizeof(int16_t), fail);
+                            (dstW + 7), *outFilterSize * sizeof(int16_t), fail);
 
     /* normalize & store in outFilter */
     for (i = 0; i < dstW; i++) {
@@ -704,15 +705,13 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
         }
     }
 
-    (*filterPos)[dstW + 0] =
-    (*filterPos)[dstW + 1] =
-    (*filterPos)[dstW + 2] = (*filterPos)[dstW - 1]; /* the MMX/SSE scaler will
-                                                      * read over the end */
-    for (i = 0; i < *outFilterSize; i++) {
-        int k = (dstW - 1) * (*outFilterSize) + i;
-        (*outFilter)[k + 1 * (*outFilterSize)] =
-        (*outFilter)[k + 2 * (*outFilterSize)] =
-        (*outFilter)[k + 3 * (*outFilterSize)] = (*outFilter)[k];
+    /* the MMX/SSE/AVX2 scalers will read over the end */
+    for (i = dstW; i < dstW + 7; i++) {
+        int j;
+        (*filterPos)[i] = (*filterPos)[dstW - 1];
+        for (j = 0; j < *outFilterSize; j++)
+            (*outFilter)[i * (*outFilterSize) + j] =
+                (*outFilter)[(dstW - 1) * (*outFilterSize) + j];
     }
 
     ret = 0;
@@ -862,6 +861,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange,
+                                 table, dstRange, brightness, contrast,
+                                 saturation);
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -1162,8 +1167,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int init_single_context(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1863,6 +1868,89 @@ fail: // FIXME replace things by appropriate error codes
     return -1;
 }
 
+static av_cold void free_slice_contexts(SwsContext *c)
+{
+    int i;
+
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    av_freep(&c->slice_err);
+    c->nb_slice_ctx = 0;
+}
+
+static av_cold int init_slice_contexts(SwsContext *c, int nb_threads,
+                                       SwsFilter *srcFilter, SwsFilter *dstFilter)
+{
+    int i, ret;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, ff_sws_slice_worker,
+                                    NULL, nb_threads);
+    if (ret == AVERROR(ENOSYS))
+        return 0;
+    if (ret < 0)
+        return ret;
+    if (ret < 2) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+    nb_threads = ret;
+
+    c->slice_ctx = av_mallocz_array(nb_threads - 1, sizeof(*c->slice_ctx));
+    c->slice_err = av_mallocz_array(nb_threads,     sizeof(*c->slice_err));
+    if (!c->slice_ctx || !c->slice_err)
+        return AVERROR(ENOMEM);
+
+    /* the options of the initialized parent are already resolved, so the
+     * band contexts end up with the same setup */
+    for (i = 0; i < nb_threads - 1; i++) {
+        c->slice_ctx[i] = sws_alloc_context();
+        if (!c->slice_ctx[i])
+            return AVERROR(ENOMEM);
+        c->nb_slice_ctx++;
+        ret = av_opt_copy(c->slice_ctx[i], c);
+        if (ret < 0)
+            return ret;
+        c->slice_ctx[i]->nb_threads = 1;
+        ret = init_single_context(c->slice_ctx[i], srcFilter, dstFilter);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    int nb_threads = c->nb_threads ? c->nb_threads : av_cpu_count();
+    int ret;
+
+    ret = init_single_context(c, srcFilter, dstFilter);
+    if (ret < 0)
+        return ret;
+
+    /* the cascaded contexts do the work, they are not split */
+    if (c->cascaded_context[0])
+        return 0;
+
+    /* sws_scale_dst_slice() needs bands of at least 16 rows */
+    nb_threads = FFMIN(nb_threads, c->dstH / 16);
+    if (nb_threads > 1) {
+        ret = init_slice_contexts(c, nb_threads, srcFilter, dstFilter);
+        if (ret < 0) {
+            /* the parent alone gives the same output */
+            av_log(c, AV_LOG_WARNING,
+                   "Could not set up slice threading (%s), scaling on one thread\n",
+                   av_err2str(ret));
+            free_slice_contexts(c);
+        }
+    }
+
+    return 0;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2353,6 +2441,8 @@ void sws_freeContext(SwsContext *c)
     av_freep(&c->yuvTable);
     av_freep(&c->formatConvBuffer);
 
+    free_slice_contexts(c);
+
     sws_freeContext(c->cascaded_context[0]);
     sws_freeContext(c->cascaded_context[1]);
     sws_freeContext(c->cascaded_context[2]);
@@ -2380,6 +2470,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
                                              SWS_PARAM_DEFAULT };
     int64_t src_h_chr_pos = -513, dst_h_chr_pos = -513,
             src_v_chr_pos = -513, dst_v_chr_pos = -513;
+    int64_t nb_threads = 1;
 
     if (!param)
         param = default_param;
@@ -2399,6 +2490,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
         av_opt_get_int(context, "src_v_chr_pos", 0, &src_v_chr_pos);
         av_opt_get_int(context, "dst_h_chr_pos", 0, &dst_h_chr_pos);
         av_opt_get_int(context, "dst_v_chr_pos", 0, &dst_v_chr_pos);
+        av_opt_get_int(context, "threads",       0, &nb_threads);
         sws_freeContext(context);
         context = NULL;
     }
@@ -2420,6 +2512,7 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
         av_opt_set_int(context, "src_v_chr_pos", src_v_chr_pos, 0);
         av_opt_set_int(context, "dst_h_chr_pos", dst_h_chr_pos, 0);
         av_opt_set_int(context, "dst_v_chr_pos", dst_v_chr_pos, 0);
+        av_opt_set_int(context, "threads",       nb_threads,    0);
 
         if (sws_init_context(context, srcFilter, dstFilter) < 0) {
             sws_freeContext(context);
@@ -22,8 +22,9 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
+nv12_shuffle:  times 2 db 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15
 minshort:      times 8 dw 0x8000
 yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
 yuv2yuvX_10_start:  times 4 dd 0x10000
@@ -283,6 +284,149 @@ yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
 %endif
 
+;-----------------------------------------------------------------------------
+; AVX2 8-bit output, 16 pixels per iteration
+;
+; void yuv2planeX_8_avx2(const int16_t *filter, int filterSize,
+;                        const int16_t **src, uint8_t *dst, int dstW,
+;                        const uint8_t *dither, int offset)
+; void yuv2nv12cX_avx2(const uint8_t *dither, const int16_t *filter,
+;                      int filterSize, const int16_t **src1,
+;                      const int16_t **src2, uint8_t *dst, int dstW)
+;
+; punpck{l,h}wd work within lanes, so the accumulators hold pixels
+; {0-3 | 8-11} and {4-7 | 12-15}, and the dither pattern of pixels 0-7 is
+; repeated in both lanes. For yuv2nv12cX, $dither holds the 8 dither values
+; of the first component of each pair followed by the 8 of the second one,
+; and $filterSize may be odd.
+;-----------------------------------------------------------------------------
+
+; YUV2X_DITHER dst_lo, dst_hi, src
+%macro YUV2X_DITHER 3
+    pmovzxbd       xm%1, [%3+0]
+    pmovzxbd       xm%2, [%3+4]
+    pslld          xm%1, 12
+    pslld          xm%2, 12
+    vinserti128     m%1, m%1, xm%1, 1
+    vinserti128     m%2, m%2, xm%2, 1
+%endmacro
+
+; YUV2X_MADD acc_lo, acc_hi, line_a, line_b, coeffs
+%macro YUV2X_MADD 5
+    punpcklwd       m5, %3, %4
+    punpckhwd       %3, %4
+    pmaddwd         m5, %5
+    pmaddwd         %3, %5
+    paddd           %1, m5
+    paddd           %2, %3
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal yuv2planeX_8, 7, 10, 10, filter, fltsize, src, dst, w, dither, offset, cnt, line, pos
+    movq           xm0, [ditherq]
+    test       offsetd, offsetd
+    jz .no_rot
+    punpcklqdq     xm0, xm0
+    vpalignr       xm0, xm0, xm0, 3
+.no_rot:
+    pmovzxbd       xm8, xm0
+    psrldq         xm0, 4
+    pmovzxbd       xm9, xm0
+    pslld          xm8, 12
+    pslld          xm9, 12
+    vinserti128     m8, m8, xm8, 1
+    vinserti128     m9, m9, xm9, 1
+
+    movsxd           wq, wd
+    movsxd     fltsizeq, fltsized
+    xor            posq, posq
+.pixelloop:
+    mova            m1, m8
+    mova            m2, m9
+    mov           cntq, fltsizeq
+.filterloop:
+    mov          lineq, [srcq+cntq*gprsize-2*gprsize]
+    movu            m3, [lineq+posq*2]
+    mov          lineq, [srcq+cntq*gprsize-1*gprsize]
+    movu            m4, [lineq+posq*2]
+    vpbroadcastd    m0, [filterq+cntq*2-4]      ; coeff[cnt-2], coeff[cnt-1]
+    YUV2X_MADD      m1, m2, m3, m4, m0
+    sub           cntq, 2
+    jg .filterloop
+
+    psrad           m1, 19
+    psrad           m2, 19
+    packssdw        m1, m2
+    vextracti128   xm2, m1, 1
+    packuswb       xm1, xm2
+    movu   [dstq+posq], xm1
+    add            posq, 16
+    sub              wq, 16
+    jg .pixelloop
+    RET
+
+cglobal yuv2nv12cX, 7, 10, 14, dither, filter, fltsize, src1, src2, dst, w, cnt, line, pos
+    YUV2X_DITHER     8,  9, ditherq
+    YUV2X_DITHER    10, 11, ditherq+8
+    mova           m12, [nv12_shuffle]
+    pxor           m13, m13
+
+    movsxd           wq, wd
+    movsxd     fltsizeq, fltsized
+    xor            posq, posq
+.pixelloop:
+    mova            m0, m8
+    mova            m1, m9
+    mova            m2, m10
+    mova            m3, m11
+    xor           cntq, cntq
+    test       fltsized, 1
+    jz .check
+
+    ; odd filter size: tap 0 on its own, interleaved with zeroes
+    vpbroadcastw    m7, [filterq]
+    mov          lineq, [src1q]
+    movu            m4, [lineq+posq*2]
+    YUV2X_MADD      m0, m1, m4, m13, m7
+    mov          lineq, [src2q]
+    movu            m4, [lineq+posq*2]
+    YUV2X_MADD      m2, m3, m4, m13, m7
+    inc           cntq
+    jmp .check
+
+.filterloop:
+    vpbroadcastd    m7, [filterq+cntq*2]        ; coeff[cnt], coeff[cnt+1]
+    mov          lineq, [src1q+cntq*gprsize]
+    movu            m4, [lineq+posq*2]
+    mov          lineq, [src1q+cntq*gprsize+gprsize]
+    movu            m6, [lineq+posq*2]
+    YUV2X_MADD      m0, m1, m4, m6, m7
+    mov          lineq, [src2q+cntq*gprsize]
+    movu            m4, [lineq+posq*2]
+    mov          lineq, [src2q+cntq*gprsize+gprsize]
+    movu            m6, [lineq+posq*2]
+    YUV2X_MADD      m2, m3, m4, m6, m7
+    add           cntq, 2
+.check:
+    cmp           cntq, fltsizeq
+    jl .filterloop
+
+    psrad           m0, 19
+    psrad           m1, 19
+    psrad           m2, 19
+    psrad           m3, 19
+    packssdw        m0, m1                      ; first  component, pixels 0-15
+    packssdw        m2, m3                      ; second component, pixels 0-15
+    packuswb        m0, m2                      ; {a0-7, b0-7 | a8-15, b8-15}
+    pshufb          m0, m12                     ; {a0, b0, a1, b1, ...}
+    movu [dstq+posq*2], m0
+    add            posq, 16
+    sub              wq, 16
+    jg .pixelloop
+    RET
+%endif
+
 ; %1=outout-bpc, %2=alignment (u/a)
 %macro yuv2plane1_mainloop 2
 .loop_%2:
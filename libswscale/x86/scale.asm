@@ -21,8 +21,9 @@
 
 %include "libavutil/x86/x86util.asm"
 
-SECTION_RODATA
+SECTION_RODATA 32
 
+hscale_perm:   dd 0, 4, 1, 5, 2, 6, 3, 7
 max_19bit_int: times 4 dd 0x7ffff
 max_19bit_flt: times 4 dd 524287.0
 minshort:      times 8 dw 0x8000
@@ -421,3 +422,263 @@ INIT_XMM ssse3
 SCALE_FUNCS2 6, 6, 8
 INIT_XMM sse4
 SCALE_FUNCS2 6, 6, 8
+
+;-----------------------------------------------------------------------------
+; AVX2 versions of the above. The fixed filter sizes produce 8 output pixels
+; per iteration, the generic version (filterSize a multiple of 8) produces 4.
+; filterPos[] and filter[] are padded to a multiple of 8 output pixels by
+; initFilter(), and dst is written up to that multiple as well.
+;-----------------------------------------------------------------------------
+
+; SCALE_FUNC_AVX2 source_width, intermediate_nbits, filtersize
+%macro SCALE_FUNC_AVX2 3
+%if %1 == 8
+%define srcmul 1
+%else
+%define srcmul 2
+%endif
+
+%ifnidn %3, X8
+cglobal hscale%1to%2_%3, 6, 9, 9, pos0, dst, w, src, filter, fltpos, pos1, pos2, pos3
+%else
+cglobal hscale%1to%2_%3, 7, 12, 10, pos0, dst, w, src, filter, fltpos, fltsize, \
+                                    pos1, pos2, pos3, cnt, fltsize3
+%endif
+    movsxd        wq, wd
+%if %2 == 19
+    vpbroadcastd  m2, [max_19bit_int]
+%endif
+%if %1 == 16
+    vpbroadcastd  m6, [minshort]
+    vpbroadcastd  m7, [unicoeff]
+%endif
+    lea      fltposq, [fltposq+wq*4]
+%if %2 == 15
+    lea         dstq, [dstq+wq*2]
+%else ; %2 == 19
+    lea         dstq, [dstq+wq*4]
+%endif ; %2 == 15/19
+    neg           wq
+
+%ifidn %3, 4
+.loop:
+    ; src[filterPos[0..7] + {0,1,2,3}] into m0 (pixels 0-3) and m1 (4-7)
+    movsxd     pos0q, dword [fltposq+wq*4+ 0]
+    movsxd     pos1q, dword [fltposq+wq*4+ 4]
+    movsxd     pos2q, dword [fltposq+wq*4+ 8]
+    movsxd     pos3q, dword [fltposq+wq*4+12]
+%if %1 == 8
+    movd         xm0, [srcq+pos0q]
+    pinsrd       xm0, [srcq+pos1q], 1
+    pinsrd       xm0, [srcq+pos2q], 2
+    pinsrd       xm0, [srcq+pos3q], 3
+%else ; %1 > 8
+    movq         xm0, [srcq+pos0q*2]
+    movhps       xm0, [srcq+pos1q*2]
+    movq         xm4, [srcq+pos2q*2]
+    movhps       xm4, [srcq+pos3q*2]
+%endif ; %1 == 8
+    movsxd     pos0q, dword [fltposq+wq*4+16]
+    movsxd     pos1q, dword [fltposq+wq*4+20]
+    movsxd     pos2q, dword [fltposq+wq*4+24]
+    movsxd     pos3q, dword [fltposq+wq*4+28]
+%if %1 == 8
+    movd         xm1, [srcq+pos0q]
+    pinsrd       xm1, [srcq+pos1q], 1
+    pinsrd       xm1, [srcq+pos2q], 2
+    pinsrd       xm1, [srcq+pos3q], 3
+    pmovzxbw      m0, xm0
+    pmovzxbw      m1, xm1
+%else ; %1 > 8
+    movq         xm1, [srcq+pos0q*2]
+    movhps       xm1, [srcq+pos1q*2]
+    movq         xm5, [srcq+pos2q*2]
+    movhps       xm5, [srcq+pos3q*2]
+    vinserti128   m0, m0, xm4, 1
+    vinserti128   m1, m1, xm5, 1
+%endif ; %1 == 8
+
+%if %1 == 16 ; pmaddwd needs signed adds, so this moves unsigned -> signed, we'll
+             ; add back 0x8000 * sum(coeffs) after the horizontal add
+    psubw         m0, m6
+    psubw         m1, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+ 0]              ; filter[{ 0, 1,...,14,15}]
+    pmaddwd       m1, [filterq+32]              ; filter[{16,17,...,30,31}]
+    add      filterq, 64
+
+    ; add up horizontally, phaddd works within lanes:
+    ; {0,1,4,5 | 2,3,6,7} -> {0,1,2,3 | 4,5,6,7}
+    phaddd        m0, m1
+    vpermq        m0, m0, q3120
+%else ; %3 == 8 || %3 == X8
+%ifidn %3, X8
+    movsxd  fltsizeq, fltsized
+    lea    fltsize3q, [fltsizeq*3]
+    add    fltsize3q, fltsize3q                 ; 3 * filterSize * sizeof(*filter)
+%else ; %3 == 8
+    movu          m3, [hscale_perm]
+%endif ; %3 == 8/X8
+
+.loop:
+%ifidn %3, 8
+%assign %%i 0
+%rep 2
+    ; src[filterPos[0..7] + {0,..,7}], one pixel per lane
+    movsxd     pos0q, dword [fltposq+wq*4+%%i*16+ 0]
+    movsxd     pos1q, dword [fltposq+wq*4+%%i*16+ 4]
+    movsxd     pos2q, dword [fltposq+wq*4+%%i*16+ 8]
+    movsxd     pos3q, dword [fltposq+wq*4+%%i*16+12]
+%if %%i == 0
+%define ma m0
+%define mb m1
+%else
+%define ma m4
+%define mb m5
+%endif
+%if %1 == 8
+    movq        xm8, [srcq+pos0q]
+    movhps      xm8, [srcq+pos1q]
+    pmovzxbw     ma, xm8
+    movq        xm8, [srcq+pos2q]
+    movhps      xm8, [srcq+pos3q]
+    pmovzxbw     mb, xm8
+%else ; %1 > 8
+    movu        xm8, [srcq+pos0q*2]
+    vinserti128  ma, m8, [srcq+pos1q*2], 1
+    movu        xm8, [srcq+pos2q*2]
+    vinserti128  mb, m8, [srcq+pos3q*2], 1
+%endif ; %1 == 8
+%assign %%i %%i+1
+%endrep
+
+%if %1 == 16 ; pmaddwd needs signed adds, so this moves unsigned -> signed, we'll
+             ; add back 0x8000 * sum(coeffs) after the horizontal add
+    psubw         m0, m6
+    psubw         m1, m6
+    psubw         m4, m6
+    psubw         m5, m6
+%endif ; %1 == 16
+    pmaddwd       m0, [filterq+ 0]              ; filter[{ 0, 1,...,14,15}]
+    pmaddwd       m1, [filterq+32]              ; filter[{16,17,...,30,31}]
+    pmaddwd       m4, [filterq+64]              ; filter[{32,33,...,46,47}]
+    pmaddwd       m5, [filterq+96]              ; filter[{48,49,...,62,63}]
+    add      filterq, 128
+
+    ; add up horizontally, lane 0 holds the even pixels and lane 1 the odd ones:
+    ; {0,2,4,6 | 1,3,5,7} -> {0,1,2,3 | 4,5,6,7}
+    phaddd        m0, m1
+    phaddd        m4, m5
+    phaddd        m0, m4
+    vpermd        m0, m3, m0
+%else ; %3 == X8
+    ; pixels 0 and 1 in m4, pixels 2 and 3 in m5, one per lane
+    movsxd     pos0q, dword [fltposq+wq*4+ 0]
+    movsxd     pos1q, dword [fltposq+wq*4+ 4]
+    movsxd     pos2q, dword [fltposq+wq*4+ 8]
+    movsxd     pos3q, dword [fltposq+wq*4+12]
+    lea        pos0q, [srcq+pos0q*srcmul]
+    lea        pos1q, [srcq+pos1q*srcmul]
+    lea        pos2q, [srcq+pos2q*srcmul]
+    lea        pos3q, [srcq+pos3q*srcmul]
+    pxor          m4, m4
+    pxor          m5, m5
+    mov         cntq, fltsizeq
+
+.innerloop:
+%if %1 == 8
+    movq         xm0, [pos0q]
+    movhps       xm0, [pos1q]
+    movq         xm1, [pos2q]
+    movhps       xm1, [pos3q]
+    pmovzxbw      m0, xm0
+    pmovzxbw      m1, xm1
+%else ; %1 > 8
+    movu         xm0, [pos0q]
+    vinserti128   m0, m0, [pos1q], 1
+    movu         xm1, [pos2q]
+    vinserti128   m1, m1, [pos3q], 1
+%endif ; %1 == 8
+    movu         xm8, [filterq]                 ; filter[         {0,..,7}]
+    vinserti128   m8, m8, [filterq+fltsizeq*2], 1 ; filter[1 * filterSize + {0,..,7}]
+    movu         xm9, [filterq+fltsizeq*4]      ; filter[2 * filterSize + {0,..,7}]
+    vinserti128   m9, m9, [filterq+fltsize3q], 1 ; filter[3 * filterSize + {0,..,7}]
+%if %1 == 16 ; pmaddwd needs signed adds, so this moves unsigned -> signed, we'll
+             ; add back 0x8000 * sum(coeffs) after the horizontal add
+    psubw         m0, m6
+    psubw         m1, m6
+%endif ; %1 == 16
+    pmaddwd       m0, m8
+    pmaddwd       m1, m9
+    paddd         m4, m0
+    paddd         m5, m1
+    add      filterq, 16
+    add        pos0q, 8*srcmul
+    add        pos1q, 8*srcmul
+    add        pos2q, 8*srcmul
+    add        pos3q, 8*srcmul
+    sub         cntq, 8
+    jg .innerloop
+
+    add      filterq, fltsize3q                 ; skip the filters of pixels 1-3
+
+    ; {0,0,2,2 | 1,1,3,3} -> {0,2,1,3} -> {0,1,2,3}
+    phaddd        m4, m5
+    vextracti128 xm5, m4, 1
+    phaddd       xm4, xm5
+    pshufd       xm0, xm4, q3120
+%endif ; %3 == 8/X8
+%endif ; %3 == 4/8/X8
+
+%if %1 == 16 ; add 0x8000 * sum(coeffs), i.e. back from signed -> unsigned
+    paddd         m0, m7
+%endif ; %1 == 16
+
+    ; clip, store
+    psrad         m0, 14 + %1 - %2
+%ifidn %3, X8
+%if %2 == 15
+    packssdw     xm0, xm0
+    movq [dstq+wq*2], xm0
+%else ; %2 == 19
+    pminsd       xm0, xm2
+    movu [dstq+wq*4], xm0
+%endif ; %2 == 15/19
+    add           wq, 4
+%else ; %3 == 4/8
+%if %2 == 15
+    vextracti128 xm1, m0, 1
+    packssdw     xm0, xm1
+    movu [dstq+wq*2], xm0
+%else ; %2 == 19
+    pminsd        m0, m2
+    movu [dstq+wq*4], m0
+%endif ; %2 == 15/19
+    add           wq, 8
+%endif ; %3 == X8
+    jl .loop
+    RET
+%endmacro
+
+; SCALE_FUNCS_AVX2 source_width, intermediate_nbits
+%macro SCALE_FUNCS_AVX2 2
+SCALE_FUNC_AVX2 %1, %2, 4
+SCALE_FUNC_AVX2 %1, %2, 8
+SCALE_FUNC_AVX2 %1, %2, X8
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SCALE_FUNCS_AVX2  8, 15
+SCALE_FUNCS_AVX2  9, 15
+SCALE_FUNCS_AVX2 10, 15
+SCALE_FUNCS_AVX2 12, 15
+SCALE_FUNCS_AVX2 14, 15
+SCALE_FUNCS_AVX2 16, 15
+SCALE_FUNCS_AVX2  8, 19
+SCALE_FUNCS_AVX2  9, 19
+SCALE_FUNCS_AVX2 10, 19
+SCALE_FUNCS_AVX2 12, 19
+SCALE_FUNCS_AVX2 14, 19
+SCALE_FUNCS_AVX2 16, 19
+%endif
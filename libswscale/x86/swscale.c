@@ -316,6 +316,13 @@ SCALE_FUNCS_SSE(sse2);
 SCALE_FUNCS_SSE(ssse3);
 SCALE_FUNCS_SSE(sse4);
 
+#define SCALE_FUNCS_AVX2(opt) \
+    SCALE_FUNCS(4, opt); \
+    SCALE_FUNCS(8, opt); \
+    SCALE_FUNCS(X8, opt)
+
+SCALE_FUNCS_AVX2(avx2);
+
 #define VSCALEX_FUNC(size, opt) \
 void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filterSize, \
                                         const int16_t **src, uint8_t *dest, int dstW, \
@@ -332,6 +339,39 @@ VSCALEX_FUNCS(sse2);
 VSCALEX_FUNCS(sse4);
 VSCALEX_FUNC(16, sse4);
 VSCALEX_FUNCS(avx);
+VSCALEX_FUNC(8, avx2);
+
+#if ARCH_X86_64
+void ff_yuv2nv12cX_avx2(const uint8_t *dither, const int16_t *filter,
+                        int filterSize, const int16_t **src1,
+                        const int16_t **src2, uint8_t *dst, int dstW);
+
+static void yuv2nv12cX_avx2(SwsContext *c, const int16_t *chrFilter,
+                            int chrFilterSize, const int16_t **chrUSrc,
+                            const int16_t **chrVSrc, uint8_t *dest, int chrDstW)
+{
+    const uint8_t *chrDither = c->chrDither8;
+    uint8_t dither[16];
+    int i;
+
+    /* U uses dither[i & 7] and V dither[(i + 3) & 7], see yuv2nv12cX_c() */
+    if (c->dstFormat == AV_PIX_FMT_NV12 || c->dstFormat == AV_PIX_FMT_NV24) {
+        for (i = 0; i < 8; i++) {
+            dither[i]     = chrDither[ i      & 7];
+            dither[i + 8] = chrDither[(i + 3) & 7];
+        }
+        ff_yuv2nv12cX_avx2(dither, chrFilter, chrFilterSize,
+                           chrUSrc, chrVSrc, dest, chrDstW);
+    } else {
+        for (i = 0; i < 8; i++) {
+            dither[i]     = chrDither[(i + 3) & 7];
+            dither[i + 8] = chrDither[ i      & 7];
+        }
+        ff_yuv2nv12cX_avx2(dither, chrFilter, chrFilterSize,
+                           chrVSrc, chrUSrc, dest, chrDstW);
+    }
+}
+#endif
 
 #define VSCALE_FUNC(size, opt) \
 void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
@@ -380,6 +420,81 @@ INPUT_FUNCS(mmx);
 INPUT_FUNCS(sse2);
 INPUT_FUNCS(ssse3);
 INPUT_FUNCS(avx);
+#if ARCH_X86_64
+INPUT_FUNCS(avx2);
+
+/*
+ * The AVX2 readers load whole groups of 16 (RGB24, plus 4 bytes) or 32 (NV12)
+ * pixels, up to 49 or 62 bytes past the end of the line, which is more than
+ * the source padding covers. Convert the groups that stay inside the line in
+ * place and the rest from a padded copy.
+ */
+#define RGB24_AVX2_FUNCS(fmt) \
+static void fmt ## ToY_avx2(uint8_t *dst, const uint8_t *src, \
+                            const uint8_t *unused1, const uint8_t *unused2, \
+                            int w, uint32_t *unused) \
+{ \
+    LOCAL_ALIGNED_32(uint8_t, src_tail, [3 * 32 + 4]); \
+    LOCAL_ALIGNED_32(int16_t, dst_tail, [32]); \
+    int n = FFMAX(w - 2, 0) & ~15; /* 3 * n + 4 <= 3 * w */ \
+ \
+    if (n) \
+        ff_ ## fmt ## ToY_avx2(dst, src, NULL, NULL, n, NULL); \
+    if (w > n) { \
+        memcpy(src_tail, src + 3 * n, 3 * (w - n)); \
+        ff_ ## fmt ## ToY_avx2((uint8_t *)dst_tail, src_tail, NULL, NULL, w - n, NULL); \
+        memcpy(dst + 2 * n, dst_tail, 2 * (w - n)); \
+    } \
+} \
+ \
+static void fmt ## ToUV_avx2(uint8_t *dstU, uint8_t *dstV, \
+                             const uint8_t *unused0, \
+                             const uint8_t *src1, \
+                             const uint8_t *src2, \
+                             int w, uint32_t *unused) \
+{ \
+    LOCAL_ALIGNED_32(uint8_t, src_tail, [3 * 32 + 4]); \
+    LOCAL_ALIGNED_32(int16_t, dst_tail, [2], [32]); \
+    int n = FFMAX(w - 2, 0) & ~15; \
+ \
+    if (n) \
+        ff_ ## fmt ## ToUV_avx2(dstU, dstV, NULL, src1, NULL, n, NULL); \
+    if (w > n) { \
+        memcpy(src_tail, src1 + 3 * n, 3 * (w - n)); \
+        ff_ ## fmt ## ToUV_avx2((uint8_t *)dst_tail[0], (uint8_t *)dst_tail[1], \
+                                NULL, src_tail, NULL, w - n, NULL); \
+        memcpy(dstU + 2 * n, dst_tail[0], 2 * (w - n)); \
+        memcpy(dstV + 2 * n, dst_tail[1], 2 * (w - n)); \
+    } \
+}
+
+#define NVXX_AVX2_FUNC(fmt) \
+static void fmt ## ToUV_avx2(uint8_t *dstU, uint8_t *dstV, \
+                             const uint8_t *unused0, \
+                             const uint8_t *src1, \
+                             const uint8_t *src2, \
+                             int w, uint32_t *unused) \
+{ \
+    LOCAL_ALIGNED_32(uint8_t, src_tail, [2 * 32]); \
+    LOCAL_ALIGNED_32(uint8_t, dst_tail, [2], [32]); \
+    int n = w & ~31; \
+ \
+    if (n) \
+        ff_ ## fmt ## ToUV_avx2(dstU, dstV, NULL, src1, NULL, n, NULL); \
+    if (w > n) { \
+        memcpy(src_tail, src1 + 2 * n, 2 * (w - n)); \
+        ff_ ## fmt ## ToUV_avx2(dst_tail[0], dst_tail[1], NULL, src_tail, NULL, \
+                                w - n, NULL); \
+        memcpy(dstU + n, dst_tail[0], w - n); \
+        memcpy(dstV + n, dst_tail[1], w - n); \
+    } \
+}
+
+RGB24_AVX2_FUNCS(rgb24)
+RGB24_AVX2_FUNCS(bgr24)
+NVXX_AVX2_FUNC(nv12)
+NVXX_AVX2_FUNC(nv21)
+#endif
 
 av_cold void ff_sws_init_swscale_x86(SwsContext *c)
 {
@@ -581,4 +696,50 @@ switch(c->dstBpc){ \
             break;
         }
     }
+
+#if ARCH_X86_64
+#define ASSIGN_AVX2_SCALE_FUNC(hscalefn, filtersize) \
+    switch (filtersize) { \
+    case 4:  ASSIGN_SCALE_FUNC2(hscalefn, 4, avx2, avx2); break; \
+    case 8:  ASSIGN_SCALE_FUNC2(hscalefn, 8, avx2, avx2); break; \
+    default: if (!(filtersize & 4)) \
+                 ASSIGN_SCALE_FUNC2(hscalefn, X8, avx2, avx2); \
+             break; \
+    }
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        ASSIGN_AVX2_SCALE_FUNC(c->hyScale, c->hLumFilterSize);
+        ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
+        if (c->dstBpc == 8) {
+            if (!c->use_mmx_vfilter)
+                c->yuv2planeX = ff_yuv2planeX_8_avx2;
+            if (isSemiPlanarYUV(c->dstFormat))
+                c->yuv2nv12cX = yuv2nv12cX_avx2;
+        }
+
+        switch (c->srcFormat) {
+        case AV_PIX_FMT_NV12:
+            c->chrToYV12 = nv12ToUV_avx2;
+            break;
+        case AV_PIX_FMT_NV21:
+            c->chrToYV12 = nv21ToUV_avx2;
+            break;
+        case AV_PIX_FMT_RGB24:
+            c->lumToYV12 = rgb24ToY_avx2;
+            if (!c->chrSrcHSubSample)
+                c->chrToYV12 = rgb24ToUV_avx2;
+            break;
+        case AV_PIX_FMT_BGR24:
+            c->lumToYV12 = bgr24ToY_avx2;
+            if (!c->chrSrcHSubSample)
+                c->chrToYV12 = bgr24ToUV_avx2;
+            break;
+        case_rgb(bgra,  BGRA,  avx2);
+        case_rgb(rgba,  RGBA,  avx2);
+        case_rgb(abgr,  ABGR,  avx2);
+        case_rgb(argb,  ARGB,  avx2);
+        default:
+            break;
+        }
+    }
+#endif
 }
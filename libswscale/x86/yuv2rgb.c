@@ -69,11 +69,72 @@ DECLARE_ASM_CONST(8, uint64_t, pb_07) = 0x0707070707070707ULL;
 
 #endif /* HAVE_INLINE_ASM */
 
+#if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+/* The AVX2 functions convert 32 pixels per call iteration. Rows whose
+ * width is not a multiple of 32 get their last block converted again,
+ * overlapping the previous one, which rewrites identical values. */
+#define YUV2RGB_FUNC_AVX2(name, depth)                                      \
+void ff_ ## name ## _avx2(uint8_t *image, const uint8_t *py,                \
+                          const uint8_t *pu, const uint8_t *pv,             \
+                          const uint64_t *coeffs, int w);                   \
+                                                                            \
+static int name ## _avx2(SwsContext *c, const uint8_t *src[],               \
+                         int srcStride[], int srcSliceY, int srcSliceH,     \
+                         uint8_t *dst[], int dstStride[])                   \
+{                                                                           \
+    int y, h_size, vshift;                                                  \
+                                                                            \
+    h_size = (c->dstW + 7) & ~7;                                            \
+    if (h_size * depth > FFABS(dstStride[0]))                               \
+        h_size -= 8;                                                        \
+                                                                            \
+    vshift = c->srcFormat != AV_PIX_FMT_YUV422P;                            \
+                                                                            \
+    for (y = 0; y < srcSliceH; y++) {                                       \
+        uint8_t *image    = dst[0] + (y + srcSliceY) * dstStride[0];        \
+        const uint8_t *py = src[0] +               y * srcStride[0];        \
+        const uint8_t *pu = src[1] +   (y >> vshift) * srcStride[1];        \
+        const uint8_t *pv = src[2] +   (y >> vshift) * srcStride[2];        \
+        int tail = h_size - 32;                                             \
+                                                                            \
+        ff_ ## name ## _avx2(image, py, pu, pv, &c->redDither,              \
+                             h_size & ~31);                                 \
+        if (h_size & 31)                                                    \
+            ff_ ## name ## _avx2(image + tail * depth, py + tail,           \
+                                 pu + tail / 2, pv + tail / 2,              \
+                                 &c->redDither, 32);                        \
+    }                                                                       \
+    return srcSliceH;                                                       \
+}
+
+YUV2RGB_FUNC_AVX2(yuv420_rgb32, 4)
+YUV2RGB_FUNC_AVX2(yuv420_bgr32, 4)
+YUV2RGB_FUNC_AVX2(yuv420_rgb24, 3)
+YUV2RGB_FUNC_AVX2(yuv420_bgr24, 3)
+#endif /* ARCH_X86_64 && HAVE_AVX2_EXTERNAL */
+
 av_cold SwsFunc ff_yuv2rgb_init_x86(SwsContext *c)
 {
-#if HAVE_MMX_INLINE && HAVE_6REGS
     int cpu_flags = av_get_cpu_flags();
 
+#if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+    /* needs at least one full block per row */
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && c->dstW >= 32 &&
+        c->srcFormat != AV_PIX_FMT_YUVA420P) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB32:
+            return yuv420_rgb32_avx2;
+        case AV_PIX_FMT_BGR32:
+            return yuv420_bgr32_avx2;
+        case AV_PIX_FMT_RGB24:
+            return yuv420_rgb24_avx2;
+        case AV_PIX_FMT_BGR24:
+            return yuv420_bgr24_avx2;
+        }
+    }
+#endif
+
+#if HAVE_MMX_INLINE && HAVE_6REGS
 #if HAVE_MMXEXT_INLINE
     if (INLINE_MMXEXT(cpu_flags)) {
         switch (c->dstFormat) {
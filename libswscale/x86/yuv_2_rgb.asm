@@ -0,0 +1,185 @@
+;******************************************************************************
+;* x86-optimized yuv2rgb conversion
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+; even/odd pixels after packuswb -> pixel order, per lane
+pb_interleave: times 2 db 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15
+
+; 16 pixels of three planar components -> 48 bytes of packed 24-bit pixels,
+; per lane; shuf24_<out>_<component>
+shuf24_0_0: times 2 db    0, 0x80, 0x80,    1, 0x80, 0x80,    2, 0x80, \
+                       0x80,    3, 0x80, 0x80,    4, 0x80, 0x80,    5
+shuf24_0_1: times 2 db 0x80,    0, 0x80, 0x80,    1, 0x80, 0x80,    2, \
+                       0x80, 0x80,    3, 0x80, 0x80,    4, 0x80, 0x80
+shuf24_0_2: times 2 db 0x80, 0x80,    0, 0x80, 0x80,    1, 0x80, 0x80, \
+                          2, 0x80, 0x80,    3, 0x80, 0x80,    4, 0x80
+shuf24_1_0: times 2 db 0x80, 0x80,    6, 0x80, 0x80,    7, 0x80, 0x80, \
+                          8, 0x80, 0x80,    9, 0x80, 0x80,   10, 0x80
+shuf24_1_1: times 2 db    5, 0x80, 0x80,    6, 0x80, 0x80,    7, 0x80, \
+                       0x80,    8, 0x80, 0x80,    9, 0x80, 0x80,   10
+shuf24_1_2: times 2 db 0x80,    5, 0x80, 0x80,    6, 0x80, 0x80,    7, \
+                       0x80, 0x80,    8, 0x80, 0x80,    9, 0x80, 0x80
+shuf24_2_0: times 2 db 0x80,   11, 0x80, 0x80,   12, 0x80, 0x80,   13, \
+                       0x80, 0x80,   14, 0x80, 0x80,   15, 0x80, 0x80
+shuf24_2_1: times 2 db 0x80, 0x80,   11, 0x80, 0x80,   12, 0x80, 0x80, \
+                         13, 0x80, 0x80,   14, 0x80, 0x80,   15, 0x80
+shuf24_2_2: times 2 db   10, 0x80, 0x80,   11, 0x80, 0x80,   12, 0x80, \
+                       0x80,   13, 0x80, 0x80,   14, 0x80, 0x80,   15
+
+SECTION .text
+
+;-----------------------------------------------------------------------------
+; YUV420 to packed RGB, using the same fixed-point arithmetic as the MMX
+; inline versions in yuv2rgb_template.c, so that the output is identical.
+;
+; void ff_yuv420_<fmt>_<opt>(uint8_t *image, const uint8_t *py,
+;                            const uint8_t *pu, const uint8_t *pv,
+;                            const uint64_t *coeffs, int w);
+;
+; coeffs points to SwsContext.redDither, w is a multiple of 32.
+;-----------------------------------------------------------------------------
+
+; offsets relative to SwsContext.redDither, see swscale_internal.h
+%define Y_COEFF   3*8
+%define VR_COEFF  4*8
+%define UB_COEFF  5*8
+%define VG_COEFF  6*8
+%define UG_COEFF  7*8
+%define Y_OFFSET  8*8
+%define U_OFFSET  9*8
+%define V_OFFSET 10*8
+
+; output: m0 = B, m1 = R, m2 = G (bytes, pixel order within each lane)
+%macro YUV2RGB 0
+    movu           m6, [pyq]              ; (byte) { Y0, Y1, ..., Y31 }
+    pmovzxbw       m0, [puq]              ; (word) { U0, ..., U15 }
+    pmovzxbw       m1, [pvq]              ; (word) { V0, ..., V15 }
+    psrlw          m7, m6, 8              ; (word) { Y1, Y3, ... }
+    psllw          m6, 8
+    psllw          m0, 3
+    psllw          m1, 3
+    psrlw          m6, 5                  ; (word) { Y0, Y2, ... } << 3
+    psllw          m7, 3
+    psubsw         m0, m14
+    psubsw         m1, m15
+    psubw          m6, m13
+    psubw          m7, m13
+
+    pmulhw         m2, m0, m12            ; UG
+    pmulhw         m3, m1, m11            ; VG
+    pmulhw         m6, m8
+    pmulhw         m7, m8
+    pmulhw         m0, m10                ; UB
+    pmulhw         m1, m9                 ; VR
+    paddsw         m2, m3                 ; CG
+
+    paddsw         m3, m7, m0             ; B odd
+    paddsw         m5, m7, m1             ; R odd
+    paddsw         m7, m2                 ; G odd
+    paddsw         m0, m6                 ; B even
+    paddsw         m1, m6                 ; R even
+    paddsw         m2, m6                 ; G even
+    packuswb       m0, m3
+    packuswb       m1, m5
+    packuswb       m2, m7
+    pshufb         m0, [pb_interleave]
+    pshufb         m1, [pb_interleave]
+    pshufb         m2, [pb_interleave]
+%endmacro
+
+; %1-%3 = first, second and third component in memory order
+%macro STORE_RGB32 3
+    pcmpeqb        m6, m6                 ; alpha
+    punpcklbw      m3, %1, %2
+    punpckhbw      %1, %2
+    punpcklbw      m4, %3, m6
+    punpckhbw      %3, m6
+    punpcklwd      m5, m3, m4             ; pixels  0- 3, 16-19
+    punpckhwd      m3, m4                 ; pixels  4- 7, 20-23
+    punpcklwd      m4, %1, %3             ; pixels  8-11, 24-27
+    punpckhwd      %1, %3                 ; pixels 12-15, 28-31
+    vperm2i128     m6, m5, m3, 0x20
+    vperm2i128     m5, m5, m3, 0x31
+    vperm2i128     m3, m4, %1, 0x20
+    vperm2i128     m4, m4, %1, 0x31
+    movu [imageq+ 0], m6
+    movu [imageq+32], m3
+    movu [imageq+64], m5
+    movu [imageq+96], m4
+%endmacro
+
+; %1-%3 = first, second and third component in memory order
+%macro STORE_RGB24 3
+    pshufb         m3, %1, [shuf24_0_0]
+    pshufb         m4, %2, [shuf24_0_1]
+    pshufb         m5, %3, [shuf24_0_2]
+    por            m3, m4
+    por            m3, m5                 ; bytes  0-15, 48-63
+    pshufb         m4, %1, [shuf24_1_0]
+    pshufb         m5, %2, [shuf24_1_1]
+    pshufb         m6, %3, [shuf24_1_2]
+    por            m4, m5
+    por            m4, m6                 ; bytes 16-31, 64-79
+    pshufb         %1, [shuf24_2_0]
+    pshufb         %2, [shuf24_2_1]
+    pshufb         %3, [shuf24_2_2]
+    por            %1, %2
+    por            %1, %3                 ; bytes 32-47, 80-95
+    vperm2i128     m5, m3, m4, 0x20
+    vperm2i128     m6, %1, m3, 0x30
+    vperm2i128     m4, m4, %1, 0x31
+    movu [imageq+ 0], m5
+    movu [imageq+32], m6
+    movu [imageq+64], m4
+%endmacro
+
+; %1 = format name, %2 = bytes per pixel, %3-%5 = component order in memory
+%macro YUV2RGB_FN 5
+cglobal yuv420_%1, 6, 6, 16, image, py, pu, pv, coeff, w
+    vpbroadcastq   m8, [coeffq+Y_COEFF]
+    vpbroadcastq   m9, [coeffq+VR_COEFF]
+    vpbroadcastq  m10, [coeffq+UB_COEFF]
+    vpbroadcastq  m11, [coeffq+VG_COEFF]
+    vpbroadcastq  m12, [coeffq+UG_COEFF]
+    vpbroadcastq  m13, [coeffq+Y_OFFSET]
+    vpbroadcastq  m14, [coeffq+U_OFFSET]
+    vpbroadcastq  m15, [coeffq+V_OFFSET]
+.loop:
+    YUV2RGB
+    STORE_RGB%2 %3, %4, %5
+    add           pyq, 32
+    add           puq, 16
+    add           pvq, 16
+    add        imageq, 32 * %2 / 8
+    sub            wd, 32
+    jg .loop
+    RET
+%endmacro
+
+%if ARCH_X86_64 && HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+YUV2RGB_FN rgb32, 32, m0, m2, m1
+YUV2RGB_FN bgr32, 32, m1, m2, m0
+YUV2RGB_FN rgb24, 24, m1, m2, m0
+YUV2RGB_FN bgr24, 24, m0, m2, m1
+%endif
@@ -21,9 +21,13 @@
 
 #include "libavutil/common.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/log.h"
 #include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
 
 #include "libswscale/rgb2rgb.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
 
 #include "checkasm.h"
 
@@ -111,6 +115,220 @@ static void check_uyvy_to_422p(void)
     }
 }
 
+#define MAX_LINE 256
+
+static const enum AVPixelFormat rgb_formats[] = {
+    AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+    AV_PIX_FMT_RGBA,  AV_PIX_FMT_BGRA,
+    AV_PIX_FMT_ARGB,  AV_PIX_FMT_ABGR,
+};
+
+static const int line_widths[] = { 4, 7, 16, 31, 64, 123, 256 };
+
+static void check_rgb_to_yuv(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_LINE * 4 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_y_0, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_y_1, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_0, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_1, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_0, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_1, [MAX_LINE * 2 + 64]);
+    int i, f;
+
+    randomize_buffers(src, MAX_LINE * 4 + 64);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(rgb_formats); f++) {
+        const char *name = av_get_pix_fmt_name(rgb_formats[f]);
+        struct SwsContext *ctx = sws_getContext(MAX_LINE, 2, rgb_formats[f],
+                                                MAX_LINE / 2, 2, AV_PIX_FMT_YUV444P,
+                                                SWS_BILINEAR | SWS_FULL_CHR_H_INP,
+                                                NULL, NULL, NULL);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+
+        {
+            declare_func(void, uint8_t *dst, const uint8_t *src,
+                         const uint8_t *src2, const uint8_t *src3,
+                         int width, uint32_t *pal);
+
+            if (check_func(ctx->lumToYV12, "%sToY", name)) {
+                for (i = 0; i < FF_ARRAY_ELEMS(line_widths); i++) {
+                    int w = line_widths[i];
+
+                    memset(dst_y_0, 0, MAX_LINE * 2 + 64);
+                    memset(dst_y_1, 0, MAX_LINE * 2 + 64);
+                    call_ref(dst_y_0, src, NULL, NULL, w,
+                             (uint32_t *)ctx->input_rgb2yuv_table);
+                    call_new(dst_y_1, src, NULL, NULL, w,
+                             (uint32_t *)ctx->input_rgb2yuv_table);
+                    if (memcmp(dst_y_0, dst_y_1, w * 2))
+                        fail();
+                }
+                bench_new(dst_y_1, src, NULL, NULL, MAX_LINE,
+                          (uint32_t *)ctx->input_rgb2yuv_table);
+            }
+        }
+
+        {
+            declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                         const uint8_t *src1, const uint8_t *src2,
+                         const uint8_t *src3, int width, uint32_t *pal);
+
+            if (check_func(ctx->chrToYV12, "%sToUV", name)) {
+                for (i = 0; i < FF_ARRAY_ELEMS(line_widths); i++) {
+                    int w = line_widths[i];
+
+                    memset(dst_u_0, 0, MAX_LINE * 2 + 64);
+                    memset(dst_u_1, 0, MAX_LINE * 2 + 64);
+                    memset(dst_v_0, 0, MAX_LINE * 2 + 64);
+                    memset(dst_v_1, 0, MAX_LINE * 2 + 64);
+                    call_ref(dst_u_0, dst_v_0, NULL, src, src, w,
+                             (uint32_t *)ctx->input_rgb2yuv_table);
+                    call_new(dst_u_1, dst_v_1, NULL, src, src, w,
+                             (uint32_t *)ctx->input_rgb2yuv_table);
+                    if (memcmp(dst_u_0, dst_u_1, w * 2) ||
+                        memcmp(dst_v_0, dst_v_1, w * 2))
+                        fail();
+                }
+                bench_new(dst_u_1, dst_v_1, NULL, src, src, MAX_LINE,
+                          (uint32_t *)ctx->input_rgb2yuv_table);
+            }
+        }
+        sws_freeContext(ctx);
+    }
+}
+
+static void check_nv12_to_uv(void)
+{
+    static const enum AVPixelFormat formats[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_NV21 };
+    LOCAL_ALIGNED_32(uint8_t, src, [MAX_LINE * 2 + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_0, [MAX_LINE + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_u_1, [MAX_LINE + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_0, [MAX_LINE + 64]);
+    LOCAL_ALIGNED_32(uint8_t, dst_v_1, [MAX_LINE + 64]);
+    int i, f;
+
+    declare_func(void, uint8_t *dstU, uint8_t *dstV,
+                 const uint8_t *src1, const uint8_t *src2,
+                 const uint8_t *src3, int width, uint32_t *pal);
+
+    randomize_buffers(src, MAX_LINE * 2 + 64);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        struct SwsContext *ctx = sws_getContext(MAX_LINE * 2, 2, formats[f],
+                                                MAX_LINE, 2, AV_PIX_FMT_YUV420P,
+                                                SWS_BILINEAR, NULL, NULL, NULL);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+
+        if (check_func(ctx->chrToYV12, "%sToUV", av_get_pix_fmt_name(formats[f]))) {
+            for (i = 0; i < FF_ARRAY_ELEMS(line_widths); i++) {
+                int w = line_widths[i];
+
+                memset(dst_u_0, 0, MAX_LINE + 64);
+                memset(dst_u_1, 0, MAX_LINE + 64);
+                memset(dst_v_0, 0, MAX_LINE + 64);
+                memset(dst_v_1, 0, MAX_LINE + 64);
+                call_ref(dst_u_0, dst_v_0, NULL, src, src, w, NULL);
+                call_new(dst_u_1, dst_v_1, NULL, src, src, w, NULL);
+                if (memcmp(dst_u_0, dst_u_1, w) ||
+                    memcmp(dst_v_0, dst_v_1, w))
+                    fail();
+            }
+            bench_new(dst_u_1, dst_v_1, NULL, src, src, MAX_LINE, NULL);
+        }
+        sws_freeContext(ctx);
+    }
+}
+
+#define YUV2RGB_HEIGHT 4
+
+/* The MMX yuv2rgb converters use a lower precision than the table based C
+ * code, so they are only checked to stay close to it. The later SIMD
+ * versions use the same arithmetic as MMX and must match it exactly. */
+#define YUV2RGB_MAX_DIFF_C 3
+
+static void check_yuv2rgb(void)
+{
+    static const enum AVPixelFormat formats[] = {
+        AV_PIX_FMT_RGB32, AV_PIX_FMT_BGR32, AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+    };
+    static const int widths[] = { 32, 72, 100, 256 };
+    /* the C converters, from the first run without any cpu flags */
+    static SwsFunc c_funcs[4][4];
+    LOCAL_ALIGNED_32(uint8_t, src_y, [MAX_LINE * YUV2RGB_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, src_u, [MAX_LINE / 2 * YUV2RGB_HEIGHT / 2]);
+    LOCAL_ALIGNED_32(uint8_t, src_v, [MAX_LINE / 2 * YUV2RGB_HEIGHT / 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [(MAX_LINE + 32) * 4 * YUV2RGB_HEIGHT]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [(MAX_LINE + 32) * 4 * YUV2RGB_HEIGHT]);
+    const uint8_t *src[4] = { src_y, src_u, src_v, NULL };
+    int src_stride[4] = { MAX_LINE, MAX_LINE / 2, MAX_LINE / 2, 0 };
+    int dst_stride[4] = { (MAX_LINE + 32) * 4, 0, 0, 0 };
+    uint8_t *dst_0[4] = { dst0, NULL, NULL, NULL };
+    uint8_t *dst_1[4] = { dst1, NULL, NULL, NULL };
+    int log_level = av_log_get_level();
+    int i, f, x, y;
+
+    declare_func_emms(AV_CPU_FLAG_MMX, int, SwsContext *c, const uint8_t *src[],
+                      int srcStride[], int srcSliceY, int srcSliceH,
+                      uint8_t *dst[], int dstStride[]);
+
+    randomize_buffers(src_y, MAX_LINE * YUV2RGB_HEIGHT);
+    randomize_buffers(src_u, MAX_LINE / 2 * YUV2RGB_HEIGHT / 2);
+    randomize_buffers(src_v, MAX_LINE / 2 * YUV2RGB_HEIGHT / 2);
+
+    /* the C reference warns about the missing accelerated converter */
+    av_log_set_level(AV_LOG_ERROR);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        int bpp = av_get_bits_per_pixel(av_pix_fmt_desc_get(formats[f])) >> 3;
+
+        for (i = 0; i < FF_ARRAY_ELEMS(widths); i++) {
+            int w = widths[i];
+            struct SwsContext *ctx = sws_getContext(w, YUV2RGB_HEIGHT, AV_PIX_FMT_YUV420P,
+                                                    w, YUV2RGB_HEIGHT, formats[f],
+                                                    SWS_BILINEAR, NULL, NULL, NULL);
+            if (!ctx) {
+                fail();
+                continue;
+            }
+
+            if (!av_get_cpu_flags())
+                c_funcs[f][i] = ctx->swscale;
+
+            if (check_func(ctx->swscale, "yuv420_%s_%d",
+                           av_get_pix_fmt_name(formats[f]), w)) {
+                int max_diff = func_ref == c_funcs[f][i] ? YUV2RGB_MAX_DIFF_C : 0;
+
+                memset(dst0, 0, dst_stride[0] * YUV2RGB_HEIGHT);
+                memset(dst1, 0, dst_stride[0] * YUV2RGB_HEIGHT);
+                call_ref(ctx, src, src_stride, 0, YUV2RGB_HEIGHT, dst_0, dst_stride);
+                call_new(ctx, src, src_stride, 0, YUV2RGB_HEIGHT, dst_1, dst_stride);
+                for (y = 0; y < YUV2RGB_HEIGHT; y++) {
+                    const uint8_t *ref = dst0 + y * dst_stride[0];
+                    const uint8_t *new = dst1 + y * dst_stride[0];
+
+                    for (x = 0; x < w * bpp; x++) {
+                        if (FFABS(ref[x] - new[x]) > max_diff) {
+                            fail();
+                            y = YUV2RGB_HEIGHT;
+                            break;
+                        }
+                    }
+                }
+                bench_new(ctx, src, src_stride, 0, YUV2RGB_HEIGHT, dst_1, dst_stride);
+            }
+            sws_freeContext(ctx);
+        }
+    }
+    av_log_set_level(log_level);
+}
+
 void checkasm_check_sw_rgb(void)
 {
     ff_sws_rgb2rgb_init();
@@ -132,4 +350,13 @@ void checkasm_check_sw_rgb(void)
 
     check_uyvy_to_422p();
     report("uyvytoyuv422");
+
+    check_rgb_to_yuv();
+    report("rgb_to_yuv");
+
+    check_nv12_to_uv();
+    report("nv12_to_uv");
+
+    check_yuv2rgb();
+    report("yuv2rgb");
 }
@@ -0,0 +1,260 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+#include "checkasm.h"
+
+#define randomize_buffers(buf, size)      \
+    do {                                  \
+        int j;                            \
+        for (j = 0; j < size; j+=4)       \
+            AV_WN32(buf + j, rnd());      \
+    } while (0)
+
+#define SRC_W       512
+#define DST_W       200
+#define DST_W_PAD   (DST_W + 16)
+/* the widths checked, the SIMD versions must handle the tail */
+static const int dst_widths[] = { DST_W, DST_W - 3 };
+#define MAX_FILTER  40
+#define MAX_LINES   16
+
+/* random filter with negative taps, normalized to sum up to 1 << bits */
+static void init_filter(int16_t *filter, int size, int bits)
+{
+    int range = (1 << (bits - 3)) / FFMAX(1, size / 8);
+    int sum = 0, j;
+
+    for (j = 0; j < size; j++) {
+        filter[j] = (int)(rnd() % (2 * range + 1)) - range;
+        sum      += filter[j];
+    }
+    filter[rnd() % size] += (1 << bits) - sum;
+}
+
+static void check_hscale(void)
+{
+    static const int filter_sizes[] = { 4, 8, 12, 16, 32, 40 };
+    static const struct {
+        enum AVPixelFormat src_fmt, dst_fmt;
+    } fmts[] = {
+        { AV_PIX_FMT_YUV420P,    AV_PIX_FMT_YUV420P   },
+        { AV_PIX_FMT_YUV420P10,  AV_PIX_FMT_YUV420P   },
+        { AV_PIX_FMT_YUV420P16,  AV_PIX_FMT_YUV420P   },
+        { AV_PIX_FMT_YUV420P,    AV_PIX_FMT_YUV420P16 },
+        { AV_PIX_FMT_YUV420P10,  AV_PIX_FMT_YUV420P16 },
+        { AV_PIX_FMT_YUV420P12,  AV_PIX_FMT_YUV420P16 },
+        { AV_PIX_FMT_YUV420P16,  AV_PIX_FMT_YUV420P16 },
+    };
+    LOCAL_ALIGNED_32(uint16_t, src, [SRC_W + MAX_FILTER]);
+    LOCAL_ALIGNED_32(int32_t,  dst0, [DST_W_PAD]);
+    LOCAL_ALIGNED_32(int32_t,  dst1, [DST_W_PAD]);
+    LOCAL_ALIGNED_32(int16_t,  filter, [DST_W_PAD * MAX_FILTER]);
+    LOCAL_ALIGNED_32(int32_t,  filter_pos, [DST_W_PAD]);
+    int i, f, s, w;
+
+    declare_func(void, SwsContext *c, int16_t *dst, int dstW,
+                 const uint8_t *src, const int16_t *filter,
+                 const int32_t *filterPos, int filterSize);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmts[f].src_fmt);
+        struct SwsContext *ctx = sws_getContext(SRC_W, 16, fmts[f].src_fmt,
+                                                DST_W, 16, fmts[f].dst_fmt,
+                                                SWS_BICUBIC | SWS_ACCURATE_RND,
+                                                NULL, NULL, NULL);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+
+        for (i = 0; i < SRC_W + MAX_FILTER; i++)
+            src[i] = rnd() & ((1 << desc->comp[0].depth) - 1);
+
+        for (s = 0; s < FF_ARRAY_ELEMS(filter_sizes); s++) {
+            int size = filter_sizes[s];
+
+            ctx->hLumFilterSize = size;
+            ff_getSwsFunc(ctx);
+
+            for (w = 0; w < FF_ARRAY_ELEMS(dst_widths); w++) {
+                int width = dst_widths[w];
+
+                for (i = 0; i < width; i++) {
+                    filter_pos[i] = rnd() % (SRC_W - size + 1);
+                    init_filter(filter + i * size, size, 14);
+                }
+                /* padded like initFilter() does */
+                for (; i < DST_W_PAD; i++) {
+                    filter_pos[i] = filter_pos[width - 1];
+                    memcpy(filter + i * size, filter + (width - 1) * size,
+                           size * sizeof(*filter));
+                }
+
+                if (check_func(ctx->hyScale, "hscale%dto%d_%d_w%d", ctx->srcBpc,
+                               ctx->dstBpc <= 14 ? 15 : 19, size, width)) {
+                    int bytes = width * (ctx->dstBpc <= 14 ? 2 : 4);
+
+                    memset(dst0, 0, sizeof(*dst0) * DST_W_PAD);
+                    memset(dst1, 0, sizeof(*dst1) * DST_W_PAD);
+                    call_ref(ctx, (int16_t *)dst0, width, (const uint8_t *)src,
+                             filter, filter_pos, size);
+                    call_new(ctx, (int16_t *)dst1, width, (const uint8_t *)src,
+                             filter, filter_pos, size);
+                    if (memcmp(dst0, dst1, bytes))
+                        fail();
+                    bench_new(ctx, (int16_t *)dst1, width, (const uint8_t *)src,
+                              filter, filter_pos, size);
+                }
+            }
+        }
+        sws_freeContext(ctx);
+    }
+    report("hscale");
+}
+
+static void check_yuv2planeX(void)
+{
+    static const int filter_sizes[] = { 2, 4, 6, 8, 16 };
+    LOCAL_ALIGNED_32(int16_t, src, [MAX_LINES], [DST_W_PAD]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_W_PAD]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_W_PAD]);
+    LOCAL_ALIGNED_32(int16_t, filter, [MAX_LINES]);
+    const int16_t *lines[MAX_LINES];
+    uint8_t dither[8];
+    struct SwsContext *ctx;
+    int i, s, w, offset;
+
+    declare_func(void, const int16_t *filter, int filterSize,
+                 const int16_t **src, uint8_t *dest, int dstW,
+                 const uint8_t *dither, int offset);
+
+    ctx = sws_getContext(2 * DST_W, 16, AV_PIX_FMT_YUV420P,
+                         DST_W, 16, AV_PIX_FMT_YUV420P,
+                         SWS_BICUBIC | SWS_ACCURATE_RND, NULL, NULL, NULL);
+    if (!ctx) {
+        fail();
+        return;
+    }
+
+    for (i = 0; i < MAX_LINES; i++) {
+        randomize_buffers((uint8_t *)src[i], DST_W_PAD * 2);
+        lines[i] = src[i];
+    }
+    randomize_buffers(dither, 8);
+
+    for (s = 0; s < FF_ARRAY_ELEMS(filter_sizes); s++) {
+        int size = filter_sizes[s];
+
+        init_filter(filter, size, 12);
+        for (w = 0; w < FF_ARRAY_ELEMS(dst_widths); w++) {
+            int width = dst_widths[w];
+
+            for (offset = 0; offset <= 3; offset += 3) {
+                if (check_func(ctx->yuv2planeX, "yuv2planeX_8_%d_%d_w%d",
+                               size, offset, width)) {
+                    memset(dst0, 0, DST_W_PAD);
+                    memset(dst1, 0, DST_W_PAD);
+                    call_ref(filter, size, lines, dst0, width, dither, offset);
+                    call_new(filter, size, lines, dst1, width, dither, offset);
+                    if (memcmp(dst0, dst1, width))
+                        fail();
+                    bench_new(filter, size, lines, dst1, width, dither, offset);
+                }
+            }
+        }
+    }
+    sws_freeContext(ctx);
+    report("yuv2planeX");
+}
+
+static void check_yuv2nv12cX(void)
+{
+    static const int filter_sizes[] = { 1, 2, 3, 4, 8, 16 };
+    static const enum AVPixelFormat fmts[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_NV21 };
+    LOCAL_ALIGNED_32(int16_t, src_u, [MAX_LINES], [DST_W_PAD]);
+    LOCAL_ALIGNED_32(int16_t, src_v, [MAX_LINES], [DST_W_PAD]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_W_PAD * 2]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_W_PAD * 2]);
+    LOCAL_ALIGNED_32(int16_t, filter, [MAX_LINES]);
+    const int16_t *lines_u[MAX_LINES], *lines_v[MAX_LINES];
+    uint8_t dither[8];
+    int i, f, s, w;
+
+    declare_func(void, SwsContext *c, const int16_t *chrFilter,
+                 int chrFilterSize, const int16_t **chrUSrc,
+                 const int16_t **chrVSrc, uint8_t *dest, int chrDstW);
+
+    for (i = 0; i < MAX_LINES; i++) {
+        randomize_buffers((uint8_t *)src_u[i], DST_W_PAD * 2);
+        randomize_buffers((uint8_t *)src_v[i], DST_W_PAD * 2);
+        lines_u[i] = src_u[i];
+        lines_v[i] = src_v[i];
+    }
+    randomize_buffers(dither, 8);
+
+    for (f = 0; f < FF_ARRAY_ELEMS(fmts); f++) {
+        struct SwsContext *ctx = sws_getContext(4 * DST_W, 16, AV_PIX_FMT_YUV420P,
+                                                2 * DST_W, 16, fmts[f],
+                                                SWS_BICUBIC | SWS_ACCURATE_RND,
+                                                NULL, NULL, NULL);
+        if (!ctx) {
+            fail();
+            continue;
+        }
+        ctx->chrDither8 = dither;
+
+        for (s = 0; s < FF_ARRAY_ELEMS(filter_sizes); s++) {
+            int size = filter_sizes[s];
+
+            init_filter(filter, size, 12);
+            for (w = 0; w < FF_ARRAY_ELEMS(dst_widths); w++) {
+                int width = dst_widths[w];
+
+                if (check_func(ctx->yuv2nv12cX, "yuv2%scX_%d_w%d",
+                               av_get_pix_fmt_name(fmts[f]), size, width)) {
+                    memset(dst0, 0, DST_W_PAD * 2);
+                    memset(dst1, 0, DST_W_PAD * 2);
+                    call_ref(ctx, filter, size, lines_u, lines_v, dst0, width);
+                    call_new(ctx, filter, size, lines_u, lines_v, dst1, width);
+                    if (memcmp(dst0, dst1, width * 2))
+                        fail();
+                    bench_new(ctx, filter, size, lines_u, lines_v, dst1, width);
+                }
+            }
+        }
+        sws_freeContext(ctx);
+    }
+    report("yuv2nv12cX");
+}
+
+void checkasm_check_sw_scale(void)
+{
+    check_hscale();
+    check_yuv2planeX();
+    check_yuv2nv12cX();
+}
@@ -102,6 +102,38 @@ probeframes(){
     run ffprobe${PROGSUF}${EXECSUF} -show_frames -v 0 "$@"
 }
 
+probefast(){
+    streamfile1="${outdir}/${test}.streams"
+    streamfile2="${outdir}/${test}.fast.streams"
+    cleanfiles="$cleanfiles $streamfile1 $streamfile2"
+    run ffprobe${PROGSUF}${EXECSUF} -bitexact -show_streams -v 0 "$@" > "$streamfile1"
+    run ffprobe${PROGSUF}${EXECSUF} -bitexact -show_streams -fast_probe -v 0 "$@" > "$streamfile2"
+    diff "$streamfile1" "$streamfile2" || true
+}
+
+probeparse(){
+    entries="frame=media_type,stream_index,key_frame,pkt_pts,pkt_duration,pkt_size,pict_type,width,height,pix_fmt,nb_samples,channels"
+    decfile="${outdir}/${test}.dec"
+    parsefile="${outdir}/${test}.parse"
+    cleanfiles="$cleanfiles $decfile $parsefile"
+    # the decoders delay the frames, so compare each stream on its own
+    for stream in v a; do
+        run ffprobe${PROGSUF}${EXECSUF} -bitexact -of csv=p=0 -select_streams $stream -show_entries $entries -v 0 "$@" | grep -v '^$' > "$decfile"
+        run ffprobe${PROGSUF}${EXECSUF} -bitexact -of csv=p=0 -select_streams $stream -show_entries $entries -parse_frames -v 0 "$@" | grep -v '^$' > "$parsefile"
+        cat "$parsefile"
+        diff "$decfile" "$parsefile" || true
+    done
+}
+
+probebatch(){
+    listfile="${outdir}/${test}.list"
+    cleanfiles="$cleanfiles $listfile"
+    for file in "$@"; do
+        echo "$file"
+    done > "$listfile"
+    run ffprobe${PROGSUF}${EXECSUF} -bitexact -show_error -show_entries stream=index,codec_name -v 0 -batch "$listfile" || true
+}
+
 probechapters(){
     run ffprobe${PROGSUF}${EXECSUF} -show_chapters -v 0 "$@"
 }
@@ -135,6 +167,24 @@ framecrc(){
     ffmpeg "$@" -bitexact -f framecrc -
 }
 
+graph_threads(){
+    serialfile="${outdir}/${test}.serial"
+    threadfile="${outdir}/${test}.threaded"
+    cleanfiles="$cleanfiles $serialfile $threadfile"
+    framecrc -filter_complex_threads 1 "$@" > "$serialfile" || return
+    framecrc -filter_complex_threads 4 -filter_complex_thread_type slice+graph "$@" > "$threadfile" || return
+    diff "$serialfile" "$threadfile" && cat "$threadfile"
+}
+
+filter_threads(){
+    serialfile="${outdir}/${test}.serial"
+    threadfile="${outdir}/${test}.threaded"
+    cleanfiles="$cleanfiles $serialfile $threadfile"
+    framecrc -filter_threads 1 "$@" > "$serialfile" || return
+    framecrc -filter_threads 4 "$@" > "$threadfile" || return
+    diff "$serialfile" "$threadfile" && cat "$threadfile"
+}
+
 ffmetadata(){
     ffmpeg "$@" -bitexact -f ffmetadata -
 }
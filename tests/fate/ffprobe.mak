@@ -29,6 +29,22 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+# a missing input in the middle of the list is reported in its own section
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_batch
+fate-ffprobe_batch: $(FFPROBE_TEST_FILE)
+fate-ffprobe_batch: CMD = probebatch $(FFPROBE_TEST_FILE) tests/data/fate/ffprobe_batch.missing $(FFPROBE_TEST_FILE)
+
+# what -fast_probe infers differently from a full probe
+FATE_FFPROBE_FAST-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-ffprobe_fast_probe
+fate-ffprobe_fast_probe: fate-lavf-ts
+fate-ffprobe_fast_probe: CMD = probefast $(TARGET_PATH)/tests/data/lavf/lavf.ts
+# -parse_frames must describe the frames as the decoders do
+FATE_FFPROBE_PARSE-$(call ENCDEC2, MPEG2VIDEO, MP2, MPEGTS) += fate-ffprobe_parse_frames
+fate-ffprobe_parse_frames: fate-lavf-ts
+fate-ffprobe_parse_frames: CMD = probeparse $(TARGET_PATH)/tests/data/lavf/lavf.ts
+
+FATE_FFPROBE-$(CONFIG_FFMPEG) += $(FATE_FFPROBE_FAST-yes) $(FATE_FFPROBE_PARSE-yes)
+
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
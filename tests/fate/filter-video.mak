@@ -207,6 +207,10 @@ FATE_FILTER_VSYNTH-$(CONFIG_VSTACK_FILTER) += fate-filter-vstack
 fate-filter-vstack: tests/data/filtergraphs/vstack
 fate-filter-vstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/vstack
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER AVGBLUR_FILTER NEGATE_FILTER UNSHARP_FILTER LUTYUV_FILTER HSTACK_FILTER VSTACK_FILTER) += fate-filter-graph-threads
+fate-filter-graph-threads: tests/data/filtergraphs/graph_threads
+fate-filter-graph-threads: CMD = graph_threads -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/graph_threads
+
 FATE_FILTER_VSYNTH-$(CONFIG_OVERLAY_FILTER) += fate-filter-overlay
 fate-filter-overlay: tests/data/filtergraphs/overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay
@@ -482,6 +486,15 @@ FATE_FILTER_VSYNTH-$(CONFIG_SCALE2REF_FILTER) += fate-filter-scale2ref_keep_aspe
 fate-filter-scale2ref_keep_aspect: tests/data/filtergraphs/scale2ref_keep_aspect
 fate-filter-scale2ref_keep_aspect: CMD = framemd5 -frames:v 5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/scale2ref_keep_aspect -map "[main]"
 
+FATE_FILTER-$(call ALLYES, TESTSRC_FILTER FORMAT_FILTER MULTISCALE_FILTER) += fate-filter-multiscale
+fate-filter-multiscale: tests/data/filtergraphs/multiscale
+fate-filter-multiscale: CMD = framemd5 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/multiscale -map "[a]" -map "[b]" -map "[c]" -map "[d]"
+
+# the slice threaded scaler must give the same output as a single context
+FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale-threads
+fate-filter-scale-threads: tests/data/vsynth1.yuv
+fate-filter-scale-threads: CMD = filter_threads -flags bitexact -s 352x288 -pix_fmt yuv420p -i tests/data/vsynth1.yuv -frames:v 10 -pix_fmt yuv422p -sws_flags +bitexact+bicubic -vf scale=w=500:h=300
+
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scalechroma
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_v_chr_pos=33:out_h_chr_pos=151
@@ -799,6 +812,10 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER-yes += fate-drawutils
+fate-drawutils: libavfilter/tests/drawutils$(EXESUF)
+fate-drawutils: CMD = run libavfilter/tests/drawutils$(EXESUF)
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
@@ -2,6 +2,10 @@ FATE_LIBSWSCALE += fate-sws-pixdesc-query
 fate-sws-pixdesc-query: libswscale/tests/pixdesc_query$(EXESUF)
 fate-sws-pixdesc-query: CMD = run libswscale/tests/pixdesc_query$(EXESUF)
 
+FATE_LIBSWSCALE-$(HAVE_THREADS) += fate-sws-threads
+fate-sws-threads: libswscale/tests/threads$(EXESUF)
+fate-sws-threads: CMD = run libswscale/tests/threads$(EXESUF)
+
 FATE_LIBSWSCALE += $(FATE_LIBSWSCALE-yes)
 FATE-$(CONFIG_SWSCALE) += $(FATE_LIBSWSCALE)
 fate-libswscale: $(FATE_LIBSWSCALE)
@@ -0,0 +1,29 @@
+SACCUBUS_STUB = tools/saccubus_stub$(SLIBSUF)
+
+FATE_SACCUBUS-$(call ALLYES, SACCUBUS_INDEV NUT_DEMUXER RAWVIDEO_DECODER PCM_S16LE_DECODER) += fate-saccubus-indev
+fate-saccubus-indev: tests/data/ffprobe-test.nut $(SACCUBUS_STUB)
+fate-saccubus-indev: CMD = framecrc -sacc "$(TARGET_PATH)/tests/data/ffprobe-test.nut\#mode=comments\#format=overlay" -minfps 50 -f saccubus -i $(TARGET_PATH)/$(SACCUBUS_STUB)
+
+# the adapter seeks from SaccProcess and then reports an unchanged target
+FATE_SACCUBUS-$(call ALLYES, SACCUBUS_INDEV NUT_DEMUXER RAWVIDEO_DECODER PCM_S16LE_DECODER) += fate-saccubus-indev-seek-overlay fate-saccubus-indev-seek-yuv420p
+fate-saccubus-indev-seek-%: tests/data/ffprobe-test.nut $(SACCUBUS_STUB)
+fate-saccubus-indev-seek-%: CMD = framecrc -sacc "$(TARGET_PATH)/tests/data/ffprobe-test.nut\#mode=comments\#format=$(@:fate-saccubus-indev-seek-%=%)\#seek=0.05" -minfps 50 -f saccubus -i $(TARGET_PATH)/$(SACCUBUS_STUB)
+
+FATE_SACCUBUS-$(call ALLYES, SACCUBUS_FILTER LAVFI_INDEV TESTSRC_FILTER) += fate-saccubus-filter
+fate-saccubus-filter: $(SACCUBUS_STUB)
+fate-saccubus-filter: CMD = framecrc -f lavfi -i testsrc=s=64x48:r=10:d=1 -vf "saccubus=adapter=$(TARGET_PATH)/$(SACCUBUS_STUB):args=mode=comments\#format=overlay"
+
+# a toolbox v2 style plugin drawing over its previous output
+FATE_SACCUBUS-$(call ALLYES, SACCUBUS_FILTER LAVFI_INDEV TESTSRC_FILTER) += fate-saccubus-filter-legacy
+fate-saccubus-filter-legacy: $(SACCUBUS_STUB)
+fate-saccubus-filter-legacy: CMD = framecrc -f lavfi -i testsrc=s=64x48:r=10:d=1 -vf "saccubus=adapter=$(TARGET_PATH)/$(SACCUBUS_STUB):args=mode=trail"
+
+FATE_FFMPEG += $(FATE_SACCUBUS-yes)
+
+FATE_SACCUBUS_BENCH-$(call ALLYES, SACCUBUS_INDEV NUT_MUXER NUT_DEMUXER RAWVIDEO_DECODER) += fate-saccubus-bench
+fate-saccubus-bench: tools/saccubus_bench$(EXESUF) $(SACCUBUS_STUB)
+fate-saccubus-bench: CMD = run tools/saccubus_bench$(EXESUF) -s 64x48 -r 10 -t 1 -a "mode=comments\#format=yuv420p" $(TARGET_PATH)/$(SACCUBUS_STUB) | grep "^generating\|^frames"
+
+FATE += $(FATE_SACCUBUS_BENCH-yes)
+
+fate-saccubus: $(FATE_SACCUBUS-yes) $(FATE_SACCUBUS_BENCH-yes)
@@ -0,0 +1,255 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Run the saccubus input device over a generated (or given) source and
+ * report the time spent in each stage, the throughput and the peak memory.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_GETRUSAGE
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavdevice/avdevice.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [options] adapter\n", argv0);
+    fprintf(stderr, "  -i <input>    source video (default: generate one)\n");
+    fprintf(stderr, "  -s <size>     size of the generated source (default: 1280x720)\n");
+    fprintf(stderr, "  -r <rate>     frame rate of the generated source (default: 30)\n");
+    fprintf(stderr, "  -t <seconds>  duration of the generated source (default: 10)\n");
+    fprintf(stderr, "  -a <args>     '#'-separated adapter arguments (default: mode=comments)\n");
+    fprintf(stderr, "  -o <options>  saccubus device options, key=value:key=value\n");
+    fprintf(stderr, "  -k            keep the generated source\n");
+    return ret;
+}
+
+static int64_t getmaxrss(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+    getrusage(RUSAGE_SELF, &rusage);
+    return (int64_t)rusage.ru_maxrss * 1024;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Write a rawvideo nut file with a moving pattern, so that decoding is cheap
+ * and the numbers are dominated by the device and the adapter.
+ */
+static int generate_source(const char *filename, int w, int h, AVRational rate, int nb_frames)
+{
+    AVFormatContext *oc = NULL;
+    AVStream *st;
+    AVPacket pkt;
+    uint8_t *data[4];
+    int linesize[4];
+    int size, ret, i, x, y;
+
+    if ((ret = avformat_alloc_output_context2(&oc, NULL, "nut", filename)) < 0)
+        return ret;
+    if (!(st = avformat_new_stream(oc, NULL))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    st->time_base            = av_inv_q(rate);
+    st->avg_frame_rate       = rate;
+    st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    st->codecpar->codec_id   = AV_CODEC_ID_RAWVIDEO;
+    st->codecpar->codec_tag  = avcodec_pix_fmt_to_codec_tag(AV_PIX_FMT_YUV420P);
+    st->codecpar->format     = AV_PIX_FMT_YUV420P;
+    st->codecpar->width      = w;
+    st->codecpar->height     = h;
+    if ((ret = avio_open(&oc->pb, filename, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    size = av_image_get_buffer_size(AV_PIX_FMT_YUV420P, w, h, 1);
+    for (i = 0; i < nb_frames; i++) {
+        av_init_packet(&pkt);
+        if ((ret = av_new_packet(&pkt, size)) < 0)
+            goto end;
+        av_image_fill_arrays(data, linesize, pkt.data, AV_PIX_FMT_YUV420P, w, h, 1);
+        for (y = 0; y < h; y++)
+            for (x = 0; x < w; x++)
+                data[0][y * linesize[0] + x] = 16 + ((x + y + 4 * i) & 0xff) * 219 / 255;
+        for (y = 0; y < (h + 1) / 2; y++) {
+            memset(data[1] + y * linesize[1], 128 + (y + i) % 64 - 32, linesize[1]);
+            memset(data[2] + y * linesize[2], 128 - (y + i) % 64 + 32, linesize[2]);
+        }
+        pkt.stream_index = st->index;
+        pkt.pts = pkt.dts = av_rescale_q(i, av_inv_q(rate), st->time_base);
+        pkt.duration = av_rescale_q(1, av_inv_q(rate), st->time_base);
+        pkt.flags |= AV_PKT_FLAG_KEY;
+        if ((ret = av_interleaved_write_frame(oc, &pkt)) < 0)
+            goto end;
+    }
+    ret = av_write_trailer(oc);
+end:
+    if (oc)
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    return ret;
+}
+
+static void print_stage(const char *name, int64_t us, int64_t frames)
+{
+    printf("%-8s %10.3f ms total %8.3f ms/frame\n", name,
+           us / 1000.0, frames ? us / 1000.0 / frames : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL, *adapter = NULL, *adapter_args = "mode=comments";
+    const char *generated = "saccubus_bench.nut";
+    int w = 1280, h = 720, keep = 0, ret, i;
+    double duration = 10;
+    AVRational rate = { 30, 1 };
+    AVInputFormat *ifmt;
+    AVFormatContext *ic = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    char *sacc = NULL;
+    int64_t frames = 0, bytes = 0, start, elapsed;
+    int64_t decode = 0, scale = 0, process = 0, layout = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            input = argv[++i];
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            if (av_parse_video_size(&w, &h, argv[++i]) < 0) {
+                fprintf(stderr, "Invalid size %s\n", argv[i]);
+                return usage(argv[0], 1);
+            }
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            if (av_parse_video_rate(&rate, argv[++i]) < 0) {
+                fprintf(stderr, "Invalid rate %s\n", argv[i]);
+                return usage(argv[0], 1);
+            }
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+            adapter_args = argv[++i];
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            if (av_dict_parse_string(&opts, argv[++i], "=", ":", 0) < 0) {
+                fprintf(stderr, "Cannot parse option string %s\n", argv[i]);
+                return usage(argv[0], 1);
+            }
+        } else if (!strcmp(argv[i], "-k")) {
+            keep = 1;
+        } else if (!adapter) {
+            adapter = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!adapter)
+        return usage(argv[0], 1);
+
+    avdevice_register_all();
+    if (!(ifmt = av_find_input_format("saccubus"))) {
+        fprintf(stderr, "The saccubus input device is not available\n");
+        return 1;
+    }
+
+    if (!input) {
+        const int nb_frames = FFMAX(1, duration * av_q2d(rate));
+        printf("generating %dx%d %d/%d fps, %d frames\n", w, h, rate.num, rate.den, nb_frames);
+        if ((ret = generate_source(generated, w, h, rate, nb_frames)) < 0) {
+            fprintf(stderr, "Unable to generate %s: %s\n", generated, av_err2str(ret));
+            return 1;
+        }
+        input = generated;
+    }
+
+    /* the source is the first adapter argument, as with ffmpeg -sacc */
+    sacc = av_asprintf("%s#%s", input, adapter_args);
+    if (!sacc) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    av_dict_set(&opts, "sacc", sacc, 0);
+    av_dict_set(&opts, "bench", "1", 0);
+
+    start = av_gettime_relative();
+    if ((ret = avformat_open_input(&ic, adapter, ifmt, &opts)) < 0) {
+        fprintf(stderr, "Unable to open %s: %s\n", adapter, av_err2str(ret));
+        goto end;
+    }
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        if (ic->streams[pkt.stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            frames++;
+            bytes += pkt.size;
+        }
+        av_packet_unref(&pkt);
+    }
+    elapsed = av_gettime_relative() - start;
+    if (ret != AVERROR_EOF) {
+        fprintf(stderr, "Error reading packets: %s\n", av_err2str(ret));
+        goto end;
+    }
+    if (!frames) {
+        fprintf(stderr, "No video frames were produced\n");
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    ret = 0;
+
+    av_opt_get_int(ic, "bench_decode",  AV_OPT_SEARCH_CHILDREN, &decode);
+    av_opt_get_int(ic, "bench_scale",   AV_OPT_SEARCH_CHILDREN, &scale);
+    av_opt_get_int(ic, "bench_process", AV_OPT_SEARCH_CHILDREN, &process);
+    av_opt_get_int(ic, "bench_layout",  AV_OPT_SEARCH_CHILDREN, &layout);
+
+    printf("frames   %10"PRId64" (%dx%d, %.1f MiB)\n", frames,
+           ic->streams[0]->codecpar->width, ic->streams[0]->codecpar->height,
+           bytes / (1024.0 * 1024.0));
+    printf("elapsed  %10.3f s    %10.2f fps\n", elapsed / 1000000.0,
+           elapsed ? frames * 1000000.0 / elapsed : 0.0);
+    print_stage("decode",  decode,  frames);
+    print_stage("scale",   scale,   frames);
+    print_stage("process", process, frames);
+    print_stage("layout",  layout,  frames);
+    printf("maxrss   %10"PRId64" kB\n", getmaxrss() / 1024);
+
+end:
+    avformat_close_input(&ic);
+    av_dict_free(&opts);
+    av_free(sacc);
+    if (input == generated && !keep)
+        remove(generated);
+    return ret < 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Reference saccubus adapter used by saccubus_bench and for testing the
+ * saccubus input device and filter.
+ *
+ * Arguments (after the adapter path):
+ *   <video>             file to load; omit it when used as a filter
+ *   mode=noop|fill|comments|trail
+ *                       copy the video only, paint a solid color, draw
+ *                       synthetic scrolling comments over the video, or
+ *                       draw the comments over the previous output
+ *   format=rgb32|yuv420p|nv12|overlay
+ *                       surface format requested from the device
+ *   comments=<n>        number of comments on screen in comments mode
+ *   reentrant           allow SaccProcess to run on several threads
+ *   seek=<t>            once a repeated video frame at or after t seconds
+ *                       is shown, seek back to the start from SaccProcess
+ *                       and report the target as unchanged
+ *
+ * Everything is computed from vpos alone, so the output does not depend on
+ * the order of the calls.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SACC_DLL_EXPORT
+#include "compat/saccubus/saccubus_adapter.h"
+
+enum StubMode {
+    MODE_NOOP,
+    MODE_FILL,
+    MODE_COMMENTS,
+    MODE_TRAIL,
+};
+
+typedef struct StubContext {
+    enum StubMode mode;
+    int nb_comments;
+    double seek_at;
+} StubContext;
+
+#define COMMENT_HEIGHT 24
+#define COMMENT_SECONDS 4.0
+
+static const uint32_t palette[] = {
+    0xffffffff, 0xffff0000, 0xff00ff00, 0xff0000ff,
+    0xffffff00, 0xff00ffff, 0xffff00ff, 0xffffa500,
+};
+
+static void rgb_to_yuv(uint32_t argb, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+    const int r = (argb >> 16) & 0xff, g = (argb >> 8) & 0xff, b = argb & 0xff;
+
+    *y = (( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16;
+    *u = ((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+    *v = ((112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+}
+
+static void fill_rect(SaccFrame *f, int x0, int y0, int x1, int y1, uint32_t argb)
+{
+    uint8_t cy, cu, cv;
+    int x, y;
+
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > f->w ? f->w : x1;
+    y1 = y1 > f->h ? f->h : y1;
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    switch (f->format) {
+    case SACC_SURFACE_RGB32:
+    case SACC_SURFACE_RGBA_OVERLAY:
+        /* the overlay layer is premultiplied; the palette is opaque or zero */
+        for (y = y0; y < y1; y++) {
+            uint32_t *line = (uint32_t *)((uint8_t *)f->planes[0] + y * f->linesizes[0]);
+            for (x = x0; x < x1; x++)
+                line[x] = argb;
+        }
+        break;
+    case SACC_SURFACE_YUV420P:
+    case SACC_SURFACE_NV12:
+        rgb_to_yuv(argb, &cy, &cu, &cv);
+        for (y = y0; y < y1; y++)
+            memset((uint8_t *)f->planes[0] + y * f->linesizes[0] + x0, cy, x1 - x0);
+        x0 >>= 1; y0 >>= 1;
+        x1 = (x1 + 1) >> 1; y1 = (y1 + 1) >> 1;
+        for (y = y0; y < y1; y++) {
+            uint8_t *u = (uint8_t *)f->planes[1] + y * f->linesizes[1];
+            if (f->format == SACC_SURFACE_YUV420P) {
+                memset(u + x0, cu, x1 - x0);
+                memset((uint8_t *)f->planes[2] + y * f->linesizes[2] + x0, cv, x1 - x0);
+            } else {
+                for (x = x0; x < x1; x++) {
+                    u[2 * x    ] = cu;
+                    u[2 * x + 1] = cv;
+                }
+            }
+        }
+        break;
+    }
+}
+
+static void copy_video(SaccFrame *dst, const SaccFrame *src)
+{
+    const int nb_planes = dst->format == SACC_SURFACE_YUV420P ? 3 :
+                          dst->format == SACC_SURFACE_NV12    ? 2 : 1;
+    int i, y;
+
+    for (i = 0; i < nb_planes; i++) {
+        const int chroma = i > 0;
+        const int bytes  = dst->format == SACC_SURFACE_RGB32 ? dst->w * 4 :
+                           dst->format == SACC_SURFACE_NV12 && chroma ? (dst->w + 1) & ~1 :
+                           chroma ? (dst->w + 1) >> 1 : dst->w;
+        const int rows   = chroma ? (dst->h + 1) >> 1 : dst->h;
+        for (y = 0; y < rows; y++)
+            memcpy((uint8_t *)dst->planes[i] + y * dst->linesizes[i],
+                   (const uint8_t *)src->planes[i] + y * src->linesizes[i], bytes);
+    }
+}
+
+static void draw_comments(StubContext *s, SaccFrame *f)
+{
+    const int lanes = f->h / COMMENT_HEIGHT > 0 ? f->h / COMMENT_HEIGHT : 1;
+    int i;
+
+    for (i = 0; i < s->nb_comments; i++) {
+        /* comment i enters every COMMENT_SECONDS, staggered over the period */
+        const double start = COMMENT_SECONDS * i / s->nb_comments;
+        const double t     = f->vpos - start;
+        const int len      = 8 + (i * 7) % 24;
+        const int w        = len * COMMENT_HEIGHT / 2;
+        double phase;
+        int x, y, n;
+
+        if (t < 0)
+            continue;
+        phase = t / COMMENT_SECONDS - (int)(t / COMMENT_SECONDS);
+        x = f->w - (int)(phase * (f->w + w));
+        y = (i % lanes) * COMMENT_HEIGHT;
+        /* glyph-like blocks with gaps, so the coverage resembles text */
+        for (n = len; n > 0 && x < f->w; x += COMMENT_HEIGHT / 2, n--)
+            fill_rect(f, x + 1, y + 2, x + COMMENT_HEIGHT / 2 - 1, y + COMMENT_HEIGHT - 2,
+                      palette[i % (sizeof(palette) / sizeof(palette[0]))]);
+    }
+}
+
+int SaccConfigure(void **sacc, SaccToolBox *box, int argc, char *argv[])
+{
+    StubContext *s = calloc(1, sizeof(*s));
+    const char *video = NULL;
+    int i;
+
+    if (!s)
+        return -1;
+    *sacc = s;
+    s->mode        = MODE_COMMENTS;
+    s->nb_comments = 32;
+    s->seek_at     = -1;
+
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "mode=noop")) {
+            s->mode = MODE_NOOP;
+        } else if (!strcmp(arg, "mode=fill")) {
+            s->mode = MODE_FILL;
+        } else if (!strcmp(arg, "mode=comments")) {
+            s->mode = MODE_COMMENTS;
+        } else if (!strcmp(arg, "mode=trail")) {
+            s->mode = MODE_TRAIL;
+        } else if (!strcmp(arg, "format=rgb32")) {
+            box->surfaceFormat = SACC_SURFACE_RGB32;
+        } else if (!strcmp(arg, "format=yuv420p")) {
+            box->surfaceFormat = SACC_SURFACE_YUV420P;
+        } else if (!strcmp(arg, "format=nv12")) {
+            box->surfaceFormat = SACC_SURFACE_NV12;
+        } else if (!strcmp(arg, "format=overlay")) {
+            box->surfaceFormat = SACC_SURFACE_RGBA_OVERLAY;
+        } else if (!strncmp(arg, "comments=", 9)) {
+            s->nb_comments = atoi(arg + 9);
+        } else if (!strncmp(arg, "seek=", 5)) {
+            s->seek_at = atof(arg + 5);
+        } else if (!strcmp(arg, "reentrant")) {
+            box->flags |= SACC_FLAG_REENTRANT;
+        } else if (!strchr(arg, '=')) {
+            video = arg;
+        } else {
+            goto fail;
+        }
+    }
+    if (s->nb_comments < 1)
+        s->nb_comments = 1;
+    /* the device sets up its buffers in loadVideo, so the format comes first */
+    if (video && (!box->loadVideo || box->loadVideo(box, video) < 0))
+        goto fail;
+    return 0;
+fail:
+    free(s);
+    *sacc = NULL;
+    return -1;
+}
+
+int SaccMeasure(void *sacc, SaccToolBox *box, int srcWidth, int srcHeight, int *dstWidth, int *dstHeight)
+{
+    *dstWidth  = srcWidth;
+    *dstHeight = srcHeight;
+    return 0;
+}
+
+int SaccProcess(void *sacc, SaccToolBox *box, SaccFrame *target, SaccFrame *video)
+{
+    StubContext *s = sacc;
+    const int overlay = target->format == SACC_SURFACE_RGBA_OVERLAY;
+    int y;
+
+    if (s->seek_at >= 0 && target->vpos >= s->seek_at && box->seek &&
+        (video->flags & SACC_FRAME_SAME_VIDEO)) {
+        s->seek_at = -1;
+        if (box->seek(box, 0) < 0)
+            return -1;
+        return SACC_PROCESS_UNCHANGED;
+    }
+    if (overlay) {
+        /* the layer persists between calls (or comes from a pool), so clear it */
+        for (y = 0; y < target->h; y++)
+            memset((uint8_t *)target->planes[0] + y * target->linesizes[0], 0, target->w * 4);
+    }
+    switch (s->mode) {
+    case MODE_NOOP:
+        if (!overlay)
+            copy_video(target, video);
+        break;
+    case MODE_FILL:
+        fill_rect(target, 0, 0, target->w, target->h, overlay ? 0x80400000 : 0xff808080);
+        break;
+    case MODE_COMMENTS:
+        if (!overlay)
+            copy_video(target, video);
+        draw_comments(s, target);
+        break;
+    case MODE_TRAIL:
+        /* like toolbox v2 plugins, rely on the target keeping the last output */
+        if (!overlay && !(target->flags & SACC_FRAME_PREVIOUS))
+            copy_video(target, video);
+        draw_comments(s, target);
+        break;
+    }
+    return 0;
+}
+
+int SaccRelease(void *sacc, SaccToolBox *box)
+{
+    free(sacc);
+    return 0;
+}